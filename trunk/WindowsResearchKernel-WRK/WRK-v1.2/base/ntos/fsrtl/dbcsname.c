@@ -663,6 +663,34 @@ Return Value:
         }
     }
 
+    //  Likewise special case expressions of the form X*.  A matching prefix
+    //  cannot bisect a DBCS character since both strings are parsed from
+    //  their first byte.
+    if (Expression->Buffer[Expression->Length - 1] == '*') {
+        ANSI_STRING LocalExpression;
+        ULONG i = 0;
+
+        LocalExpression = *Expression;
+
+        LocalExpression.Length -= 1;
+
+        //  The final * must not be the second byte of a DBCS character.
+        if (NlsMbOemCodePageTag) {
+            while (i < LocalExpression.Length) {
+                i += FsRtlIsLeadDbcsCharacter(LocalExpression.Buffer[i]) ? 2 : 1;
+            }
+        }
+
+        //  Only special case an expression with a single *
+        if (i <= LocalExpression.Length && !FsRtlDoesDbcsContainWildCards(&LocalExpression)) {
+            if (Name->Length < LocalExpression.Length) {
+                return FALSE;
+            }
+
+            return (BOOLEAN)RtlEqualMemory(LocalExpression.Buffer, Name->Buffer, LocalExpression.Length);
+        }
+    }
+
     //  Walk through the name string, picking off characters.  We go one
     //  character beyond the end because some wild cards are able to match
     //  zero characters beyond the end of the string.
@@ -190,6 +190,12 @@ typedef struct _LOCK_QUEUE
     PRTL_SPLAY_LINKS ExclusiveLockTree;
     SINGLE_LIST_ENTRY WaitingLocks;
     SINGLE_LIST_ENTRY WaitingLocksTail;
+
+    //  The range of bytes spanned by the waiting locks, valid while there are any.
+    //  Freeing a lock can only grant waiters that overlap it, so an unlock outside this range need not look at the waiters at all.
+    //  The range is widened as waiters are queued and narrowed again whenever the whole list is scanned.
+    ULONGLONG WaitingLow;
+    ULONGLONG WaitingHigh;
 } LOCK_QUEUE, *PLOCK_QUEUE;
 
 
@@ -205,6 +211,7 @@ typedef struct _LOCK_INFO
 
     PCOMPLETE_LOCK_IRP_ROUTINE CompleteLockIrpRoutine;//  The optional procedure to call to complete a request
     PUNLOCK_ROUTINE UnlockRoutine;//  The optional procedure to call when unlocking a byte range
+    PFILE_LOCK FileLock;//  The file lock this structure belongs to, whose LocksPresent flag is set when a waiting lock is granted
     LOCK_QUEUE  LockQueue;// The locked ranges
 } LOCK_INFO, *PLOCK_INFO;
 
@@ -212,6 +219,13 @@ typedef struct _LOCK_INFO
 //  Local Macros
 
 
+//  The span of a lock on the line, for the purpose of finding waiters a freed lock may have blocked.
+//  The ending byte of a zero length lock precedes its starting byte, so it is treated as the point at its starting byte;
+//  a zero length lock at offset zero wraps to the whole file, which is conservative.
+#define FsRtlLockSpanLow(LI)    ((ULONGLONG)(LI)->StartingByte.QuadPart)
+#define FsRtlLockSpanHigh(LI)   (max((ULONGLONG)(LI)->StartingByte.QuadPart, (ULONGLONG)(LI)->EndingByte.QuadPart))
+
+
 //  The following macros sort out the allocation of internal structures.
 
 
@@ -341,7 +355,7 @@ PSH_LOCK FsRtlFindFirstOverlapInNode(IN PLOCKTREE_NODE Node, IN PLARGE_INTEGER S
 BOOLEAN FsRtlPrivateInsertLock(IN PLOCK_INFO LockInfo, IN PFILE_OBJECT FileObject, IN PFILE_LOCK_INFO FileLockInfo);
 BOOLEAN FsRtlPrivateInsertSharedLock(IN PLOCK_QUEUE LockQueue, IN PSH_LOCK NewLock);
 VOID FsRtlPrivateInsertExclusiveLock(IN PLOCK_QUEUE LockQueue, IN PEX_LOCK NewLock);
-VOID FsRtlPrivateCheckWaitingLocks(IN PLOCK_INFO LockInfo, IN PLOCK_QUEUE LockQueue, IN KIRQL OldIrql);
+VOID FsRtlPrivateCheckWaitingLocks(IN PLOCK_INFO LockInfo, IN PLOCK_QUEUE LockQueue, IN KIRQL OldIrql, IN PFILE_LOCK_INFO FreedLock OPTIONAL);
 VOID FsRtlPrivateCancelFileLockIrp(IN PDEVICE_OBJECT DeviceObject, IN PIRP Irp);
 BOOLEAN FsRtlPrivateCheckForExclusiveLockAccess(IN PLOCK_QUEUE LockInfo, IN PFILE_LOCK_INFO FileLockInfo);
 BOOLEAN FsRtlPrivateCheckForSharedLockAccess(IN PLOCK_QUEUE LockInfo, IN PFILE_LOCK_INFO FileLockInfo);
@@ -351,6 +365,7 @@ VOID FsRtlPrivateRemoveLock(IN PLOCK_INFO LockInfo, IN PFILE_LOCK_INFO, IN BOOLE
 BOOLEAN FsRtlCheckNoSharedConflict(IN PLOCK_QUEUE LockQueue, IN PLARGE_INTEGER Starting, IN PLARGE_INTEGER Ending);
 BOOLEAN FsRtlCheckNoExclusiveConflict(IN PLOCK_QUEUE LockQueue, IN PLARGE_INTEGER Starting, IN PLARGE_INTEGER Ending, IN ULONG Key, IN PFILE_OBJECT FileObject, IN PVOID ProcessId);
 VOID FsRtlPrivateResetLowestLockOffset(PLOCK_INFO LockInfo);
+VOID FsRtlPrivateUpdateLocksPresent(IN PFILE_LOCK FileLock);
 NTSTATUS FsRtlFastUnlockSingleShared(
     IN PLOCK_INFO LockInfo,
     IN PFILE_OBJECT FileObject,
@@ -424,6 +439,7 @@ Arguments:
     FileLock->CompleteLockIrpRoutine = CompleteLockIrpRoutine;
     FileLock->UnlockRoutine = UnlockRoutine;
     FileLock->FastIoIsQuestionable = FALSE;
+    FileLock->LocksPresent = FALSE;
 
     //  and return to our caller
     DebugTrace(-1, Dbg, "FsRtlInitializeFileLock -> VOID\n", 0);
@@ -473,6 +489,7 @@ Return Value:
         // Copy Irp & Unlock routines from pageable FileLock structure to non-pageable LockInfo structure
         LockInfo->CompleteLockIrpRoutine = FileLock->CompleteLockIrpRoutine;
         LockInfo->UnlockRoutine = FileLock->UnlockRoutine;
+        LockInfo->FileLock = FileLock;
 
         // Clear continuation info for enum routine
         FileLock->LastReturnedLockInfo.FileObject = NULL;
@@ -585,6 +602,7 @@ Arguments:
 
     // Unlink LockInfo from FileLock
     FileLock->LockInformation = NULL;
+    FileLock->LocksPresent = FALSE;
 
     //  And return to our caller
     DebugTrace(-1, Dbg, "FsRtlUninitializeFileLock -> VOID\n", 0);
@@ -717,6 +735,11 @@ Return Value:
 
     DebugTrace(+1, Dbg, "FsRtlCheckLockForReadAccess, FileLock = %08lx\n", FileLock);
 
+    if (!FileLock->LocksPresent) {
+        DebugTrace(-1, Dbg, "FsRtlCheckLockForReadAccess (No current locks) -> TRUE\n", 0);
+        return TRUE;
+    }
+
     if ((LockInfo = (PLOCK_INFO)FileLock->LockInformation) == NULL) {
         DebugTrace(-1, Dbg, "FsRtlCheckLockForReadAccess (No current lock info) -> TRUE\n", 0);
         return TRUE;
@@ -776,6 +799,11 @@ Return Value:
 
     DebugTrace(+1, Dbg, "FsRtlCheckLockForWriteAccess, FileLock = %08lx\n", FileLock);
 
+    if (!FileLock->LocksPresent) {
+        DebugTrace(-1, Dbg, "FsRtlCheckLockForWriteAccess (No current locks) -> TRUE\n", 0);
+        return TRUE;
+    }
+
     if ((LockInfo = (PLOCK_INFO)FileLock->LockInformation) == NULL) {
         DebugTrace(-1, Dbg, "FsRtlCheckLockForWriteAccess (No current lock info) -> TRUE\n", 0);
         return TRUE;
@@ -1425,6 +1453,11 @@ Return Value:
     PFILE_LOCK_INFO       LastLock;
     BOOLEAN               Status;
 
+    if (!FileLock->LocksPresent) {
+        // No byte range of the file is locked
+        return TRUE;
+    }
+
     if ((LockInfo = (PLOCK_INFO)FileLock->LockInformation) == NULL) {
         // No lock information on this FileLock
         DebugTrace(0, Dbg, "FsRtlFastCheckLockForRead, No lock info\n", 0);
@@ -1507,6 +1540,11 @@ Return Value:
     PFILE_LOCK_INFO         LastLock;
     BOOLEAN                 Status;
 
+    if (!FileLock->LocksPresent) {
+        // No byte range of the file is locked
+        return TRUE;
+    }
+
     if ((LockInfo = (PLOCK_INFO)FileLock->LockInformation) == NULL) {
         // No lock information on this FileLock
         DebugTrace(0, Dbg, "FsRtlFastCheckLockForRead, No lock info\n", 0);
@@ -1800,11 +1838,12 @@ Return Value:
     }
 
     Status = FsRtlFastUnlockSingleExclusive(FileLock->LockInformation, FileObject, FileOffset, Length, ProcessId, Key, Context, FALSE, TRUE);
-    if (Status == STATUS_SUCCESS) {
-        return Status;//  Found and unlocked in the exclusive tree, so we're done
+    if (Status != STATUS_SUCCESS) {
+        //  Not found in the exclusive tree, so try the shared tree
+        Status = FsRtlFastUnlockSingleShared(FileLock->LockInformation, FileObject, FileOffset, Length, ProcessId, Key, Context, FALSE, TRUE);
     }
 
-    Status = FsRtlFastUnlockSingleShared(FileLock->LockInformation, FileObject, FileOffset, Length, ProcessId, Key, Context, FALSE, TRUE);
+    FsRtlPrivateUpdateLocksPresent(FileLock);
     return Status;
 }
 
@@ -1925,13 +1964,13 @@ Return Value:
                 FsRtlAcquireLockQueue(LockQueue, &OldIrql);
             }
 
-            FsRtlFreeSharedLock(Lock);
-
             //  See if there are additional waiting locks that we can now release.
             if (CheckForWaiters && LockQueue->WaitingLocks.Next) {
-                FsRtlPrivateCheckWaitingLocks(LockInfo, LockQueue, OldIrql);
+                FsRtlPrivateCheckWaitingLocks(LockInfo, LockQueue, OldIrql, &Lock->LockInfo);
             }
 
+            FsRtlFreeSharedLock(Lock);
+
             FsRtlReleaseLockQueue(LockQueue, OldIrql);
             return STATUS_SUCCESS;
         }
@@ -2036,13 +2075,13 @@ Return Value:
                 FsRtlAcquireLockQueue(LockQueue, &OldIrql);
             }
 
-            FsRtlFreeExclusiveLock(Lock);
-
             //  See if there are additional waiting locks that we can now release.
             if (CheckForWaiters && LockQueue->WaitingLocks.Next) {
-                FsRtlPrivateCheckWaitingLocks(LockInfo, LockQueue, OldIrql);
+                FsRtlPrivateCheckWaitingLocks(LockInfo, LockQueue, OldIrql, &Lock->LockInfo);
             }
 
+            FsRtlFreeExclusiveLock(Lock);
+
             FsRtlReleaseLockQueue(LockQueue, OldIrql);
             return STATUS_SUCCESS;
         }
@@ -2072,12 +2111,17 @@ Arguments:
     Context - Supplies an optional context to use when completing waiting lock irps.
 */
 {
-    return FsRtlPrivateFastUnlockAll(
+    NTSTATUS Status;
+
+    Status = FsRtlPrivateFastUnlockAll(
         FileLock,
         FileObject,
         ProcessId,
         0, FALSE,           // No Key
         Context);
+
+    FsRtlPrivateUpdateLocksPresent(FileLock);
+    return Status;
 }
 
 
@@ -2097,7 +2141,11 @@ Return Value:
     NTSTATUS - The return status for the operation.
 */
 {
-    return FsRtlPrivateFastUnlockAll(FileLock, FileObject, ProcessId, Key, TRUE, Context);
+    NTSTATUS Status;
+
+    Status = FsRtlPrivateFastUnlockAll(FileLock, FileObject, ProcessId, Key, TRUE, Context);
+    FsRtlPrivateUpdateLocksPresent(FileLock);
+    return Status;
 }
 
 
@@ -2167,6 +2215,10 @@ Return Value:
         LockInfo = (PLOCK_INFO)FileLock->LockInformation;// Pickup allocated lockinfo structure
     }
 
+    //  Set the flag before the lock can be inserted so that no check routine skips the queue while the lock is held.
+    //  If the lock is not granted the flag is recomputed below.
+    FileLock->LocksPresent = TRUE;
+
     // Assume success and build LockData structure prior to acquiring the lock queue spinlock.  (mp perf enhancement)
     FileLockInfo.StartingByte = *FileOffset;
     FileLockInfo.Length = *Length;
@@ -2228,10 +2280,14 @@ Return Value:
                     // Create new list
                     LockQueue->WaitingLocks.Next = &WaitingLock->Link;
                     LockQueue->WaitingLocksTail.Next = &WaitingLock->Link;
+                    LockQueue->WaitingLow = FsRtlLockSpanLow(&FileLockInfo);
+                    LockQueue->WaitingHigh = FsRtlLockSpanHigh(&FileLockInfo);
                 } else {
                     // Add waiter to tail of list
                     LockQueue->WaitingLocksTail.Next->Next = &WaitingLock->Link;
                     LockQueue->WaitingLocksTail.Next = &WaitingLock->Link;
+                    LockQueue->WaitingLow = min(LockQueue->WaitingLow, FsRtlLockSpanLow(&FileLockInfo));
+                    LockQueue->WaitingHigh = max(LockQueue->WaitingHigh, FsRtlLockSpanHigh(&FileLockInfo));
                 }
 
                 //  Setup IRP in case it's canceled - then set the IRP's cancel routine
@@ -2286,6 +2342,9 @@ Return Value:
             FsRtlReleaseLockQueue(LockQueue, OldIrql);
         }
 
+        //  A racing unlock may have cleared the flag before our lock was inserted, so recompute it before the caller learns of the lock.
+        FsRtlPrivateUpdateLocksPresent(FileLock);
+
     //  Complete the request provided we were given one and it is not a pending status
     if (!AbnormalTermination() && ARGUMENT_PRESENT(Irp) && (Iosb->Status != STATUS_PENDING)) {
         NTSTATUS NewStatus;
@@ -2300,6 +2359,7 @@ Return Value:
         if (!NT_SUCCESS(NewStatus) && NT_SUCCESS(Iosb->Status)) {
             // Irp failed, remove the lock which was added
             FsRtlPrivateRemoveLock(LockInfo, &FileLockInfo, TRUE);
+            FsRtlPrivateUpdateLocksPresent(FileLock);
         }
 
         //  Lift our private reference to the fileobject. This may induce deletion.
@@ -2564,19 +2624,41 @@ Arguments:
 //  Internal Support Routine
 
 
-VOID FsRtlPrivateCheckWaitingLocks(IN PLOCK_INFO LockInfo, IN PLOCK_QUEUE LockQueue, IN KIRQL OldIrql)
+VOID FsRtlPrivateCheckWaitingLocks(IN PLOCK_INFO LockInfo, IN PLOCK_QUEUE LockQueue, IN KIRQL OldIrql, IN PFILE_LOCK_INFO FreedLock OPTIONAL)
 /*
 Routine Description:
     This routine checks to see if any of the current waiting locks are now be satisfied, and if so it completes their IRPs.
+    Only waiters that overlap the freed range are checked, since no other waiter can have been granted access by the unlock.
 Arguments:
     LockInfo - LockInfo which LockQueue is member of
     LockQueue - Supplies queue which needs to be checked
     OldIrql - Irql to restore when LockQueue is released
+    FreedLock - Optionally supplies the lock whose removal prompted the check.
+        If not supplied every waiter is checked, as is needed after locks throughout the file were removed.
 */
 {
     PSINGLE_LIST_ENTRY *pLink, Link;
     NTSTATUS NewStatus;
     BOOLEAN Result;
+    ULONGLONG FreedLow, FreedHigh;
+    ULONGLONG WaitingLow, WaitingHigh;
+
+    if (ARGUMENT_PRESENT(FreedLock)) {
+        FreedLow = FsRtlLockSpanLow(FreedLock);
+        FreedHigh = FsRtlLockSpanHigh(FreedLock);
+
+        //  Nothing to do if no waiter overlaps the freed range
+        if (LockQueue->WaitingLocks.Next == NULL || FreedHigh < LockQueue->WaitingLow || FreedLow > LockQueue->WaitingHigh) {
+            return;
+        }
+    } else {
+        FreedLow = 0;
+        FreedHigh = ~((ULONGLONG)0);
+    }
+
+    //  Recompute the range spanned by the waiters that remain as we go
+    WaitingLow = ~((ULONGLONG)0);
+    WaitingHigh = 0;
 
     pLink = &LockQueue->WaitingLocks.Next;
     while ((Link = *pLink) != NULL) {
@@ -2601,6 +2683,14 @@ Arguments:
         FileLockInfo.Key = IrpSp->Parameters.LockControl.Key;
         FileLockInfo.ExclusiveLock = BooleanFlagOn(IrpSp->Flags, SL_EXCLUSIVE_LOCK);
 
+        //  A waiter that does not overlap the freed range is blocked by the same locks as before
+        if (FsRtlLockSpanHigh(&FileLockInfo) < FreedLow || FsRtlLockSpanLow(&FileLockInfo) > FreedHigh) {
+            WaitingLow = min(WaitingLow, FsRtlLockSpanLow(&FileLockInfo));
+            WaitingHigh = max(WaitingHigh, FsRtlLockSpanHigh(&FileLockInfo));
+            pLink = &Link->Next;
+            continue;
+        }
+
         //  Now case on whether we're trying to take out an exclusive lock or a shared lock.
         //  And in both cases try to get the appropriate access For the exclusive case we send in a NULL file object and process id,
         //  this will ensure that the lookup does not give us write access through an exclusive lock.
@@ -2641,6 +2731,13 @@ Arguments:
 
                 FsRtlReleaseLockQueue(LockQueue, OldIrql);// Release LockQueue and complete this waiter
 
+                //  Set the flag before the waiter learns that its lock is granted, as the direct lock path does.
+                //  The flag lives in the FILE_LOCK, which may be paged, so it is written only now that the queue spinlock is released.
+                //  A racing unlock cannot clear it again while the granted lock is in the tree.
+                if (Result) {
+                    LockInfo->FileLock->LocksPresent = TRUE;
+                }
+
                 //  Reference the fileobject over the completion attempt so we can have a chance to cleanup safely if we fail
                 ObReferenceObject(FileLockInfo.FileObject);
 
@@ -2648,21 +2745,32 @@ Arguments:
                 FsRtlCompleteLockIrp(LockInfo, WaitingLock->Context, Irp, (Result ? STATUS_SUCCESS : STATUS_INSUFFICIENT_RESOURCES), &NewStatus, FileLockInfo.FileObject);
                 if (Result && !NT_SUCCESS(NewStatus)) {
                     // Irp was not successful, remove lock if it was added.
+                    // Waiters overlapping that lock may now be granted as well.
                     FsRtlPrivateRemoveLock(LockInfo, &FileLockInfo, FALSE);
+                    FreedLow = min(FreedLow, FsRtlLockSpanLow(&FileLockInfo));
+                    FreedHigh = max(FreedHigh, FsRtlLockSpanHigh(&FileLockInfo));
                 }
 
                 ObDereferenceObject(FileLockInfo.FileObject);//  Drop our private reference to the fileobject
                 FsRtlAcquireLockQueue(LockQueue, &OldIrql);// Re-acquire queue lock
                 pLink = &LockQueue->WaitingLocks.Next;// Start scan over from beginning
+                WaitingLow = ~((ULONGLONG)0);
+                WaitingHigh = 0;
                 FsRtlFreeWaitingLock(WaitingLock);//  Free up pool
                 continue;
             }
         }
 
         DebugTrace(0, Dbg, "FsRtlCheckWaitingLocks still no access\n", 0);
+        WaitingLow = min(WaitingLow, FsRtlLockSpanLow(&FileLockInfo));
+        WaitingHigh = max(WaitingHigh, FsRtlLockSpanHigh(&FileLockInfo));
         pLink = &Link->Next;// Move to next lock
     }
 
+    //  Every remaining waiter was visited since the last restart, so the recomputed range is exact
+    LockQueue->WaitingLow = WaitingLow;
+    LockQueue->WaitingHigh = WaitingHigh;
+
     return;//  And return to our caller
 }
 
@@ -3077,7 +3185,7 @@ Arguments:
     }
 
     //  At this point we've gone through unlocking everything. So now try and release any waiting locks.
-    FsRtlPrivateCheckWaitingLocks(LockInfo, LockQueue, OldIrql);
+    FsRtlPrivateCheckWaitingLocks(LockInfo, LockQueue, OldIrql, NULL);
 
     //  We deleted a (possible) bunch of locks, go repair the lowest lock offset
     FsRtlPrivateResetLowestLockOffset(LockInfo);
@@ -3089,6 +3197,39 @@ Arguments:
 }
 
 
+VOID FsRtlPrivateUpdateLocksPresent(IN PFILE_LOCK FileLock)
+/*
+Routine Description:
+    This routine recomputes the LocksPresent flag of a file lock after locks may have been inserted or removed.
+    The flag is only written at passive level, since the FILE_LOCK may be in paged pool, so it cannot be kept under the lock queue spinlock.
+    Instead the flag is cleared only after seeing both lock trees empty, and set again if a lock was inserted while it was being cleared.
+    A lock request sets the flag before its lock is inserted, and a waiting lock has the flag set before its IRP is completed,
+    so the flag is set by the time any lock is granted and stays set while the lock is in a tree.
+Arguments:
+    FileLock - Supplies the file lock.
+*/
+{
+    PLOCK_INFO LockInfo;
+
+    if ((LockInfo = (PLOCK_INFO)FileLock->LockInformation) == NULL) {
+        FileLock->LocksPresent = FALSE;
+        return;
+    }
+
+    if (LockInfo->LockQueue.SharedLockTree != NULL || LockInfo->LockQueue.ExclusiveLockTree != NULL) {
+        FileLock->LocksPresent = TRUE;
+        return;
+    }
+
+    FileLock->LocksPresent = FALSE;
+    KeMemoryBarrier();
+
+    if (LockInfo->LockQueue.SharedLockTree != NULL || LockInfo->LockQueue.ExclusiveLockTree != NULL) {
+        FileLock->LocksPresent = TRUE;
+    }
+}
+
+
 VOID FsRtlPrivateCancelFileLockIrp(IN PDEVICE_OBJECT DeviceObject, IN PIRP Irp)
 /*
 Routine Description:
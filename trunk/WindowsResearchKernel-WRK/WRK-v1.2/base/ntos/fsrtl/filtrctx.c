@@ -34,6 +34,20 @@ Abstract:
 #define MySearchList(pHdr, Ptr) \
     for ( Ptr = (pHdr)->Flink;  Ptr != (pHdr);  Ptr = Ptr->Flink )
 
+//  The hint slot of a filter.  OwnerIds are usually addresses of pool allocations, so skip the low bits which are always clear.
+#define FsRtlContextHintSlot(OwnerId) \
+    ((((ULONG_PTR)(OwnerId) >> 4) ^ ((ULONG_PTR)(OwnerId) >> 9)) & (FSRTL_FILTER_CONTEXT_HINTS - 1))
+
+#define FsRtlHasContextHints(pHdr) FlagOn((pHdr)->Flags2, FSRTL_FLAG2_FILTER_CONTEXT_HINTS)
+
+//  Forget a context that is leaving the list.
+#define FsRtlClearContextHint(pHdr, Ctx) {                                                  \
+    if (FsRtlHasContextHints(pHdr) &&                                                      \
+        (pHdr)->FilterContextHints[FsRtlContextHintSlot((Ctx)->OwnerId)] == (Ctx)) {        \
+        (pHdr)->FilterContextHints[FsRtlContextHintSlot((Ctx)->OwnerId)] = NULL;            \
+    }                                                                                      \
+}
+
 
 //  The rest of the routines are not marked pageable so they can be called during the paging path
 
@@ -70,6 +84,12 @@ Return Value:
 
     ExAcquireFastMutex(AdvFcbHeader->FastMutex);
     InsertHeadList(&AdvFcbHeader->FilterContexts, &Ptr->Links);
+
+    //  The new context is now the first one of its owner in the list, which is what a lookup by OwnerId alone returns.
+    if (FsRtlHasContextHints(AdvFcbHeader)) {
+        AdvFcbHeader->FilterContextHints[FsRtlContextHintSlot(Ptr->OwnerId)] = Ptr;
+    }
+
     ExReleaseFastMutex(AdvFcbHeader->FastMutex);
     return STATUS_SUCCESS;
 }
@@ -89,6 +109,9 @@ Arguments:
         If not provided, any of the contexts owned by the filter driver is returned.
 
     If neither the OwnerId nor the InstanceId is provided, any associated filter context will be returned.
+
+    When the header supports hints, the context last found or inserted for a filter is checked before the list is searched.
+    The hint of a filter always holds the first of its contexts in the list, so a lookup by OwnerId alone returns the same context either way.
 Return Value:
     A pointer to the filter context, or NULL if no match found.
 */
@@ -103,6 +126,14 @@ Return Value:
     ExAcquireFastMutex(AdvFcbHeader->FastMutex);
     rtnCtx = NULL;
 
+    if (ARGUMENT_PRESENT(OwnerId) && FsRtlHasContextHints(AdvFcbHeader)) {
+        ctx = AdvFcbHeader->FilterContextHints[FsRtlContextHintSlot(OwnerId)];
+        if (ctx != NULL && ctx->OwnerId == OwnerId && (!ARGUMENT_PRESENT(InstanceId) || ctx->InstanceId == InstanceId)) {
+            ExReleaseFastMutex(AdvFcbHeader->FastMutex);
+            return ctx;
+        }
+    }
+
     // Use different loops depending on whether we are comparing both Ids or not.
     if (ARGUMENT_PRESENT(InstanceId)) {
         MySearchList(&AdvFcbHeader->FilterContexts, list)
@@ -122,6 +153,11 @@ Return Value:
                 break;
             }
         }
+
+        //  This is the first context of the filter, so remember it for the next lookup.
+        if (rtnCtx != NULL && FsRtlHasContextHints(AdvFcbHeader)) {
+            AdvFcbHeader->FilterContextHints[FsRtlContextHintSlot(OwnerId)] = rtnCtx;
+        }
     } else if (!IsListEmpty(&AdvFcbHeader->FilterContexts)) {
         rtnCtx = (PFSRTL_PER_STREAM_CONTEXT)AdvFcbHeader->FilterContexts.Flink;
     }
@@ -183,6 +219,7 @@ Return Value:
 
     if (rtnCtx) {
         RemoveEntryList(&rtnCtx->Links);   // remove the matched entry
+        FsRtlClearContextHint(AdvFcbHeader, rtnCtx);
     }
 
     ExReleaseFastMutex(AdvFcbHeader->FastMutex);
@@ -210,11 +247,12 @@ Arguments:
             //  Unlink the top entry then release the lock.
             //  We must release the lock before calling the use or their could be potential locking order deadlocks.
             ptr = RemoveHeadList(&AdvFcbHeader->FilterContexts);
+            ctx = CONTAINING_RECORD(ptr, FSRTL_PER_STREAM_CONTEXT, Links);
+            FsRtlClearContextHint(AdvFcbHeader, ctx);
             ExReleaseFastMutex(AdvFcbHeader->FastMutex);
             lockHeld = FALSE;
 
             //  Call filter to free this entry
-            ctx = CONTAINING_RECORD(ptr, FSRTL_PER_STREAM_CONTEXT, Links);
             ASSERT(ctx->FreeCallback);
             (*ctx->FreeCallback)(ctx);
 
@@ -1836,6 +1836,20 @@ Return Value:
     LONG MaxIndex;
     LONG MidIndex;
 
+    //  Most lookups and changes of a growing file land in its last run, so check that before searching.
+    if (BaseMcb->PairCount != 0) {
+        MidIndex = BaseMcb->PairCount - 1;
+        if (Vbn > EndingVbn(BaseMcb, MidIndex)) {
+            *Index = BaseMcb->PairCount;
+            return FALSE;
+        }
+
+        if (Vbn >= StartingVbn(BaseMcb, MidIndex)) {
+            *Index = MidIndex;
+            return TRUE;
+        }
+    }
+
     //  We'll just do a binary search for the mapping entry.  Min and max are our search boundaries
 
     MinIndex = 0;
@@ -1886,10 +1900,12 @@ Arguments:
         //  We need to allocate a new mapping so compute a new maximum pair count.  We'll only be asked to grow by at most 2 at a time, so
         //  doubling will definitely make us large enough for the new amount.
         //  But we won't double without bounds we'll stop doubling if the pair count gets too high.
+        //  Past that point we still grow by half the current size rather than by a fixed amount,
+        //  so that building the map of a heavily fragmented file copies each pair a constant number of times on average instead of once per 2048 runs added.
         if (BaseMcb->MaximumPairCount < 2048) {
             NewMax = BaseMcb->MaximumPairCount * 2;
         } else {
-            NewMax = BaseMcb->MaximumPairCount + 2048;
+            NewMax = BaseMcb->MaximumPairCount + BaseMcb->MaximumPairCount / 2;
         }
 
         Mapping = FsRtlpAllocatePool(BaseMcb->PoolType, sizeof(MAPPING) * NewMax);
@@ -171,9 +171,8 @@ Return Value:
 {
     ULONG Index;
     ULONG NameLength;
-    BOOLEAN FreeStrings = FALSE;
-    UNICODE_STRING LocalNameA;
-    UNICODE_STRING LocalNameB;
+    WCHAR CharA;
+    WCHAR CharB;
 
     PAGED_CODE();
 
@@ -184,48 +183,29 @@ Return Value:
 
     NameLength = ConstantNameA->Length / sizeof(WCHAR);
 
-    //  If we weren't given an upcase table, we have to upcase the names ourselves.
-    if (IgnoreCase && !ARGUMENT_PRESENT(UpcaseTable)) {
-        NTSTATUS Status;
-
-        Status = RtlUpcaseUnicodeString(&LocalNameA, ConstantNameA, TRUE);
-        if (!NT_SUCCESS(Status)) {
-            ExRaiseStatus(Status);
-        }
-
-        Status = RtlUpcaseUnicodeString(&LocalNameB, ConstantNameB, TRUE);
-        if (!NT_SUCCESS(Status)) {
-            RtlFreeUnicodeString(&LocalNameA);
-            ExRaiseStatus(Status);
-        }
-
-        ConstantNameA = &LocalNameA;
-        ConstantNameB = &LocalNameB;
-
-        IgnoreCase = FALSE;
-        FreeStrings = TRUE;
-    }
-
     //  Do either case sensitive or insensitive compare.
     if (!IgnoreCase) {
-        BOOLEAN BytesEqual;
+        return (BOOLEAN)RtlEqualMemory(ConstantNameA->Buffer, ConstantNameB->Buffer, ConstantNameA->Length);
+    }
 
-        BytesEqual = (BOOLEAN)RtlEqualMemory(ConstantNameA->Buffer, ConstantNameB->Buffer, ConstantNameA->Length);
-        if (FreeStrings) {
-            RtlFreeUnicodeString(&LocalNameA);
-            RtlFreeUnicodeString(&LocalNameB);
-        }
+    //  Names compared without regard to case usually match exactly anyway, so only upcase the characters that differ.
+    //  If we weren't given an upcase table, upcase those characters with the system table rather than allocating upcased copies of both names.
+    for (Index = 0; Index < NameLength; Index += 1) {
+        CharA = ConstantNameA->Buffer[Index];
+        CharB = ConstantNameB->Buffer[Index];
 
-        return BytesEqual;
-    } else {
-        for (Index = 0; Index < NameLength; Index += 1) {
-            if (UpcaseTable[ConstantNameA->Buffer[Index]] != UpcaseTable[ConstantNameB->Buffer[Index]]) {
+        if (CharA != CharB) {
+            if (ARGUMENT_PRESENT(UpcaseTable)) {
+                if (UpcaseTable[CharA] != UpcaseTable[CharB]) {
+                    return FALSE;
+                }
+            } else if (RtlUpcaseUnicodeChar(CharA) != RtlUpcaseUnicodeChar(CharB)) {
                 return FALSE;
             }
         }
-
-        return TRUE;
     }
+
+    return TRUE;
 }
 
 
@@ -419,6 +399,43 @@ Return Value:
         }
     }
 
+    //  Likewise special case expressions of the form X*, which are used to enumerate the names with a given prefix.
+    if (Expression->Buffer[(Expression->Length / sizeof(WCHAR)) - 1] == L'*') {
+        UNICODE_STRING LocalExpression;
+
+        LocalExpression = *Expression;
+        LocalExpression.Length -= 2;
+
+        //  Only special case an expression with a single *.
+        //  FsRtlDoesNameContainWildCards stops at the last path separator, so scan the whole prefix here.
+        for (ExprOffset = 0; ExprOffset < (USHORT)(LocalExpression.Length / sizeof(WCHAR)); ExprOffset += 1) {
+            if (FsRtlIsUnicodeCharacterWild(LocalExpression.Buffer[ExprOffset])) {
+                break;
+            }
+        }
+
+        if (ExprOffset == (USHORT)(LocalExpression.Length / sizeof(WCHAR))) {
+            if (Name->Length < LocalExpression.Length) {
+                return FALSE;
+            }
+
+            if (!IgnoreCase) {
+                return (BOOLEAN)RtlEqualMemory(LocalExpression.Buffer, Name->Buffer, LocalExpression.Length);
+            } else {
+                for (ExprOffset = 0; ExprOffset < (USHORT)(LocalExpression.Length / sizeof(WCHAR)); ExprOffset += 1) {
+                    NameChar = UpcaseTable[Name->Buffer[ExprOffset]];
+                    ExprChar = LocalExpression.Buffer[ExprOffset];
+                    ASSERT(ExprChar == UpcaseTable[ExprChar]);
+                    if (NameChar != ExprChar) {
+                        return FALSE;
+                    }
+                }
+
+                return TRUE;
+            }
+        }
+    }
+
     //  Walk through the name string, picking off characters.
     //  We go one character beyond the end because some wild cards are able to match zero characters beyond the end of the string.
 
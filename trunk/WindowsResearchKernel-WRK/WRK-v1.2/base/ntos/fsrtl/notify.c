@@ -201,6 +201,14 @@ BOOLEAN FsRtlNotifyUpdateBuffer(
     IN BOOLEAN UnicodeName,
     IN ULONG SizeOfEntry
 );
+BOOLEAN FsRtlNotifyIsDuplicateEntry(
+    IN PNOTIFY_CHANGE Notify,
+    IN ULONG FileAction,
+    IN PSTRING ParentName,
+    IN PSTRING TargetName,
+    IN PSTRING StreamName OPTIONAL,
+    IN ULONG SizeOfEntry
+);
 VOID FsRtlNotifyCompleteIrpList(IN PNOTIFY_CHANGE Notify, IN NTSTATUS Status);
 VOID FsRtlCancelNotify(IN PDEVICE_OBJECT DeviceObject, IN PIRP ThisIrp);
 VOID FsRtlCheckNotifyForDelete(IN PLIST_ENTRY NotifyListHead, IN PVOID FsContext);
@@ -218,6 +226,7 @@ VOID FsRtlCheckNotifyForDelete(IN PLIST_ENTRY NotifyListHead, IN PVOID FsContext
 #pragma alloc_text(PAGE, FsRtlNotifyCompleteIrp)
 #pragma alloc_text(PAGE, FsRtlNotifyReportChange)
 #pragma alloc_text(PAGE, FsRtlNotifyUpdateBuffer)
+#pragma alloc_text(PAGE, FsRtlNotifyIsDuplicateEntry)
 #pragma alloc_text(PAGE, FsRtlCheckNotifyForDelete)
 #pragma alloc_text(PAGE, FsRtlNotifyCompleteIrpList)
 #endif
@@ -730,6 +739,8 @@ Return Value:
     ULONG CurrentOffset;
     ULONG NextEntryOffset;
     ULONG ExceptionCode = 0;
+    ULONG OemTargetNameSize = MAXULONG;
+    ULONG OemStreamNameSize = MAXULONG;
 
     PAGED_CODE();
 
@@ -829,7 +840,9 @@ Return Value:
 
                 //  We now have a correct match of the name lengths.
                 //  Now verify that the characters match exactly.
-                if (!RtlEqualMemory(Notify->FullDirectoryName->Buffer, NormalizedParentName->Buffer, Notify->FullDirectoryName->Length)) {
+                //  Sibling directories share everything but their final characters, so check the last byte before comparing the whole name.
+                if (*(Add2Ptr(Notify->FullDirectoryName->Buffer, Notify->FullDirectoryName->Length - 1, PCHAR)) != *(Add2Ptr(NormalizedParentName->Buffer, Notify->FullDirectoryName->Length - 1, PCHAR)) ||
+                    !RtlEqualMemory(Notify->FullDirectoryName->Buffer, NormalizedParentName->Buffer, Notify->FullDirectoryName->Length)) {
                     continue;
                 }
 
@@ -997,8 +1010,13 @@ Return Value:
                             TargetName.Length = FullTargetName->Length - TargetNameOffset;
                     }
 
+                    //  The converted size of the target and stream names is the same for every watcher, so only compute it once per report.
                     if (Notify->CharacterSize == sizeof(CHAR)) {
-                        SizeOfEntry += RtlOemStringToCountedUnicodeSize(&TargetName);
+                        if (OemTargetNameSize == MAXULONG) {
+                            OemTargetNameSize = RtlOemStringToCountedUnicodeSize(&TargetName);
+                        }
+
+                        SizeOfEntry += OemTargetNameSize;
                     } else {
                         SizeOfEntry += TargetName.Length;
                     }
@@ -1009,7 +1027,11 @@ Return Value:
                         if (Notify->CharacterSize == sizeof(WCHAR)) {
                             SizeOfEntry += (StreamName->Length + sizeof(WCHAR));
                         } else {
-                            SizeOfEntry += (RtlOemStringToCountedUnicodeSize(StreamName) + sizeof(CHAR));
+                            if (OemStreamNameSize == MAXULONG) {
+                                OemStreamNameSize = RtlOemStringToCountedUnicodeSize(StreamName);
+                            }
+
+                            SizeOfEntry += (OemStreamNameSize + sizeof(CHAR));
                         }
                     }
                 }
@@ -1017,7 +1039,11 @@ Return Value:
                 //  Remember if this report would overflow the buffer.
                 NextEntryOffset = (ULONG)LongAlign(Notify->DataLength);
 
-                if (SizeOfEntry <= AllocationLength && (NextEntryOffset + SizeOfEntry) <= AllocationLength) {
+                //  A burst of writes to one file reports the same change over and over while no Irp is waiting.
+                //  If this report repeats the last entry in the buffer there is nothing new to tell the caller, so drop it.
+                if (!ViewIndex && FsRtlNotifyIsDuplicateEntry(Notify, Action, &TargetParent, &TargetName, StreamName, SizeOfEntry)) {
+                    NOTHING;
+                } else if (SizeOfEntry <= AllocationLength && (NextEntryOffset + SizeOfEntry) <= AllocationLength) {
                     PFILE_NOTIFY_INFORMATION NotifyInfo = NULL;
 
                     //  If there is already a notify buffer, we append this data to it.
@@ -1460,6 +1486,78 @@ Return Value:
 }
 
 
+//  Local support routine
+
+BOOLEAN FsRtlNotifyIsDuplicateEntry(
+    IN PNOTIFY_CHANGE Notify,
+    IN ULONG FileAction,
+    IN PSTRING ParentName,
+    IN PSTRING TargetName,
+    IN PSTRING StreamName OPTIONAL,
+    IN ULONG SizeOfEntry
+)
+/*
+Routine Description:
+    This routine is called to check whether a change would add the same entry as the last one already in the notify buffer.
+    Only modifications of Unicode names are coalesced.
+    Other actions come in pairs or change the meaning of the entries around them, and comparing Oem names would require converting them.
+Arguments:
+    Notify  -  This is the notify change structure.
+    FileAction  -  Action which triggered the notification event.
+    ParentName  -  Relative path to the parent of the changed file from the directory being watched.
+    TargetName  -  This is the name of the modified file.
+    StreamName  -  If present there is a stream name to append to the filename.
+    SizeOfEntry  -  Indicates the number of bytes the entry would use in the buffer.
+Return Value:
+    BOOLEAN - TRUE if the last entry in the buffer is identical, FALSE otherwise.
+*/
+{
+    PFILE_NOTIFY_INFORMATION NotifyInfo;
+    BOOLEAN Duplicate = FALSE;
+    ULONG BufferOffset = 0;
+
+    PAGED_CODE();
+
+    if (Notify->Buffer == NULL || Notify->DataLength == 0 || Notify->CharacterSize != sizeof(WCHAR)) {
+        return FALSE;
+    }
+
+    if (FileAction != FILE_ACTION_MODIFIED && FileAction != FILE_ACTION_MODIFIED_STREAM) {
+        return FALSE;
+    }
+
+    //  The buffer may belong to the user, so protect the comparison in the same way as the copy.
+    try {
+        NotifyInfo = Add2Ptr(Notify->Buffer, Notify->LastEntry, PFILE_NOTIFY_INFORMATION);
+
+        if (NotifyInfo->Action == FileAction && NotifyInfo->FileNameLength == SizeOfEntry - FIELD_OFFSET(FILE_NOTIFY_INFORMATION, FileName)) {
+            Duplicate = TRUE;
+
+            if (ParentName->Length != 0) {
+                Duplicate = (BOOLEAN)(RtlEqualMemory(NotifyInfo->FileName, ParentName->Buffer, ParentName->Length) &&
+                                      *(Add2Ptr(NotifyInfo->FileName, ParentName->Length, PWCHAR)) == L'\\');
+                BufferOffset = ParentName->Length + sizeof(WCHAR);
+            }
+
+            if (Duplicate) {
+                Duplicate = (BOOLEAN)RtlEqualMemory(Add2Ptr(NotifyInfo->FileName, BufferOffset, PVOID), TargetName->Buffer, TargetName->Length);
+                BufferOffset += TargetName->Length;
+            }
+
+            if (Duplicate && ARGUMENT_PRESENT(StreamName)) {
+                Duplicate = (BOOLEAN)(*(Add2Ptr(NotifyInfo->FileName, BufferOffset, PWCHAR)) == L':' &&
+                                      RtlEqualMemory(Add2Ptr(NotifyInfo->FileName, BufferOffset + sizeof(WCHAR), PVOID), StreamName->Buffer, StreamName->Length));
+            }
+        }
+    } except(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Duplicate = FALSE;
+    }
+
+    return Duplicate;
+}
+
+
 //  Local support routine
 
 VOID FsRtlNotifyCompleteIrpList(IN OUT PNOTIFY_CHANGE Notify, IN NTSTATUS Status)
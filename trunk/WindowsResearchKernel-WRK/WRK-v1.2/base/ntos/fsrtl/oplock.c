@@ -152,6 +152,8 @@ NTSTATUS FsRtlOplockBreakToII(IN OUT PNONOPAQUE_OPLOCK Oplock,
 NTSTATUS FsRtlOplockBreakToNone(IN OUT PNONOPAQUE_OPLOCK Oplock, IN PIO_STACK_LOCATION IrpSp, IN PIRP Irp, IN PVOID Context,
                                 IN POPLOCK_WAIT_COMPLETE_ROUTINE CompletionRoutine OPTIONAL, IN POPLOCK_FS_PREPOST_IRP PostIrpRoutine OPTIONAL);
 VOID FsRtlRemoveAndCompleteIrp(IN PLIST_ENTRY Link);
+VOID FsRtlRemoveOplockIIIrps(IN OUT PNONOPAQUE_OPLOCK Oplock, OUT PLIST_ENTRY IrpList);
+VOID FsRtlCompleteOplockIIIrps(IN PLIST_ENTRY IrpList);
 NTSTATUS FsRtlWaitOnIrp(IN OUT PNONOPAQUE_OPLOCK Oplock,
                         IN PIRP Irp,
                         IN PVOID Context,
@@ -1452,12 +1454,15 @@ Return Value:
     KEVENT Event;
     NTSTATUS Status = STATUS_SUCCESS;
     LOGICAL AcquiredMutex;
+    LIST_ENTRY BrokenIrps;
 
     DebugTrace(+1, Dbg, "CheckOplockBreakToNone:  Entered\n", 0);
     DebugTrace(0, Dbg, "Oplock    -> %08lx\n", Oplock);
     DebugTrace(0, Dbg, "IrpSp     -> %08lx\n", IrpSp);
     DebugTrace(0, Dbg, "Irp       -> %08lx\n", Irp);
 
+    InitializeListHead(&BrokenIrps);
+
     //  Grap the synchronization object.
     AcquiredMutex = TRUE;
     ExAcquireFastMutexUnsafe(Oplock->FastMutex);
@@ -1510,10 +1515,8 @@ Return Value:
         } else if (Oplock->OplockState == OplockIIGranted) {
             DebugTrace(0, Dbg, "Breaking all level 2 oplocks\n", 0);
 
-            while (!IsListEmpty(&Oplock->IrpOplocksII)) {
-                //  Remove and complete this Irp with STATUS_SUCCESS.
-                FsRtlRemoveAndCompleteIrp(Oplock->IrpOplocksII.Flink);
-            }
+            //  Take all the Irps off the oplock at once, they are completed with STATUS_SUCCESS once the mutex is released.
+            FsRtlRemoveOplockIIIrps(Oplock, &BrokenIrps);
 
             //  Set the oplock state to no oplocks held.
             Oplock->OplockState = NoOplocksHeld;
@@ -1562,6 +1565,9 @@ Return Value:
         DebugTrace(-1, Dbg, "CheckOplockBreakToNone:  Exit -> %08lx\n", Status);
     }
 
+    //  Notify the level II holders now that other operations on the file are no longer held up behind us.
+    FsRtlCompleteOplockIIIrps(&BrokenIrps);
+
     return Status;
 }
 
@@ -1603,6 +1609,68 @@ Arguments:
 }
 
 
+//  Local support routine.
+
+VOID FsRtlRemoveOplockIIIrps(IN OUT PNONOPAQUE_OPLOCK Oplock, OUT PLIST_ENTRY IrpList)
+/*
+Routine Description:
+    This routine is called with the oplock mutex held to take every level II oplock Irp off the oplock in a single step.
+    The cancel routines of all the Irps are cleared under one acquisition of the cancel spinlock rather than one per Irp,
+    and the Irps are moved onto the caller's list to be completed by FsRtlCompleteOplockIIIrps after the mutex is released.
+    A cancel routine that already started will find its Irp gone from the oplock, and the Irp is completed as cancelled instead.
+Arguments:
+    Oplock - Supplies the oplock whose level II Irps are to be removed.
+    IrpList - Supplies an empty list head which receives the Irps.
+*/
+{
+    PLIST_ENTRY Link;
+    KIRQL CancelIrql;
+
+    if (IsListEmpty(&Oplock->IrpOplocksII)) {
+        return;
+    }
+
+    IoAcquireCancelSpinLock(&CancelIrql);
+    for (Link = Oplock->IrpOplocksII.Flink; Link != &Oplock->IrpOplocksII; Link = Link->Flink) {
+        IoSetCancelRoutine(CONTAINING_RECORD(Link, IRP, Tail.Overlay.ListEntry), NULL);
+    }
+    IoReleaseCancelSpinLock(CancelIrql);
+
+    IrpList->Flink = Oplock->IrpOplocksII.Flink;
+    IrpList->Blink = Oplock->IrpOplocksII.Blink;
+    IrpList->Flink->Blink = IrpList;
+    IrpList->Blink->Flink = IrpList;
+    InitializeListHead(&Oplock->IrpOplocksII);
+}
+
+
+//  Local support routine.
+
+VOID FsRtlCompleteOplockIIIrps(IN PLIST_ENTRY IrpList)
+/*
+Routine Description:
+    This routine completes the level II oplock Irps removed by FsRtlRemoveOplockIIIrps,
+    with STATUS_CANCELLED if the Irp has been cancelled, STATUS_SUCCESS otherwise.
+    It must be called without the oplock mutex held.
+Arguments:
+    IrpList - Supplies the list of Irps to complete.
+*/
+{
+    PIRP Irp;
+    PIO_STACK_LOCATION OplockIIIrpSp;
+
+    while (!IsListEmpty(IrpList)) {
+        Irp = CONTAINING_RECORD(RemoveHeadList(IrpList), IRP, Tail.Overlay.ListEntry);
+
+        OplockIIIrpSp = IoGetCurrentIrpStackLocation(Irp);
+        ObDereferenceObject(OplockIIIrpSp->FileObject);
+
+        Irp->IoStatus.Information = FILE_OPLOCK_BROKEN_TO_NONE;
+        FsRtlCompleteRequest(Irp, Irp->Cancel ? STATUS_CANCELLED : STATUS_SUCCESS);
+    }
+}
+
+
 //  Local support routine.
 
 NTSTATUS FsRtlWaitOnIrp(IN OUT PNONOPAQUE_OPLOCK Oplock,
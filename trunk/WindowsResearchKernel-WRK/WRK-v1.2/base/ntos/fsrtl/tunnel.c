@@ -79,6 +79,11 @@ PAGED_LOOKASIDE_LIST    TunnelLookasideList;
 #define TUNNEL_FLAG_NON_LOOKASIDE    0x1
 #define TUNNEL_FLAG_KEY_SHORT        0x2
 
+//  The most aged entries a single cache operation will expire.
+//  A burst of deletes followed by a quiet period would otherwise leave the next operation to expire the whole cache while holding the mutex.
+//  Aged entries left behind are ignored by lookups and picked up by the following operations.
+#define TUNNEL_PRUNE_BATCH           16
+
 //  A node of tunneled information in the cache
 
 //  A TUNNEL is allocated in each VCB and initialized at mount time.
@@ -136,6 +141,22 @@ Return Value:
 }
 
 
+INLINE BOOLEAN FsRtlIsTunnelNodeExpired(PTUNNEL_NODE Node, PLARGE_INTEGER CurrentTime)
+/*
+Routine Description:
+    Check whether a node has aged out of the cache.
+    We have to check for future time because the clock may jump as a result of hard clock change.
+Arguments:
+    Node            - a tunnel node
+    CurrentTime     - the current system time
+Return Value:
+    TRUE if the node is older than TunnelMaxAge or was created in the future
+*/
+{
+    return (BOOLEAN)(Node->CreateTime.QuadPart < CurrentTime->QuadPart - (LONGLONG)TunnelMaxAge || Node->CreateTime.QuadPart > CurrentTime->QuadPart);
+}
+
+
 INLINE VOID FsRtlFreeTunnelNode(PTUNNEL_NODE Node, PLIST_ENTRY FreePoolList OPTIONAL)
 /*
 Routine Description:
@@ -564,6 +585,7 @@ Return Value:
     PTUNNEL_NODE Node = NULL;
     LONG Compare;
     LIST_ENTRY FreePoolList;
+    LARGE_INTEGER CurrentTime;
 
     BOOLEAN Status = FALSE;
 
@@ -595,6 +617,16 @@ Return Value:
         }
     }
 
+    //  The prune above is bounded, so the entry may have aged out without being expired yet.
+    //  Don't hand out old data; drop the entry now instead.
+    if (Links) {
+        KeQuerySystemTime(&CurrentTime);
+        if (FsRtlIsTunnelNodeExpired(Node, &CurrentTime)) {
+            FsRtlRemoveNodeFromTunnel(Cache, Node, &FreePoolList, NULL);
+            Links = NULL;
+        }
+    }
+
     try {
         if (Links) {
             //  Copy node data into caller's area
@@ -748,28 +780,27 @@ Routine Description:
     Pool memory is returned on a list for deletion by the calling routine at a time of its choosing.
 
     For performance reasons we don't want to force freeing of memory inside a mutex.
+    For the same reason at most TUNNEL_PRUNE_BATCH aged entries are expired per call, so the cost of aging is spread over the operations on the cache.
 Arguments:
     Cache - the tunnel cache to prune
     FreePoolList - a list to queue pool memory on to
 */
 {
     PTUNNEL_NODE Node;
-    LARGE_INTEGER ExpireTime;
     LARGE_INTEGER CurrentTime;
     BOOLEAN Splay = TRUE;
+    ULONG Expired = 0;
 
     PAGED_CODE();
 
-    //  Calculate the age of the oldest entry we want to keep
     KeQuerySystemTime(&CurrentTime);
-    ExpireTime.QuadPart = CurrentTime.QuadPart - TunnelMaxAge;
 
     //  Expire old entries off of the timer queue.
-    //  We have to check for future time because the clock may jump as a result of hard clock change.
-    //  If we did not do this, a rogue entry with a future time could sit at the top of the queue and prevent entries from going away.
-    while (!IsListEmpty(&Cache->TimerQueue)) {
+    //  If we did not check for future time, a rogue entry with a future time could sit at the top of the queue and prevent entries from going away.
+    while (!IsListEmpty(&Cache->TimerQueue) && Expired < TUNNEL_PRUNE_BATCH) {
         Node = CONTAINING_RECORD(Cache->TimerQueue.Flink, TUNNEL_NODE, ListLinks);
-        if (Node->CreateTime.QuadPart < ExpireTime.QuadPart || Node->CreateTime.QuadPart > CurrentTime.QuadPart) {
+        if (FsRtlIsTunnelNodeExpired(Node, &CurrentTime)) {
+            Expired += 1;
             FsRtlRemoveNodeFromTunnel(Cache, Node, FreePoolList, &Splay);
         } else {
             //  No more nodes to be expired
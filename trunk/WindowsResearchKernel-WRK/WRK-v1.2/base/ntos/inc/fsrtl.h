@@ -69,6 +69,8 @@ typedef FSRTL_COMMON_FCB_HEADER *PFSRTL_COMMON_FCB_HEADER;
 
 //  We start out by prefixing this structure with the normal FsRtl header from above, which we have to do two different ways for c++ or c.
 
+#define FSRTL_FILTER_CONTEXT_HINTS      (4)
+
 #ifdef __cplusplus
 typedef struct _FSRTL_ADVANCED_FCB_HEADER:FSRTL_COMMON_FCB_HEADER {
 #else   // __cplusplus
@@ -87,6 +89,11 @@ typedef struct _FSRTL_ADVANCED_FCB_HEADER {
     // This is a pointer to a list of context structures belonging to filesystem filter drivers that are linked above the filesystem.
     // Each structure is headed by FSRTL_FILTER_CONTEXT.
     LIST_ENTRY FilterContexts;
+
+    //  The following field is supported only if Flags2 contains FSRTL_FLAG2_FILTER_CONTEXT_HINTS.
+    //  It remembers a context of the list per hash of OwnerId, so that a filter usually finds its context without walking past those of the other filters.
+    //  It is protected by the FastMutex and only maintained by the FsRtl PerStream Context routines.
+    struct _FSRTL_PER_STREAM_CONTEXT *FilterContextHints[FSRTL_FILTER_CONTEXT_HINTS];
 } FSRTL_ADVANCED_FCB_HEADER;
 typedef FSRTL_ADVANCED_FCB_HEADER *PFSRTL_ADVANCED_FCB_HEADER;
 
@@ -126,6 +133,10 @@ typedef FSRTL_ADVANCED_FCB_HEADER *PFSRTL_ADVANCED_FCB_HEADER;
 //  If this flag is set, the cache manager will flush and purge the cache map when a user first maps a file
 #define FSRTL_FLAG2_PURGE_WHEN_MAPPED (0x04)
 
+//  If this flag is set, the FilterContextHints field is supported in FSRTL_ADVANCED_FCB_HEADER.
+//  It is set by FsRtlSetupAdvancedHeader, so headers initialized by hand never have their hints consulted.
+#define FSRTL_FLAG2_FILTER_CONTEXT_HINTS (0x08)
+
 //  The following constants are used to block top level Irp processing when (in either the fast io or cc case) file system resources have been
 //  acquired above the file system, or we are in an Fsp thread.
 
@@ -282,7 +293,11 @@ typedef struct _FILE_LOCK {
     //  FastIoIsQuestionable is set to true whenever the filesystem require additional checking about whether the fast path can be taken.
     //  As an example Ntfs requires checking for disk space before the writes can occur.
     BOOLEAN FastIoIsQuestionable;
-    BOOLEAN SpareC[3];
+
+    //  LocksPresent is set while any byte range is locked, so that the check routines can skip the lock queue of an unlocked file.
+    //  Unlike FastIoIsQuestionable it is cleared again when the last lock is released.
+    BOOLEAN LocksPresent;
+    BOOLEAN SpareC[2];
 
     PVOID   LockInformation;//  FsRtl lock information
 
@@ -374,7 +389,7 @@ FsRtlPrivateLock (
 )
 
 //  BOOLEAN FsRtlAreThereCurrentFileLocks (IN PFILE_LOCK FileLock);
-#define FsRtlAreThereCurrentFileLocks(FL) (((FL)->FastIoIsQuestionable))
+#define FsRtlAreThereCurrentFileLocks(FL) (((FL)->LocksPresent))
 
 
 //  Filesystem property tunneling, implemented in tunnel.c
@@ -858,7 +873,10 @@ NTKERNELAPI PFSRTL_PER_STREAM_CONTEXT FsRtlRemovePerStreamContext (__in PFSRTL_A
 {                                                                           \
     SetFlag( (_advhdr)->Flags, FSRTL_FLAG_ADVANCED_HEADER );                \
     SetFlag( (_advhdr)->Flags2, FSRTL_FLAG2_SUPPORTS_FILTER_CONTEXTS );     \
+    SetFlag( (_advhdr)->Flags2, FSRTL_FLAG2_FILTER_CONTEXT_HINTS );         \
     InitializeListHead( &(_advhdr)->FilterContexts );                       \
+    RtlZeroMemory( (_advhdr)->FilterContextHints,                           \
+                   sizeof( (_advhdr)->FilterContextHints ) );               \
     if ((_fmutx) != NULL) {                                                 \
         (_advhdr)->FastMutex = (_fmutx);                                    \
     }                                                                       \
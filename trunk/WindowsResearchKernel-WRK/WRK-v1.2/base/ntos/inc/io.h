@@ -1094,6 +1094,8 @@ typedef struct _DEVICE_OBJECT *PDEVICE_OBJECT; // ntndis
 #define DOE_STARTIO_CANCELABLE          0x00000080
 #define DOE_STARTIO_DEFERRED            0x00000100  // Use non-recursive startio
 #define DOE_STARTIO_NO_CANCEL           0x00000200  // Pass non-cancelable IRP to startio
+#define DOE_STARTIO_PRIORITY            0x00000400  // Queue unkeyed IRPs by I/O priority deadline
+#define DOE_FAST_IO_PASS_THROUGH        0x00000800  // Cached reads and writes skip this filter, see IoSetFastIoPassThrough
 
 // begin_ntddk begin_nthal begin_ntifs begin_wdm begin_ntosp
 
@@ -1136,6 +1138,8 @@ typedef struct _DEVOBJ_EXTENSION
     PVPB           Vpb;                // If not NULL contains the VPB of the mounted volume.
                                        // Set in the filesystem's volume device object.
                                        // This is a reverse VPB pointer.
+    struct _IOP_CREATE_CACHE *CreateCache;  // Negative create cache of a file system volume device object, see IoEnableCreateCache.
+    struct _IOP_LATENCY_HISTOGRAM *LatencyHistogram;    // Per processor request latency histograms, see IoEnableLatencyHistogram.
 
 // begin_ntddk begin_wdm begin_nthal begin_ntifs begin_ntosp
 } DEVOBJ_EXTENSION, *PDEVOBJ_EXTENSION;
@@ -1354,6 +1358,10 @@ typedef struct _FILE_OBJECT *PFILE_OBJECT; // ntndis
 #define IRP_RETRY_IO_COMPLETION         0x00004000
 #define IRP_HIGH_PRIORITY_PAGING_IO     0x00008000
 
+// The I/O priority hint of the packet, plus one, so that zero means no hint was assigned.  Use IoGetIoPriorityHint and IoSetIoPriorityHint.
+#define IRP_PRIORITY_MASK               0x00070000
+#define IRP_PRIORITY_SHIFT              16
+
 
 // Mask currently used by verifier. This should be made 1 flag in the
 // next release.
@@ -1373,6 +1381,7 @@ typedef struct _FILE_OBJECT *PFILE_OBJECT; // ntndis
 #define IRP_ALLOCATED_MUST_SUCCEED      0x02
 #define IRP_ALLOCATED_FIXED_SIZE        0x04
 #define IRP_LOOKASIDE_ALLOCATION        0x08
+#define IRP_ALLOCATED_FROM_CACHE        0x10
 
 
 // I/O Request Packet (IRP) definition
@@ -2083,6 +2092,14 @@ typedef struct _SHARE_ACCESS
 
 // end_wdm
 
+// Define the packed share access state of a file.
+// It is an alternative to SHARE_ACCESS that is checked and updated with a single interlocked operation,
+// so a file system can admit opens and account for closes without holding its FCB lock.
+// See IoCheckShareAccessState and IoRemoveShareAccessState.
+typedef struct _SHARE_ACCESS_STATE {
+    LONG64 volatile State;
+} SHARE_ACCESS_STATE, *PSHARE_ACCESS_STATE;
+
 
 // The following structure is used by drivers that are initializing to determine the number of devices of a particular type that have already been initialized.
 // It is also used to track whether or not the AtDisk address range has already been claimed.
@@ -2355,6 +2372,17 @@ NTKERNELAPI NTSTATUS IoCheckShareAccess(
     IN OUT PSHARE_ACCESS ShareAccess,
     IN BOOLEAN Update);
 
+// end_ntddk end_wdm end_nthal end_ntosp
+
+NTKERNELAPI NTSTATUS IoCheckShareAccessState(
+    IN ACCESS_MASK DesiredAccess,
+    IN ULONG DesiredShareAccess,
+    IN OUT PFILE_OBJECT FileObject,
+    IN OUT PSHARE_ACCESS_STATE ShareState,
+    IN BOOLEAN Update);
+
+// begin_ntddk begin_wdm begin_nthal begin_ntosp
+
 // This value should be returned from completion routines to continue completing the IRP upwards.
 // Otherwise, STATUS_MORE_PROCESSING_REQUIRED should be returned.
 #define STATUS_CONTINUE_COMPLETION      STATUS_SUCCESS
@@ -2387,6 +2415,27 @@ NTKERNELAPI NTSTATUS IoConnectInterrupt(
 
 // end_wdm
 
+// Define the interrupt of one queue of a multi-queue device, as connected by IoConnectQueueInterrupts.
+typedef struct _IO_QUEUE_INTERRUPT {
+    ULONG Vector;                       // Supplies the translated vector of the queue's interrupt.
+    PVOID ServiceContext;               // Supplies the context passed to the ISR for the queue.
+    PKINTERRUPT InterruptObject;        // Receives the interrupt object of the queue.
+    ULONG Processor;                    // Receives the processor the queue's interrupt is bound to.
+} IO_QUEUE_INTERRUPT, *PIO_QUEUE_INTERRUPT;
+
+typedef struct _IO_DPC_STEERING *PIO_DPC_STEERING;
+
+NTKERNELAPI NTSTATUS IoConnectQueueInterrupts(IN PKSERVICE_ROUTINE ServiceRoutine,
+                                              IN OUT PIO_QUEUE_INTERRUPT Queues,
+                                              IN ULONG QueueCount,
+                                              IN KIRQL Irql,
+                                              IN KINTERRUPT_MODE InterruptMode,
+                                              IN BOOLEAN ShareVector);
+NTKERNELAPI VOID IoDisconnectQueueInterrupts(IN PIO_QUEUE_INTERRUPT Queues, IN ULONG QueueCount);
+NTKERNELAPI NTSTATUS IoCreateDpcSteering(IN PDEVICE_OBJECT DeviceObject, IN PIO_DPC_ROUTINE DpcRoutine, OUT PIO_DPC_STEERING *Steering);
+NTKERNELAPI VOID IoDeleteDpcSteering(IN PIO_DPC_STEERING Steering);
+NTKERNELAPI BOOLEAN IoRequestSteeredDpc(IN PIO_DPC_STEERING Steering, IN ULONG TargetProcessor, IN PIRP Irp, IN PVOID Context);
+
 NTKERNELAPI PCONTROLLER_OBJECT IoCreateController(IN ULONG Size);
 
 // begin_wdm begin_ntifs
@@ -2758,6 +2807,9 @@ NTKERNELAPI VOID IoRegisterDriverReinitialization(IN PDRIVER_OBJECT DriverObject
 
 NTKERNELAPI VOID IoRegisterFileSystem(IN OUT PDEVICE_OBJECT DeviceObject);
 NTKERNELAPI NTSTATUS IoRegisterFsRegistrationChange(IN PDRIVER_OBJECT DriverObject, IN PDRIVER_FS_NOTIFICATION DriverNotificationRoutine);
+NTKERNELAPI NTSTATUS IoEnableCreateCache(IN PDEVICE_OBJECT VolumeDeviceObject);
+NTKERNELAPI VOID IoInvalidateCreateCache(IN PDEVICE_OBJECT VolumeDeviceObject);
+NTKERNELAPI VOID IoSetFastIoPassThrough(IN PDEVICE_OBJECT FilterDeviceObject, IN BOOLEAN PassThrough);
 NTKERNELAPI NTSTATUS IoEnumerateRegisteredFiltersList(IN  PDRIVER_OBJECT *DriverObjectList,
                                                       IN  ULONG          DriverObjectListSize,   //in bytes
                                                       OUT PULONG         ActualNumberDriverObjects
@@ -2777,6 +2829,7 @@ NTKERNELAPI VOID IoReleaseVpbSpinLock(IN KIRQL Irql);
 // begin_ntddk begin_nthal begin_ntosp
 
 NTKERNELAPI VOID IoRemoveShareAccess(IN PFILE_OBJECT FileObject, IN OUT PSHARE_ACCESS ShareAccess);
+NTKERNELAPI VOID IoRemoveShareAccessState(IN PFILE_OBJECT FileObject, IN OUT PSHARE_ACCESS_STATE ShareState);
 
 // end_ntddk end_ntifs end_ntosp
 
@@ -3083,6 +3136,21 @@ NTKERNELAPI VOID IoStartNextPacket(IN PDEVICE_OBJECT DeviceObject, IN BOOLEAN Ca
 NTKERNELAPI VOID IoStartNextPacketByKey(IN PDEVICE_OBJECT DeviceObject, IN BOOLEAN Cancelable, IN ULONG Key);
 NTKERNELAPI VOID IoStartPacket(IN PDEVICE_OBJECT DeviceObject, IN PIRP Irp, IN PULONG Key OPTIONAL, IN PDRIVER_CANCEL CancelFunction OPTIONAL);
 VOID IoSetStartIoAttributes(IN PDEVICE_OBJECT DeviceObject, IN BOOLEAN DeferredStartIo, IN BOOLEAN NonCancelable);
+NTKERNELAPI VOID IoSetStartIoPriorityQueueing(IN PDEVICE_OBJECT DeviceObject, IN BOOLEAN PriorityQueueing);
+
+// Define the request latency histogram of a device, as returned by IoQueryDeviceLatencyHistogram and IoQueryDriverLatencyHistogram.
+// Latency is measured in processor cycles, from when a request is passed to the device by IoCallDriver to when a driver first calls IoCompleteRequest for it.
+// Bucket zero counts requests that took fewer than 2^10 cycles, bucket N those that took at least 2^(N+9) and fewer than 2^(N+10) cycles,
+// and the last bucket every request that took longer.
+#define IO_LATENCY_HISTOGRAM_BUCKETS    24
+
+typedef struct _IO_LATENCY_HISTOGRAM {
+    ULONG Count[IRP_MJ_MAXIMUM_FUNCTION + 1][IO_LATENCY_HISTOGRAM_BUCKETS];
+} IO_LATENCY_HISTOGRAM, *PIO_LATENCY_HISTOGRAM;
+
+NTKERNELAPI NTSTATUS IoEnableLatencyHistogram(IN PDEVICE_OBJECT DeviceObject);
+NTKERNELAPI VOID IoQueryDeviceLatencyHistogram(IN PDEVICE_OBJECT DeviceObject, OUT PIO_LATENCY_HISTOGRAM Histogram);
+NTKERNELAPI NTSTATUS IoQueryDriverLatencyHistogram(IN PDRIVER_OBJECT DriverObject, OUT PIO_LATENCY_HISTOGRAM Histogram);
 
 // begin_ntifs
 
@@ -3649,6 +3717,8 @@ NTKERNELAPI NTSTATUS IoValidateDeviceIoControlAccess(IN  PIRP Irp, IN ULONG Requ
 // end_wdm
 
 NTKERNELAPI IO_PAGING_PRIORITY FASTCALL IoGetPagingIoPriority(IN PIRP IRP);
+NTKERNELAPI IO_PRIORITY_HINT IoGetIoPriorityHint(IN PIRP Irp);
+NTKERNELAPI NTSTATUS IoSetIoPriorityHint(IN PIRP Irp, IN IO_PRIORITY_HINT PriorityHint);
 
 // end_ntosp end_ntifs end_ntddk end_wdm
 
@@ -1185,6 +1185,7 @@ NTKERNELAPI VOID KeFlushQueuedDpcs (VOID);
 NTKERNELAPI VOID KeInitializeDeviceQueue (__out PKDEVICE_QUEUE DeviceQueue);
 NTKERNELAPI BOOLEAN KeInsertDeviceQueue (__inout PKDEVICE_QUEUE DeviceQueue, __inout PKDEVICE_QUEUE_ENTRY DeviceQueueEntry);
 NTKERNELAPI BOOLEAN KeInsertByKeyDeviceQueue (__inout PKDEVICE_QUEUE DeviceQueue, __inout PKDEVICE_QUEUE_ENTRY DeviceQueueEntry, __in ULONG SortKey);
+BOOLEAN KeInsertByDeadlineDeviceQueue (__inout PKDEVICE_QUEUE DeviceQueue, __inout PKDEVICE_QUEUE_ENTRY DeviceQueueEntry, __in ULONG Deadline);
 NTKERNELAPI PKDEVICE_QUEUE_ENTRY KeRemoveDeviceQueue (__inout PKDEVICE_QUEUE DeviceQueue);
 NTKERNELAPI PKDEVICE_QUEUE_ENTRY KeRemoveByKeyDeviceQueue (__inout PKDEVICE_QUEUE DeviceQueue, __in ULONG SortKey);
 NTKERNELAPI PKDEVICE_QUEUE_ENTRY KeRemoveByKeyDeviceQueueIfBusy (__inout PKDEVICE_QUEUE DeviceQueue, __in ULONG SortKey);
@@ -1312,6 +1313,7 @@ NTKERNELAPI LONG KeReadStateQueue (__in PRKQUEUE Queue);
 NTKERNELAPI LONG KeInsertQueue (__inout PRKQUEUE Queue, __inout PLIST_ENTRY Entry);
 NTKERNELAPI LONG KeInsertHeadQueue (__inout PRKQUEUE Queue, __inout PLIST_ENTRY Entry);
 NTKERNELAPI PLIST_ENTRY KeRemoveQueue (__inout PRKQUEUE Queue, __in KPROCESSOR_MODE WaitMode, __in_opt PLARGE_INTEGER Timeout);
+NTKERNELAPI ULONG KeRemoveQueueEx (__inout PRKQUEUE Queue, __in KPROCESSOR_MODE WaitMode, __in_opt PLARGE_INTEGER Timeout, __out_ecount(Count) PLIST_ENTRY *EntryArray, __in ULONG Count);
 NTKERNELAPI PLIST_ENTRY KeRundownQueue (__inout PRKQUEUE Queue);
 
 // begin_ntddk begin_wdm
@@ -721,6 +721,22 @@ NTKERNELAPI BOOLEAN ObCheckObjectAccess(
     __out PNTSTATUS AccessStatus
     );
 
+// end_ntosp
+
+BOOLEAN ObCachedAccessCheck(
+    IN PSECURITY_DESCRIPTOR SecurityDescriptor OPTIONAL,
+    IN PSECURITY_SUBJECT_CONTEXT SubjectSecurityContext,
+    IN ACCESS_MASK DesiredAccess,
+    IN ACCESS_MASK PreviouslyGrantedAccess,
+    OUT PPRIVILEGE_SET *Privileges,
+    IN POBJECT_TYPE ObjectType,
+    IN KPROCESSOR_MODE AccessMode,
+    OUT PACCESS_MASK GrantedAccess,
+    OUT PNTSTATUS AccessStatus
+    );
+
+// begin_ntosp
+
 
 NTKERNELAPI NTSTATUS ObAssignSecurity(
     __in PACCESS_STATE AccessState,
@@ -485,6 +485,9 @@ NTKERNELAPI VOID SeCaptureSubjectContext (__out PSECURITY_SUBJECT_CONTEXT Subjec
 NTKERNELAPI VOID SeLockSubjectContext(__in PSECURITY_SUBJECT_CONTEXT SubjectContext);
 NTKERNELAPI VOID SeUnlockSubjectContext(__in PSECURITY_SUBJECT_CONTEXT SubjectContext);
 NTKERNELAPI VOID SeReleaseSubjectContext (__inout PSECURITY_SUBJECT_CONTEXT SubjectContext);
+// end_ntifs
+BOOLEAN SeQuerySubjectContextTokenIds(__in PSECURITY_SUBJECT_CONTEXT SubjectContext, __out PLUID TokenId, __out PLUID ModifiedId);
+// begin_ntifs
 NTSTATUS SeCaptureAuditPolicy(
     __in PTOKEN_AUDIT_POLICY Policy,
     __in KPROCESSOR_MODE RequestorMode,
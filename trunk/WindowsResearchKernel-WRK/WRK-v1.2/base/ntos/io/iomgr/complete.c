@@ -16,12 +16,18 @@ Abstract:
 
 // Define forward referenced function prototypes.
 VOID IopFreeMiniPacket(PIOP_MINI_COMPLETION_PACKET MiniPacket);
+VOID IopCaptureCompletionPacket(IN PLIST_ENTRY Entry, OUT PFILE_IO_COMPLETION_INFORMATION CompletionInformation);
+
+// Define the maximum number of entries removed by a single call to NtRemoveIoCompletionEx.
+#define IOP_MAXIMUM_COMPLETION_BATCH 64
 
 // Define section types for appropriate functions.
 #pragma alloc_text(PAGE, NtCreateIoCompletion)
 #pragma alloc_text(PAGE, NtOpenIoCompletion)
 #pragma alloc_text(PAGE, NtQueryIoCompletion)
 #pragma alloc_text(PAGE, NtRemoveIoCompletion)
+#pragma alloc_text(PAGE, NtRemoveIoCompletionEx)
+#pragma alloc_text(PAGE, IopCaptureCompletionPacket)
 #pragma alloc_text(PAGE, NtSetIoCompletion)
 #pragma alloc_text(PAGE, IoSetIoCompletion)
 #pragma alloc_text(PAGE, IopFreeMiniPacket)
@@ -262,14 +268,10 @@ NTSTATUS NtRemoveIoCompletion(__in HANDLE IoCompletionHandle,
     PLARGE_INTEGER CapturedTimeout;
     PLIST_ENTRY Entry;
     PVOID IoCompletion;
-    PIRP Irp;
     KPROCESSOR_MODE PreviousMode;
     NTSTATUS Status;
     LARGE_INTEGER TimeoutValue;
-    PVOID LocalApcContext;
-    PVOID LocalKeyContext;
-    IO_STATUS_BLOCK LocalIoStatusBlock;
-    PIOP_MINI_COMPLETION_PACKET MiniPacket;
+    FILE_IO_COMPLETION_INFORMATION CompletionInformation;
 
     // Establish an exception handler, probe the I/O context, the I/O status, and the optional timeout value if specified,
     // reference the I/O completion object, and attempt to remove an entry from the I/O completion object.
@@ -307,24 +309,10 @@ NTSTATUS NtRemoveIoCompletion(__in HANDLE IoCompletionHandle,
             } else {
                 Status = STATUS_SUCCESS;// Set the completion status, capture the completion information, 
                 try {
-                    MiniPacket = CONTAINING_RECORD(Entry, IOP_MINI_COMPLETION_PACKET, ListEntry);
-                    if (MiniPacket->PacketType == IopCompletionPacketIrp) {
-                        Irp = CONTAINING_RECORD(Entry, IRP, Tail.Overlay.ListEntry);
-                        LocalApcContext = Irp->Overlay.AsynchronousParameters.UserApcContext;
-                        LocalKeyContext = (PVOID)Irp->Tail.CompletionKey;
-                        LocalIoStatusBlock = Irp->IoStatus;
-                        IoFreeIrp(Irp);//deallocate the associated IRP, 
-                    } else {
-                        LocalApcContext = MiniPacket->ApcContext;
-                        LocalKeyContext = (PVOID)MiniPacket->KeyContext;
-                        LocalIoStatusBlock.Status = MiniPacket->IoStatus;
-                        LocalIoStatusBlock.Information = MiniPacket->IoStatusInformation;
-                        IopFreeMiniPacket(MiniPacket);
-                    }
-
-                    *ApcContext = LocalApcContext;//and attempt to write the completion information.
-                    *KeyContext = LocalKeyContext;
-                    *IoStatusBlock = LocalIoStatusBlock;
+                    IopCaptureCompletionPacket(Entry, &CompletionInformation);//deallocate the associated packet, 
+                    *ApcContext = CompletionInformation.ApcContext;//and attempt to write the completion information.
+                    *KeyContext = CompletionInformation.KeyContext;
+                    *IoStatusBlock = CompletionInformation.IoStatusBlock;
                 } except(ExSystemExceptionFilter())
                 {// If the write of the completion information fails, then do not report an error.
                     NOTHING;// When the caller attempts to access the completion information, an access violation will occur.
@@ -342,6 +330,139 @@ NTSTATUS NtRemoveIoCompletion(__in HANDLE IoCompletionHandle,
 }
 
 
+NTSTATUS NtRemoveIoCompletionEx(__in HANDLE IoCompletionHandle,
+                                __out_ecount(Count) PFILE_IO_COMPLETION_INFORMATION IoCompletionInformation,
+                                __in ULONG Count,
+                                __out PULONG NumEntriesRemoved,
+                                __in_opt PLARGE_INTEGER Timeout
+)
+/*
+Routine Description:
+    This function removes one or more entries from an I/O completion object with a single system call.
+    If there are currently no entries available, then the calling thread waits for an entry.
+    Once one entry has been removed, any other entries already queued are removed without waiting.
+Arguments:
+    IoCompletionHandle - Supplies a handle to an I/O completion object.
+    IoCompletionInformation - Supplies a pointer to an array that receives the key context, apc context, and I/O status of each entry removed.
+    Count - Supplies the number of elements in the array. At most IOP_MAXIMUM_COMPLETION_BATCH entries are removed per call.
+    NumEntriesRemoved - Supplies a pointer to a variable that receives the number of entries removed.
+    Timeout - Supplies a pointer to an optional time out value.
+Return Value:
+    STATUS_SUCCESS is returned if at least one entry is removed. Otherwise, an error status is returned.
+*/
+{
+    PLARGE_INTEGER CapturedTimeout;
+    PLIST_ENTRY EntryArray[IOP_MAXIMUM_COMPLETION_BATCH];
+    PVOID IoCompletion;
+    KPROCESSOR_MODE PreviousMode;
+    NTSTATUS Status;
+    LARGE_INTEGER TimeoutValue;
+    FILE_IO_COMPLETION_INFORMATION CompletionInformation;
+    ULONG Index;
+    ULONG Removed;
+
+    PAGED_CODE();
+
+    if (Count == 0) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    if (Count > IOP_MAXIMUM_COMPLETION_BATCH) {
+        Count = IOP_MAXIMUM_COMPLETION_BATCH;
+    }
+
+    // Establish an exception handler, probe the output array, the entry count, and the optional timeout value if specified,
+    // reference the I/O completion object, and attempt to remove entries from the I/O completion object.
+    try {
+        // Get previous processor mode and probe the output array, count, and timeout if necessary.
+        CapturedTimeout = NULL;
+        PreviousMode = KeGetPreviousMode();
+        if (PreviousMode != KernelMode) {
+            ProbeForWrite(IoCompletionInformation, Count * sizeof(FILE_IO_COMPLETION_INFORMATION), sizeof(ULONG_PTR));
+            ProbeForWriteUlong(NumEntriesRemoved);
+            if (ARGUMENT_PRESENT(Timeout)) {
+                CapturedTimeout = &TimeoutValue;
+                TimeoutValue = ProbeAndReadLargeInteger(Timeout);
+            }
+        } else {
+            if (ARGUMENT_PRESENT(Timeout)) {
+                CapturedTimeout = Timeout;
+            }
+        }
+
+        *NumEntriesRemoved = 0;
+    } except(ExSystemExceptionFilter())
+    {
+        return GetExceptionCode();
+    }
+
+    // Reference the I/O completion object by handle.
+    Status = ObReferenceObjectByHandle(IoCompletionHandle, IO_COMPLETION_MODIFY_STATE, IoCompletionObjectType, PreviousMode, &IoCompletion, NULL);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    // N.B. The first entry value returned can be STATUS_USER_APC or STATUS_TIMEOUT, in which case it is the only value returned.
+    Removed = KeRemoveQueueEx((PKQUEUE)IoCompletion, PreviousMode, CapturedTimeout, EntryArray, Count);
+    if (((LONG_PTR)EntryArray[0] == STATUS_TIMEOUT) || ((LONG_PTR)EntryArray[0] == STATUS_USER_APC)) {
+        Status = (NTSTATUS)((LONG_PTR)EntryArray[0]);
+    } else {
+        // Capture the completion information and release each packet, then attempt to write the completion information.
+        // If the write of the completion information fails, then do not report an error.
+        // When the caller attempts to access the completion information, an access violation will occur.
+        Status = STATUS_SUCCESS;
+        for (Index = 0; Index < Removed; Index += 1) {
+            IopCaptureCompletionPacket(EntryArray[Index], &CompletionInformation);
+            try {
+                IoCompletionInformation[Index] = CompletionInformation;
+            } except(ExSystemExceptionFilter())
+            {
+                NOTHING;
+            }
+        }
+
+        try {
+            *NumEntriesRemoved = Removed;
+        } except(ExSystemExceptionFilter())
+        {
+            NOTHING;
+        }
+    }
+
+    ObDereferenceObject(IoCompletion);// Deference I/O completion object.
+    return Status;
+}
+
+
+VOID IopCaptureCompletionPacket(IN PLIST_ENTRY Entry, OUT PFILE_IO_COMPLETION_INFORMATION CompletionInformation)
+/*
+Routine Description:
+    This function captures the completion information of an entry removed from an I/O completion object and releases the entry.
+Arguments:
+    Entry - Supplies the list entry of the IRP or minipacket that was removed from the I/O completion object.
+    CompletionInformation - Supplies a pointer to a kernel buffer that receives the key context, apc context, and I/O status.
+*/
+{
+    PIRP Irp;
+    PIOP_MINI_COMPLETION_PACKET MiniPacket;
+
+    MiniPacket = CONTAINING_RECORD(Entry, IOP_MINI_COMPLETION_PACKET, ListEntry);
+    if (MiniPacket->PacketType == IopCompletionPacketIrp) {
+        Irp = CONTAINING_RECORD(Entry, IRP, Tail.Overlay.ListEntry);
+        CompletionInformation->ApcContext = Irp->Overlay.AsynchronousParameters.UserApcContext;
+        CompletionInformation->KeyContext = (PVOID)Irp->Tail.CompletionKey;
+        CompletionInformation->IoStatusBlock = Irp->IoStatus;
+        IoFreeIrp(Irp);
+    } else {
+        CompletionInformation->ApcContext = MiniPacket->ApcContext;
+        CompletionInformation->KeyContext = (PVOID)MiniPacket->KeyContext;
+        CompletionInformation->IoStatusBlock.Status = MiniPacket->IoStatus;
+        CompletionInformation->IoStatusBlock.Information = MiniPacket->IoStatusInformation;
+        IopFreeMiniPacket(MiniPacket);
+    }
+}
+
+
 NTKERNELAPI NTSTATUS IoSetIoCompletion(IN PVOID IoCompletion,
                                        IN PVOID KeyContext, 
                                        IN PVOID ApcContext,
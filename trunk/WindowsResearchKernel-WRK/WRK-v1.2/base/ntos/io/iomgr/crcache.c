@@ -0,0 +1,200 @@
+/*
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+You may only use this code if you agree to the terms of the Windows Research Kernel Source Code License agreement (see License.txt).
+If you do not agree to the terms, do not use the code.
+
+Module Name:
+    crcache.c
+
+Abstract:
+    This module implements the negative create cache of file system volumes.
+    Build tools and search paths repeatedly probe for the same names that do not exist.
+    When the file system of a volume opts in, the I/O system remembers the names it failed to find and fails repeated opens of them
+    in IopParseDevice, without allocating a file object or an IRP or calling the file system.
+    The file system keeps the cache coherent by invalidating it whenever a name may have appeared on the volume.
+*/
+
+#include "iomgr.h"
+
+ULONG IopHashCreateCacheName(IN PUNICODE_STRING Name);
+
+#pragma alloc_text(PAGE, IoEnableCreateCache)
+#pragma alloc_text(PAGE, IoInvalidateCreateCache)
+#pragma alloc_text(PAGE, IopHashCreateCacheName)
+#pragma alloc_text(PAGE, IopLookupCreateCache)
+#pragma alloc_text(PAGE, IopInsertCreateCache)
+
+
+NTSTATUS IoEnableCreateCache(IN PDEVICE_OBJECT VolumeDeviceObject)
+/*
+Routine Description:
+    This routine is invoked by a file system to enable the negative create cache for one of its volume device objects.
+    Once enabled, the file system must call IoInvalidateCreateCache for the volume whenever a file or directory is created, renamed or linked,
+    a directory is deleted, or anything else happens that could make a name that previously did not exist resolve.
+    The cache is only consulted for opens that reach the volume device object directly, so it has no effect while filters are attached above it.
+    The cache is freed along with the device object.
+Arguments:
+    VolumeDeviceObject - Supplies the file system's volume device object.
+Return Value:
+    STATUS_SUCCESS, or STATUS_INSUFFICIENT_RESOURCES if the cache could not be allocated.
+*/
+{
+    PIOP_CREATE_CACHE createCache;
+
+    PAGED_CODE();
+
+    if (VolumeDeviceObject->DeviceObjectExtension->CreateCache) {
+        return STATUS_SUCCESS;
+    }
+
+    createCache = ExAllocatePoolWithTag(PagedPool, sizeof(IOP_CREATE_CACHE), 'cCoI');
+    if (!createCache) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(createCache, sizeof(IOP_CREATE_CACHE));
+    ExInitializePushLock(&createCache->Lock);
+
+    if (InterlockedCompareExchangePointer(&VolumeDeviceObject->DeviceObjectExtension->CreateCache, createCache, NULL) != NULL) {
+        ExFreePool(createCache);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+VOID IoInvalidateCreateCache(IN PDEVICE_OBJECT VolumeDeviceObject)
+/*
+Routine Description:
+    This routine is invoked by a file system to discard every name in the negative create cache of a volume.
+    It must be called after the change that makes a name resolve has become visible to opens of the volume,
+    so that any open that failed before the change, and has yet to record its result, records it under a stale generation.
+    It may be called at IRQL <= APC_LEVEL.
+Arguments:
+    VolumeDeviceObject - Supplies the file system's volume device object.
+*/
+{
+    PIOP_CREATE_CACHE createCache;
+
+    PAGED_CODE();
+
+    createCache = VolumeDeviceObject->DeviceObjectExtension->CreateCache;
+    if (createCache) {
+        InterlockedIncrement(&createCache->Generation);
+    }
+}
+
+
+ULONG IopHashCreateCacheName(IN PUNICODE_STRING Name)
+/*
+Routine Description:
+    This routine computes the hash of a name in the create cache.
+    The hash ignores case so that case sensitive and insensitive lookups of a name fall in the same slot.
+*/
+{
+    ULONG hash = 0;
+    ULONG i;
+
+    PAGED_CODE();
+
+    for (i = 0; i < Name->Length / sizeof(WCHAR); i++) {
+        hash = hash * 37 + RtlUpcaseUnicodeChar(Name->Buffer[i]);
+    }
+
+    return hash + (hash >> 7);
+}
+
+
+BOOLEAN IopLookupCreateCache(IN PIOP_CREATE_CACHE CreateCache, IN PUNICODE_STRING Name, IN BOOLEAN CaseInsensitive, OUT PLONG Generation)
+/*
+Routine Description:
+    This routine looks up a name in the negative create cache of a volume.
+Arguments:
+    CreateCache - Supplies the volume's create cache.
+    Name - Supplies the name being opened, relative to the root of the volume.
+    CaseInsensitive - Supplies whether the open is case insensitive.
+    Generation - Receives the generation of the cache before the lookup.
+        If the open is sent to the file system and fails, this value is passed to IopInsertCreateCache,
+        so that a result that raced with an invalidation is never cached.
+Return Value:
+    TRUE if the name is known not to exist on the volume, FALSE otherwise.
+*/
+{
+    PIOP_CREATE_CACHE_ENTRY entry;
+    UNICODE_STRING entryName;
+    PKTHREAD currentThread;
+    ULONG hash;
+    BOOLEAN found = FALSE;
+
+    PAGED_CODE();
+
+    *Generation = CreateCache->Generation;
+    if (Name->Length > sizeof(entry->Name)) {
+        return FALSE;
+    }
+
+    hash = IopHashCreateCacheName(Name);
+    entry = &CreateCache->Entries[hash & (IOP_CREATE_CACHE_SIZE - 1)];
+
+    currentThread = KeGetCurrentThread();
+    KeEnterCriticalRegionThread(currentThread);
+    ExAcquirePushLockShared(&CreateCache->Lock);
+
+    if (entry->NameLength == Name->Length &&
+        entry->Hash == hash &&
+        entry->Generation == *Generation &&
+        entry->CaseInsensitive == CaseInsensitive) {
+        entryName.Length = entryName.MaximumLength = entry->NameLength;
+        entryName.Buffer = entry->Name;
+        found = RtlEqualUnicodeString(&entryName, Name, CaseInsensitive);
+    }
+
+    ExReleasePushLockShared(&CreateCache->Lock);
+    KeLeaveCriticalRegionThread(currentThread);
+
+    return found;
+}
+
+
+VOID IopInsertCreateCache(IN PIOP_CREATE_CACHE CreateCache, IN PUNICODE_STRING Name, IN BOOLEAN CaseInsensitive, IN LONG Generation)
+/*
+Routine Description:
+    This routine remembers that the file system failed to find a name on the volume.
+    The entry replaces whatever occupied its slot.
+Arguments:
+    CreateCache - Supplies the volume's create cache.
+    Name - Supplies the name that was not found, relative to the root of the volume.
+    CaseInsensitive - Supplies whether the failed open was case insensitive.
+    Generation - Supplies the generation returned by IopLookupCreateCache before the open was sent to the file system.
+*/
+{
+    PIOP_CREATE_CACHE_ENTRY entry;
+    PKTHREAD currentThread;
+    ULONG hash;
+
+    PAGED_CODE();
+
+    if (Name->Length == 0 || Name->Length > sizeof(entry->Name)) {
+        return;
+    }
+
+    hash = IopHashCreateCacheName(Name);
+    entry = &CreateCache->Entries[hash & (IOP_CREATE_CACHE_SIZE - 1)];
+
+    currentThread = KeGetCurrentThread();
+    KeEnterCriticalRegionThread(currentThread);
+    ExAcquirePushLockExclusive(&CreateCache->Lock);
+
+    // The generation is checked under the lock; an invalidation after this point retires the new entry along with the rest.
+    if (CreateCache->Generation == Generation) {
+        entry->Hash = hash;
+        entry->Generation = Generation;
+        entry->NameLength = Name->Length;
+        entry->CaseInsensitive = CaseInsensitive;
+        RtlCopyMemory(entry->Name, Name->Buffer, Name->Length);
+    }
+
+    ExReleasePushLockExclusive(&CreateCache->Lock);
+    KeLeaveCriticalRegionThread(currentThread);
+}
@@ -9,6 +9,8 @@ Module Name:
 
 Abstract:
     This module contains the code for the I/O error log thread.
+    Entries are written to per processor queues without taking a lock, so that a device flooding the error log does not slow the I/O paths of other processors.
+    The error log thread collects the queues in batches and sends the entries to the error log port.
 */
 
 #include "iomgr.h"
@@ -26,6 +28,7 @@ VOID IopErrorLogDpc(IN struct _KDPC *Dpc, IN PVOID DeferredContext, IN PVOID Sys
 PLIST_ENTRY IopErrorLogGetEntry();
 VOID IopErrorLogQueueRequest(VOID);
 VOID IopErrorLogRequeueEntry(IN PLIST_ENTRY ListEntry);
+VOID IopErrorLogFlushQueues(VOID);
 
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text(PAGE, IopErrorLogThread)
@@ -44,8 +47,9 @@ HANDLE ErrorLogPort;
 #pragma  data_seg()
 #endif
 BOOLEAN ErrorLogPortConnected;
-BOOLEAN IopErrorLogPortPending;
+LONG IopErrorLogPortPending;
 BOOLEAN IopErrorLogDisabledThisBoot;
+PIOP_ERROR_LOG_QUEUE IopErrorLogQueues;
 
 // Define the amount of space required for the device and driver names.
 #define IO_ERROR_NAME_LENGTH 100
@@ -402,11 +406,23 @@ Return Value:
     PLIST_ENTRY listEntry;
 
     // Remove the next packet from the queue, if there is one.
+    // When the queue runs dry it is refilled with the entries written to the per processor queues since the last batch.
     ExAcquireSpinLock(&IopErrorLogLock, &irql);
     if (IsListEmpty(&IopErrorLogListHead)) {
-        // Indicate no more work will be done in the context of this worker thread and indicate to the caller that no packets were located.
-        IopErrorLogPortPending = FALSE;
-        listEntry = (PLIST_ENTRY)NULL;
+        IopErrorLogFlushQueues();
+    }
+
+    if (IsListEmpty(&IopErrorLogListHead)) {
+        // Indicate no more work will be done in the context of this worker thread.
+        // An entry written after the queues were collected may have found the work still pending and left it to this thread,
+        // so collect them once more after clearing the flag, and keep going if one turned up and no other request was queued for it.
+        InterlockedExchange(&IopErrorLogPortPending, FALSE);
+        IopErrorLogFlushQueues();
+        if (!IsListEmpty(&IopErrorLogListHead) && InterlockedCompareExchange(&IopErrorLogPortPending, TRUE, FALSE) == FALSE) {
+            listEntry = RemoveHeadList(&IopErrorLogListHead);
+        } else {
+            listEntry = (PLIST_ENTRY)NULL;// Indicate to the caller that no packets were located.
+        }
     } else {
         listEntry = RemoveHeadList(&IopErrorLogListHead);// Remove the next packet from the head of the list.
     }
@@ -461,4 +477,143 @@ Arguments:
     InsertHeadList(&IopErrorLogListHead, ListEntry);
     ErrorLogPortConnected = FALSE;
     ExReleaseSpinLock(&IopErrorLogLock, irql);
-}
\ No newline at end of file
+}
+
+
+BOOLEAN IopErrorLogAdmitEntry(VOID)
+/*
+Routine Description:
+    This routine is invoked before an error log entry is allocated to enforce the rate limit of the current processor.
+    Refusing the entry before it is allocated keeps a flood of errors from consuming pool on the I/O paths.
+Return Value:
+    TRUE if the entry may be allocated, FALSE if the processor has already admitted its share of entries for the current interval.
+*/
+{
+    PIOP_ERROR_LOG_QUEUE queue;
+    ULONGLONG interruptTime;
+    BOOLEAN admitted;
+    KIRQL oldIrql;
+
+    if (IopErrorLogQueues == NULL) {
+        return TRUE;
+    }
+
+    interruptTime = KeQueryInterruptTime();
+
+    // Raise to DISPATCH_LEVEL so that the state of the processor is not updated by two threads at once.
+    KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+    queue = &IopErrorLogQueues[KeGetCurrentProcessorNumber()];
+    if (interruptTime - queue->WindowStart >= IOP_ERROR_LOG_INTERVAL) {
+        queue->WindowStart = interruptTime;
+        queue->WindowCount = 0;
+    }
+
+    if (queue->WindowCount < IOP_ERROR_LOG_RATE_LIMIT) {
+        queue->WindowCount += 1;
+        admitted = TRUE;
+    } else {
+        queue->RateLimited += 1;
+        admitted = FALSE;
+    }
+
+    KeLowerIrql(oldIrql);
+    return admitted;
+}
+
+
+BOOLEAN IopErrorLogQueueEntry(IN PERROR_LOG_ENTRY Entry)
+/*
+Routine Description:
+    This routine pushes an error log entry onto the queue of the current processor.
+    An entry with the same device, driver, error code, unique value, final status and major function as one the processor queued
+    within the last interval is dropped instead, so that a device repeating the same error is only logged once per interval.
+Arguments:
+    Entry - Supplies the error log entry.
+Return Value:
+    TRUE if the entry was queued, FALSE if it was dropped as a duplicate and freed.
+*/
+{
+    PIOP_ERROR_LOG_QUEUE queue;
+    PIOP_ERROR_LOG_RECENT recent;
+    PIO_ERROR_LOG_PACKET packet;
+    PLIST_ENTRY head;
+    ULONGLONG interruptTime;
+    ULONG index;
+    KIRQL oldIrql;
+
+    packet = (PIO_ERROR_LOG_PACKET)(Entry + 1);
+    interruptTime = KeQueryInterruptTime();
+    index = ((ULONG)((ULONG_PTR)Entry->DeviceObject >> 4) ^ (ULONG)packet->ErrorCode ^ packet->UniqueErrorValue) % IOP_ERROR_LOG_RECENT_ENTRIES;
+
+    KeRaiseIrql(DISPATCH_LEVEL, &oldIrql);
+    queue = &IopErrorLogQueues[KeGetCurrentProcessorNumber()];
+    recent = &queue->Recent[index];
+    if (recent->DeviceObject == Entry->DeviceObject &&
+        recent->DriverObject == Entry->DriverObject &&
+        recent->ErrorCode == packet->ErrorCode &&
+        recent->FinalStatus == packet->FinalStatus &&
+        recent->UniqueErrorValue == packet->UniqueErrorValue &&
+        recent->MajorFunctionCode == packet->MajorFunctionCode &&
+        interruptTime - recent->InterruptTime < IOP_ERROR_LOG_INTERVAL) {
+        queue->Duplicates += 1;
+        KeLowerIrql(oldIrql);
+        IoFreeErrorLogEntry(packet);
+        return FALSE;
+    }
+
+    // The objects are only compared, never dereferenced, so they are not referenced by the slot.
+    recent->DeviceObject = Entry->DeviceObject;
+    recent->DriverObject = Entry->DriverObject;
+    recent->ErrorCode = packet->ErrorCode;
+    recent->FinalStatus = packet->FinalStatus;
+    recent->UniqueErrorValue = packet->UniqueErrorValue;
+    recent->MajorFunctionCode = packet->MajorFunctionCode;
+    recent->InterruptTime = interruptTime;
+
+    // Only the error log thread removes entries, and it takes the whole queue at once, so the push cannot suffer from reuse of the head.
+    do {
+        head = queue->Head;
+        Entry->ListEntry.Flink = head;
+    } while (InterlockedCompareExchangePointer((PVOID *)&queue->Head, &Entry->ListEntry, head) != head);
+
+    KeLowerIrql(oldIrql);
+    return TRUE;
+}
+
+
+VOID IopErrorLogFlushQueues(VOID)
+/*
+Routine Description:
+    This routine moves the entries of every per processor queue to the tail of the error log queue.
+    The entries of each processor keep the order they were written in.
+    The caller must hold IopErrorLogLock.
+*/
+{
+    PLIST_ENTRY entry;
+    PLIST_ENTRY next;
+    PLIST_ENTRY oldest;
+    ULONG processor;
+
+    if (IopErrorLogQueues == NULL) {
+        return;
+    }
+
+    for (processor = 0; processor < (ULONG)KeNumberProcessors; processor++) {
+        entry = InterlockedExchangePointer((PVOID *)&IopErrorLogQueues[processor].Head, NULL);
+
+        // The queue is linked newest first, so reverse it.
+        oldest = NULL;
+        while (entry != NULL) {
+            next = entry->Flink;
+            entry->Flink = oldest;
+            oldest = entry;
+            entry = next;
+        }
+
+        while (oldest != NULL) {
+            next = oldest->Flink;
+            InsertTailList(&IopErrorLogListHead, oldest);
+            oldest = next;
+        }
+    }
+}
@@ -95,6 +95,7 @@ PVPB IopMountInitializeVpb(IN  PDEVICE_OBJECT  DeviceObject, IN  PDEVICE_OBJECT
 #pragma alloc_text(PAGE, IopRaiseHardError)
 #pragma alloc_text(PAGE, IopApcHardError)
 #pragma alloc_text(PAGE, IopRaiseInformationalHardError)
+#pragma alloc_text(PAGE, IopReadWriteFileVector)
 #pragma alloc_text(PAGE, IopReadyDeviceObjects)
 #pragma alloc_text(PAGE, IopReferenceDriverObjectByName)
 #pragma alloc_text(PAGE, IopUnMarshalIds)
@@ -3616,6 +3617,336 @@ Arguments:
 }
 
 
+NTSTATUS IopReadWriteFileVector(
+    IN HANDLE FileHandle,
+    OUT PIO_STATUS_BLOCK IoStatusBlock,
+    IN PFILE_IO_VECTOR Vector,
+    IN ULONG VectorCount,
+    IN PLARGE_INTEGER ByteOffset OPTIONAL,
+    IN PULONG Key OPTIONAL,
+    IN UCHAR MajorFunction
+)
+/*
+Routine Description:
+    This routine implements the vectored read and write services.
+    The segments are transferred in order, as one operation, while the file object lock is held so that no other I/O on the file object can be interleaved.
+    Each segment is first offered to the file system's Fast I/O entry point, which copies directly to or from the cache via CcCopyRead or CcCopyWrite when the file is cached.
+    If Fast I/O cannot handle a segment, it is sent to the driver in its own IRP and waited on before the next segment is started.
+    The transfer stops at the first error or short transfer.
+Arguments:
+    FileHandle - Supplies a handle to the file, which must have been opened for synchronous I/O.
+    IoStatusBlock - Address of the caller's I/O status block; receives the total number of bytes transferred.
+    Vector - Supplies the array of buffer segments; the segments may have any address and length.
+    VectorCount - Supplies the number of entries in Vector.
+    ByteOffset - Optionally specifies the starting byte offset within the file.
+    Key - Optionally specifies a key to be used if there are locks associated with the file.
+    MajorFunction - Supplies IRP_MJ_READ or IRP_MJ_WRITE.
+Return Value:
+    The final status of the operation.
+    If an error occurs after some segments have been transferred, the bytes already transferred are reported and STATUS_SUCCESS is returned.
+*/
+{
+    PIRP irp;
+    NTSTATUS status;
+    PFILE_OBJECT fileObject;
+    PDEVICE_OBJECT deviceObject;
+    PFAST_IO_DISPATCH fastIoDispatch;
+    PDEVICE_OBJECT fastIoDeviceObject;
+    KPROCESSOR_MODE requestorMode;
+    PIO_STACK_LOCATION irpSp;
+    FILE_IO_VECTOR localVector[IOP_FILE_VECTOR_LOCAL_COUNT];
+    PFILE_IO_VECTOR capturedVector = localVector;
+    IO_STATUS_BLOCK localIoStatus;
+    KEVENT event;
+    LARGE_INTEGER fileOffset = {0,0};
+    ULONG keyValue = 0;
+    ULONG totalLength;
+    ULONG_PTR transferred;
+    ULONG i;
+    BOOLEAN readOperation;
+    BOOLEAN writeToEnd;
+    BOOLEAN interrupted;
+
+    PAGED_CODE();
+
+    if (VectorCount == 0 || VectorCount > IO_MAXIMUM_FILE_VECTOR_COUNT) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    readOperation = (BOOLEAN)(MajorFunction == IRP_MJ_READ);
+    requestorMode = KeGetPreviousMode();
+
+    // Reference the file object.  Note that if the caller does not have the required access to the file, the operation will fail.
+    status = ObReferenceObjectByHandle(FileHandle,
+                                       readOperation ? FILE_READ_DATA : FILE_WRITE_DATA,
+                                       IoFileObjectType,
+                                       requestorMode,
+                                       (PVOID*)& fileObject,
+                                       NULL);
+    if (!NT_SUCCESS(status)) {
+        return status;
+    }
+
+    // Vectored transfers are serialized through the file object lock, so they are only supported for files opened for synchronous I/O.
+    // Asynchronous, page-aligned transfers are provided by NtReadFileScatter and NtWriteFileGather.
+    if (!(fileObject->Flags & FO_SYNCHRONOUS_IO)) {
+        ObDereferenceObject(fileObject);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    deviceObject = IoGetRelatedDeviceObject(fileObject);
+
+    if (VectorCount > IOP_FILE_VECTOR_LOCAL_COUNT) {
+        capturedVector = ExAllocatePoolWithQuotaTag(PagedPool | POOL_QUOTA_FAIL_INSTEAD_OF_RAISE, VectorCount * sizeof(FILE_IO_VECTOR), 'vFoI');
+        if (!capturedVector) {
+            ObDereferenceObject(fileObject);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+
+    // Capture the segment array and validate each segment.
+    // The buffers themselves are not captured; they are probed here and accessed under exception handlers later.
+    try {
+        if (requestorMode != KernelMode) {
+            ProbeForWriteIoStatus(IoStatusBlock);
+            ProbeForRead(Vector, VectorCount * sizeof(FILE_IO_VECTOR), TYPE_ALIGNMENT(FILE_IO_VECTOR));
+        }
+
+        RtlCopyMemory(capturedVector, Vector, VectorCount * sizeof(FILE_IO_VECTOR));
+
+        totalLength = 0;
+        for (i = 0; i < VectorCount; i++) {
+            if (requestorMode != KernelMode) {
+                if (readOperation) {
+                    ProbeForWrite(capturedVector[i].Buffer, capturedVector[i].Length, sizeof(UCHAR));
+                } else {
+                    ProbeForRead(capturedVector[i].Buffer, capturedVector[i].Length, sizeof(UCHAR));
+                }
+            }
+
+            // Segments of a file opened without intermediate buffering must each meet the device's alignment and sector size requirements.
+            if (fileObject->Flags & FO_NO_INTERMEDIATE_BUFFERING) {
+                if ((deviceObject->SectorSize && capturedVector[i].Length % deviceObject->SectorSize) ||
+                    (ULONG_PTR)capturedVector[i].Buffer & deviceObject->AlignmentRequirement) {
+                    ExRaiseStatus(STATUS_INVALID_PARAMETER);
+                }
+            }
+
+            if (totalLength + capturedVector[i].Length < totalLength) {
+                ExRaiseStatus(STATUS_INVALID_PARAMETER);
+            }
+            totalLength += capturedVector[i].Length;
+        }
+
+        if (ARGUMENT_PRESENT(ByteOffset)) {
+            if (requestorMode != KernelMode) {
+                ProbeForReadSmallStructure(ByteOffset, sizeof(LARGE_INTEGER), sizeof(ULONG));
+            }
+            fileOffset = *ByteOffset;
+        }
+
+        if (ARGUMENT_PRESENT(Key)) {
+            keyValue = requestorMode != KernelMode ? ProbeAndReadUlong(Key) : *Key;
+        }
+    } except(EXCEPTION_EXECUTE_HANDLER)
+    {
+        if (capturedVector != localVector) {
+            ExFreePool(capturedVector);
+        }
+        ObDereferenceObject(fileObject);
+        return GetExceptionCode();
+    }
+
+    fastIoDeviceObject = IopGetFastIoDeviceObject(deviceObject);
+    fastIoDispatch = fastIoDeviceObject->DriverObject->FastIoDispatch;
+
+    if (!IopAcquireFastLock(fileObject)) {
+        status = IopAcquireFileObjectLock(fileObject, requestorMode, (BOOLEAN)((fileObject->Flags & FO_ALERTABLE_IO) != 0), &interrupted);
+        if (interrupted) {
+            if (capturedVector != localVector) {
+                ExFreePool(capturedVector);
+            }
+            ObDereferenceObject(fileObject);
+            return status;
+        }
+    }
+
+    if (!ARGUMENT_PRESENT(ByteOffset) || (fileOffset.LowPart == FILE_USE_FILE_POINTER_POSITION && fileOffset.HighPart == -1)) {
+        fileOffset = fileObject->CurrentByteOffset;
+    }
+
+    // Writes to end of file keep the special offset for every segment so that each one is appended in turn.
+    writeToEnd = (BOOLEAN)(!readOperation && fileOffset.LowPart == FILE_WRITE_TO_END_OF_FILE && fileOffset.HighPart == -1);
+
+    //  Negative file offsets are illegal, as are unaligned offsets for files opened without intermediate buffering.
+    if ((!writeToEnd && fileOffset.HighPart < 0) ||
+        (!writeToEnd && (fileObject->Flags & FO_NO_INTERMEDIATE_BUFFERING) && deviceObject->SectorSize && fileOffset.LowPart % deviceObject->SectorSize)) {
+        IopReleaseFileObjectLock(fileObject);
+        if (capturedVector != localVector) {
+            ExFreePool(capturedVector);
+        }
+        ObDereferenceObject(fileObject);
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    status = STATUS_SUCCESS;
+    transferred = 0;
+    for (i = 0; i < VectorCount; i++) {
+        if (capturedVector[i].Length == 0) {
+            continue;
+        }
+
+        // Try the cache first.  If Fast I/O declines the segment or fails it, go the long way with an IRP, which reports the real error.
+        if (!fileObject->PrivateCacheMap ||
+            !fastIoDispatch ||
+            !(readOperation ? fastIoDispatch->FastIoRead(fileObject, &fileOffset, capturedVector[i].Length, TRUE, keyValue, capturedVector[i].Buffer, &localIoStatus, fastIoDeviceObject) :
+                              fastIoDispatch->FastIoWrite(fileObject, &fileOffset, capturedVector[i].Length, TRUE, keyValue, capturedVector[i].Buffer, &localIoStatus, fastIoDeviceObject)) ||
+            !((localIoStatus.Status == STATUS_SUCCESS) || (localIoStatus.Status == STATUS_BUFFER_OVERFLOW) || (localIoStatus.Status == STATUS_END_OF_FILE))) {
+            // Build the IRP the way NtReadFile and NtWriteFile do, since the buffer is the caller's:
+            // the request is issued in the caller's mode, and the buffer is copied or probed and locked in that mode under an exception handler.
+            // The request is a synchronous API request against a private event, because the file object lock is held across the whole vector.
+            irp = IoAllocateIrp(deviceObject->StackSize, FALSE);
+            if (!irp) {
+                status = STATUS_INSUFFICIENT_RESOURCES;
+                break;
+            }
+
+            status = STATUS_SUCCESS;
+            KeInitializeEvent(&event, NotificationEvent, FALSE);
+            irp->Tail.Overlay.OriginalFileObject = fileObject;
+            irp->Tail.Overlay.Thread = PsGetCurrentThread();
+            irp->RequestorMode = requestorMode;
+            irp->UserEvent = &event;
+            irp->UserIosb = &localIoStatus;
+            irp->Overlay.AsynchronousParameters.UserApcRoutine = (PIO_APC_ROUTINE)NULL;
+            irp->AssociatedIrp.SystemBuffer = (PVOID)NULL;
+            irp->MdlAddress = (PMDL)NULL;
+
+            // The operation flags are left clear so that I/O completion does not count the transfer; the whole vector is counted once below.
+            irp->Flags = IRP_SYNCHRONOUS_API;
+            if (deviceObject->Flags & DO_BUFFERED_IO) {
+                try {
+                    irp->AssociatedIrp.SystemBuffer = ExAllocatePoolWithQuota(NonPagedPoolCacheAligned, capturedVector[i].Length);
+                    if (readOperation) {
+                        irp->UserBuffer = capturedVector[i].Buffer;
+                        irp->Flags |= IRP_BUFFERED_IO | IRP_DEALLOCATE_BUFFER | IRP_INPUT_OPERATION;
+                    } else {
+                        RtlCopyMemory(irp->AssociatedIrp.SystemBuffer, capturedVector[i].Buffer, capturedVector[i].Length);
+                        irp->Flags |= IRP_BUFFERED_IO | IRP_DEALLOCATE_BUFFER;
+                    }
+                } except(EXCEPTION_EXECUTE_HANDLER)
+                {
+                    status = GetExceptionCode();
+                }
+            } else if (deviceObject->Flags & DO_DIRECT_IO) {
+                try {
+                    if (IoAllocateMdl(capturedVector[i].Buffer, capturedVector[i].Length, FALSE, TRUE, irp) == NULL) {
+                        ExRaiseStatus(STATUS_INSUFFICIENT_RESOURCES);
+                    }
+                    MmProbeAndLockPages(irp->MdlAddress, requestorMode, readOperation ? IoWriteAccess : IoReadAccess);
+                } except(EXCEPTION_EXECUTE_HANDLER)
+                {
+                    status = GetExceptionCode();
+                }
+            } else {
+                irp->UserBuffer = capturedVector[i].Buffer;
+            }
+
+            if (!NT_SUCCESS(status)) {
+                if (irp->AssociatedIrp.SystemBuffer != NULL) {
+                    ExFreePool(irp->AssociatedIrp.SystemBuffer);
+                }
+                if (irp->MdlAddress != NULL) {
+                    IoFreeMdl(irp->MdlAddress);
+                }
+                IoFreeIrp(irp);
+                break;
+            }
+
+            // The request is issued at the process's I/O priority.
+            (VOID)IoSetIoPriorityHint(irp, IopGetProcessIoPriority(PsGetCurrentProcess()));
+            if (fileObject->Flags & FO_NO_INTERMEDIATE_BUFFERING) {
+                irp->Flags |= IRP_NOCACHE;
+            }
+
+            irpSp = IoGetNextIrpStackLocation(irp);
+            irpSp->MajorFunction = MajorFunction;
+            irpSp->FileObject = fileObject;
+            if (readOperation) {
+                irpSp->Parameters.Read.Length = capturedVector[i].Length;
+                irpSp->Parameters.Read.Key = keyValue;
+                irpSp->Parameters.Read.ByteOffset = fileOffset;
+            } else {
+                irpSp->Parameters.Write.Length = capturedVector[i].Length;
+                irpSp->Parameters.Write.Key = keyValue;
+                irpSp->Parameters.Write.ByteOffset = fileOffset;
+                if (fileObject->Flags & FO_WRITE_THROUGH) {
+                    irpSp->Flags = SL_WRITE_THROUGH;
+                }
+            }
+
+            // I/O completion dereferences the file object, so take out a reference for the request.
+            // A request that fails without pending does not write the I/O status block, so its status is the one returned by the driver.
+            ObReferenceObject(fileObject);
+            IopQueueThreadIrp(irp);
+            status = IoCallDriver(deviceObject, irp);
+            if (status == STATUS_PENDING) {
+                (VOID)KeWaitForSingleObject(&event, Executive, KernelMode, FALSE, (PLARGE_INTEGER)NULL);
+            } else {
+                localIoStatus.Status = status;
+            }
+        }
+
+        status = localIoStatus.Status;
+        if (NT_ERROR(status)) {
+            break;
+        }
+
+        transferred += localIoStatus.Information;
+        if (!writeToEnd) {
+            fileOffset.QuadPart += localIoStatus.Information;
+        }
+
+        // A short transfer, such as a read that reaches end of file, ends the vector.
+        if (localIoStatus.Information < capturedVector[i].Length) {
+            break;
+        }
+    }
+
+    // Report what was transferred ahead of any error, and leave the file position after the last byte transferred.
+    if (transferred != 0) {
+        status = STATUS_SUCCESS;
+    }
+    if (!writeToEnd) {
+        fileObject->CurrentByteOffset = fileOffset;
+    }
+
+    IopReleaseFileObjectLock(fileObject);
+
+    if (readOperation) {
+        IopUpdateReadOperationCount();
+        IopUpdateReadTransferCount((ULONG)transferred);
+    } else {
+        IopUpdateWriteOperationCount();
+        IopUpdateWriteTransferCount((ULONG)transferred);
+    }
+
+    try {
+        IoStatusBlock->Status = status;
+        IoStatusBlock->Information = transferred;
+    } except(EXCEPTION_EXECUTE_HANDLER)
+    {
+        status = GetExceptionCode();
+    }
+
+    if (capturedVector != localVector) {
+        ExFreePool(capturedVector);
+    }
+    ObDereferenceObject(fileObject);
+    return status;
+}
+
+
 VOID IopReadyDeviceObjects(IN PDRIVER_OBJECT DriverObject)
 /*
 Routine Description:
@@ -4277,6 +4608,11 @@ Return Value:
         IopQueueThreadIrp(Irp);
     }
 
+    // Requests issued on behalf of a process carry the process's default I/O priority.
+    if (!(Irp->Flags & IRP_PRIORITY_MASK)) {
+        (VOID)IoSetIoPriorityHint(Irp, IopGetProcessIoPriority(PsGetCurrentProcess()));
+    }
+
     // Update the operation count statistic for the current process.
     switch (TransferType) {
     case ReadTransfer:
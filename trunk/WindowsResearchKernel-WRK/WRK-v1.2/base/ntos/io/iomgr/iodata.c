@@ -99,6 +99,19 @@ GENERAL_LOOKASIDE IopSmallIrpLookasideList;
 GENERAL_LOOKASIDE IopMdlLookasideList;
 ULONG IopLargeIrpStackLocations;
 
+// The per processor caches of IRPs deeper than IopLargeIrpStackLocations, indexed by processor number. NULL if they could not be allocated.
+PIOP_IRP_CACHE IopIrpCache;
+
+// The deadline, in clock ticks after it is queued, of a packet of each I/O priority on a device that queues by priority.
+// Devices dispatch the packet with the earliest deadline first, so a low priority packet waits for newer high priority packets only until its deadline passes.
+ULONG IopIoPriorityDeadline[MaxIoPriorityTypes] = {
+    256,    // IoPriorityVeryLow
+    32,     // IoPriorityLow
+    8,      // IoPriorityNormal
+    2,      // IoPriorityHigh
+    0       // IoPriorityCritical
+};
+
 
 // The following spinlock is used to control access to the I/O system's error log database.
 // It is initialized by the I/O system initialization code when the system is being initialized.
@@ -147,6 +160,7 @@ ULONG IopTimerCount;
 POBJECT_TYPE IoAdapterObjectType;
 POBJECT_TYPE IoControllerObjectType;
 POBJECT_TYPE IoCompletionObjectType;
+POBJECT_TYPE IoRingObjectType;
 POBJECT_TYPE IoDeviceObjectType;
 POBJECT_TYPE IoDriverObjectType;
 POBJECT_TYPE IoDeviceHandlerObjectType;
@@ -107,6 +107,7 @@ Return Value:
     ULONG lookasideIrpLimit;
     ULONG lookasideSize;
     ULONG Index;
+    ULONG Class;
     PKPRCB prcb;
     PKEY_VALUE_PARTIAL_INFORMATION value;
     PUCHAR valueBuffer;
@@ -201,11 +202,11 @@ Return Value:
                                     &ExSystemLookasideListHead);
 
     // Initialize the system large IRP lookaside list.
-    largePacketSize = (ULONG)(sizeof(IRP) + (IopLargeIrpStackLocations * sizeof(IO_STACK_LOCATION)));
+    largePacketSize = (ULONG)IopSizeOfIrpPacket(IopLargeIrpStackLocations);
     ExInitializeSystemLookasideList(&IopLargeIrpLookasideList, NonPagedPool, largePacketSize, 'lprI', largeIrpZoneSize, &ExSystemLookasideListHead);
 
     // Initialize the system small IRP lookaside list.
-    smallPacketSize = (ULONG)(sizeof(IRP) + sizeof(IO_STACK_LOCATION));
+    smallPacketSize = (ULONG)IopSizeOfIrpPacket(1);
     ExInitializeSystemLookasideList(&IopSmallIrpLookasideList, NonPagedPool, smallPacketSize, 'sprI', smallIrpZoneSize, &ExSystemLookasideListHead);
 
     // Initialize the system MDL lookaside list.
@@ -264,10 +265,30 @@ Return Value:
         }
     }
 
+    // Allocate the per processor caches for IRPs deeper than the large IRP lookaside lists hold.
+    // If this fails such packets are simply allocated from nonpaged pool.
+    IopIrpCache = ExAllocatePoolWithTag(NonPagedPoolCacheAligned, KeNumberProcessors * sizeof(IOP_IRP_CACHE), 'cprI');
+    if (IopIrpCache != NULL) {
+        RtlZeroMemory(IopIrpCache, KeNumberProcessors * sizeof(IOP_IRP_CACHE));
+        for (Index = 0; Index < (ULONG)KeNumberProcessors; Index += 1) {
+            for (Class = 0; Class < IOP_IRP_CACHE_CLASSES; Class += 1) {
+                InitializeSListHead(&IopIrpCache[Index].Local.ListHead[Class]);
+                InitializeSListHead(&IopIrpCache[Index].Remote.ListHead[Class]);
+            }
+        }
+    }
+
     // Initialize the error log spin locks and log list.
     KeInitializeSpinLock(&IopErrorLogLock);
     InitializeListHead(&IopErrorLogListHead);
 
+    // Allocate the per processor error log queues.
+    // If this fails entries are queued directly to the log list and are neither rate limited nor deduplicated.
+    IopErrorLogQueues = ExAllocatePoolWithTag(NonPagedPoolCacheAligned, KeNumberProcessors * sizeof(IOP_ERROR_LOG_QUEUE), 'qEoI');
+    if (IopErrorLogQueues != NULL) {
+        RtlZeroMemory(IopErrorLogQueues, KeNumberProcessors * sizeof(IOP_ERROR_LOG_QUEUE));
+    }
+
     if (IopInitializeReserveIrp(&IopReserveIrpAllocator) == FALSE) {
         IopInitFailCode = 1;
         return FALSE;
@@ -1251,6 +1272,17 @@ const GENERIC_MAPPING IopCompletionMapping = {
 };
 
 
+#ifdef ALLOC_DATA_PRAGMA
+#pragma const_seg("INITCONST")
+#endif // ALLOC_DATA_PRAGMA
+const GENERIC_MAPPING IopIoRingMapping = {
+    STANDARD_RIGHTS_READ,
+    STANDARD_RIGHTS_WRITE | IO_RING_SUBMIT,
+    STANDARD_RIGHTS_EXECUTE | SYNCHRONIZE,
+    IO_RING_ALL_ACCESS
+};
+
+
 BOOLEAN IopCreateObjectTypes(VOID)
 /*
 Routine Description:
@@ -1262,6 +1294,7 @@ Routine Description:
         Driver
         File
         I/O Completion
+        I/O Ring
 Return Value:
     The function value is a BOOLEAN indicating whether or not the object types were successfully created.
 */
@@ -1341,6 +1374,18 @@ Return Value:
         return FALSE;
     }
 
+    // Create the object type for I/O ring objects.
+    RtlInitUnicodeString(&nameString, L"IoRing");
+    objectTypeInitializer.DefaultNonPagedPoolCharge = sizeof(IOP_IO_RING);
+    objectTypeInitializer.GenericMapping = IopIoRingMapping;
+    objectTypeInitializer.ValidAccessMask = IO_RING_ALL_ACCESS;
+    objectTypeInitializer.OpenProcedure = IopOpenIoRing;
+    objectTypeInitializer.CloseProcedure = IopCloseIoRing;
+    objectTypeInitializer.DeleteProcedure = IopDeleteIoRing;
+    if (!NT_SUCCESS(ObCreateObjectType(&nameString, &objectTypeInitializer, (PSECURITY_DESCRIPTOR)NULL, &IoRingObjectType))) {
+        return FALSE;
+    }
+
     // Create the object type for file objects.
     RtlInitUnicodeString(&nameString, L"File");
     objectTypeInitializer.DefaultPagedPoolCharge = IO_FILE_OBJECT_PAGED_POOL_CHARGE;
@@ -1349,6 +1394,7 @@ Return Value:
     objectTypeInitializer.GenericMapping = IopFileMapping;
     objectTypeInitializer.ValidAccessMask = FILE_ALL_ACCESS;
     objectTypeInitializer.MaintainHandleCount = TRUE;
+    objectTypeInitializer.OpenProcedure = (OB_OPEN_METHOD)NULL;
     objectTypeInitializer.CloseProcedure = IopCloseFile;
     objectTypeInitializer.DeleteProcedure = IopDeleteFile;
     objectTypeInitializer.ParseProcedure = IopParseFile;
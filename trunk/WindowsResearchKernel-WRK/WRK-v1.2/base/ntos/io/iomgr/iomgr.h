@@ -78,6 +78,34 @@ typedef struct _ERROR_LOG_ENTRY {// Define an error log entry.
     LARGE_INTEGER TimeStamp;
 } ERROR_LOG_ENTRY, * PERROR_LOG_ENTRY;
 
+// Define the per processor error log queues.
+// IoWriteErrorLogEntry pushes entries onto the queue of the current processor without taking a lock,
+// and the error log thread moves them onto IopErrorLogListHead in batches.
+// Each processor admits at most IOP_ERROR_LOG_RATE_LIMIT entries per IOP_ERROR_LOG_INTERVAL,
+// and drops an entry identical to one it queued within the last IOP_ERROR_LOG_INTERVAL.
+#define IOP_ERROR_LOG_RATE_LIMIT        64
+#define IOP_ERROR_LOG_INTERVAL          (10 * 1000 * 1000)  // 1 second
+#define IOP_ERROR_LOG_RECENT_ENTRIES    16
+
+typedef struct _IOP_ERROR_LOG_RECENT {
+    PDEVICE_OBJECT DeviceObject;
+    PDRIVER_OBJECT DriverObject;
+    NTSTATUS ErrorCode;
+    NTSTATUS FinalStatus;
+    ULONG UniqueErrorValue;
+    UCHAR MajorFunctionCode;
+    ULONGLONG InterruptTime;
+} IOP_ERROR_LOG_RECENT, *PIOP_ERROR_LOG_RECENT;
+
+typedef struct DECLSPEC_CACHEALIGN _IOP_ERROR_LOG_QUEUE {
+    PLIST_ENTRY volatile Head;      // Newest entry first, linked through Flink
+    ULONGLONG WindowStart;
+    ULONG WindowCount;
+    ULONG RateLimited;
+    ULONG Duplicates;
+    IOP_ERROR_LOG_RECENT Recent[IOP_ERROR_LOG_RECENT_ENTRIES];
+} IOP_ERROR_LOG_QUEUE, *PIOP_ERROR_LOG_QUEUE;
+
 
 //  Define both the global IOP_HARD_ERROR_QUEUE and IOP_HARD_ERROR_PACKET structures.
 //  Also set the maximum number of outstanding hard error packets allowed.
@@ -126,13 +154,15 @@ typedef struct _IO_WORKITEM {
 
 // Define the global data for the error logger and I/O system.
 extern WORK_QUEUE_ITEM IopErrorLogWorkItem;
-extern BOOLEAN IopErrorLogPortPending;
+extern LONG IopErrorLogPortPending;
 extern BOOLEAN IopErrorLogDisabledThisBoot;
 extern ALIGNED_SPINLOCK IopErrorLogLock;
 extern LIST_ENTRY IopErrorLogListHead;
+extern PIOP_ERROR_LOG_QUEUE IopErrorLogQueues;
 extern LONG IopErrorLogAllocation;
 extern KSPIN_LOCK IopErrorLogAllocationLock;
 extern const GENERIC_MAPPING IopFileMapping;
+extern const GENERIC_MAPPING IopIoRingMapping;
 
 
 // Define a dummy file object for use on stack for fast open operations.
@@ -284,6 +314,120 @@ typedef struct _IOP_MINI_COMPLETION_PACKET {
     ULONG_PTR IoStatusInformation;
 } IOP_MINI_COMPLETION_PACKET, * PIOP_MINI_COMPLETION_PACKET;
 
+// Define the registered file and buffer sets of an I/O ring.
+// Each registered file holds a reference to its file object and the access granted through the handle it was registered with.
+// Each registered buffer is locked and mapped into system space once, at registration.
+// A buffer set is referenced by every request in flight against it, so its pages stay locked until the last request completes.
+typedef struct _IOP_IO_RING_FILE {
+    PFILE_OBJECT FileObject;
+    ACCESS_MASK GrantedAccess;
+} IOP_IO_RING_FILE, *PIOP_IO_RING_FILE;
+
+typedef struct _IOP_IO_RING_BUFFER {
+    PMDL Mdl;
+    PUCHAR SystemAddress;
+    ULONG Length;
+} IOP_IO_RING_BUFFER, *PIOP_IO_RING_BUFFER;
+
+typedef struct _IOP_IO_RING_BUFFERS {
+    LONG ReferenceCount;
+    ULONG Count;
+    IOP_IO_RING_BUFFER Buffer[ANYSIZE_ARRAY];
+} IOP_IO_RING_BUFFERS, *PIOP_IO_RING_BUFFERS;
+
+// Define the I/O ring object body.
+// The submission queue lives in the address space of the creating process, so only that process may submit to the ring or hold a handle to it.
+// Submissions and registrations are serialized by the push lock so that two submitting threads never consume the same entry
+// and a registration never changes underneath a submission.
+// The requests the ring has issued are not queued to any thread; they are linked through their ThreadListEntry into IrpList instead,
+// so that the close of the last handle can cancel and drain them before the process address space is deleted.
+typedef struct _IOP_IO_RING {
+    PEPROCESS Process;
+    PVOID IoCompletion;
+    PVOID CompletionKey;
+    PIO_RING_SUBMISSION_QUEUE SubmissionQueue;
+    ULONG EntryCount;
+    EX_PUSH_LOCK SubmitLock;
+    PIOP_IO_RING_FILE Files;
+    ULONG FileCount;
+    PIOP_IO_RING_BUFFERS Buffers;
+    KSPIN_LOCK IrpLock;
+    LIST_ENTRY IrpList;
+    BOOLEAN RunDown;                    // Set once the last handle is closed; no further requests are issued.
+    BOOLEAN CancelIrpCompleted;
+    PIRP CancelIrp;                     // The request the rundown is cancelling; its completion is finished by the rundown.
+    KEVENT DrainEvent;
+} IOP_IO_RING, *PIOP_IO_RING;
+
+// Define the negative create cache of a file system volume.
+// A file system opts a volume device object in with IoEnableCreateCache and calls IoInvalidateCreateCache whenever a name may have been added to the volume.
+// Opens that the file system failed with STATUS_OBJECT_NAME_NOT_FOUND are remembered by name,
+// and repeated opens of the same name are failed by IopParseDevice without allocating a file object or an IRP.
+// Invalidation simply advances the generation, which retires every entry at once.
+#define IOP_CREATE_CACHE_SIZE           128
+#define IOP_CREATE_CACHE_NAME_LENGTH    120
+
+typedef struct _IOP_CREATE_CACHE_ENTRY {
+    ULONG Hash;
+    LONG Generation;
+    USHORT NameLength;                  // In bytes; zero if the entry is unused.
+    BOOLEAN CaseInsensitive;
+    WCHAR Name[IOP_CREATE_CACHE_NAME_LENGTH];
+} IOP_CREATE_CACHE_ENTRY, *PIOP_CREATE_CACHE_ENTRY;
+
+typedef struct _IOP_CREATE_CACHE {
+    EX_PUSH_LOCK Lock;
+    LONG Generation;
+    IOP_CREATE_CACHE_ENTRY Entries[IOP_CREATE_CACHE_SIZE];
+} IOP_CREATE_CACHE, *PIOP_CREATE_CACHE;
+
+// Define the I/O latency histogram of a device object.
+// A driver opts a device object in with IoEnableLatencyHistogram.
+// Each processor counts the requests it completes in its own cache aligned copy of the histogram, so recording a sample never contends with another processor;
+// IoQueryDeviceLatencyHistogram and IoQueryDriverLatencyHistogram sum the copies.
+#define IOP_LATENCY_HISTOGRAM_SHIFT     10  // Bucket zero holds everything below 2^10 cycles.
+
+typedef struct DECLSPEC_CACHEALIGN _IOP_LATENCY_HISTOGRAM {
+    ULONG Count[IRP_MJ_MAXIMUM_FUNCTION + 1][IO_LATENCY_HISTOGRAM_BUCKETS];
+} IOP_LATENCY_HISTOGRAM, *PIOP_LATENCY_HISTOGRAM;     // One per processor.
+
+// Define the layout of SHARE_ACCESS_STATE.
+// The state packs six ten bit counts: the opens that read, write and delete, and the opens that do not share read, write and delete access.
+// An open is compatible with the others exactly when no open denies an access it uses and it shares every access that the others use,
+// so these counts are all the check needs; the not shared counts stand in for SHARE_ACCESS's OpenCount less its shared counts.
+#define IOP_SHARE_STATE_FIELD_BITS      10
+#define IOP_SHARE_STATE_FIELD_MASK      ((1 << IOP_SHARE_STATE_FIELD_BITS) - 1)
+#define IOP_SHARE_STATE_READERS         0
+#define IOP_SHARE_STATE_WRITERS         1
+#define IOP_SHARE_STATE_DELETERS        2
+#define IOP_SHARE_STATE_DENY_READ       3
+#define IOP_SHARE_STATE_DENY_WRITE      4
+#define IOP_SHARE_STATE_DENY_DELETE     5
+#define IOP_SHARE_STATE_FIELDS          6
+
+#define IopShareStateUnit(Field)            ((LONG64)1 << ((Field) * IOP_SHARE_STATE_FIELD_BITS))
+#define IopShareStateCount(State, Field)    ((ULONG)((State) >> ((Field) * IOP_SHARE_STATE_FIELD_BITS)) & IOP_SHARE_STATE_FIELD_MASK)
+
+// Define the DPC steering object of a device, see IoCreateDpcSteering.
+// There is one DPC per processor, each in its own cache line.
+// The load of a processor is a decaying average of the cycles the DPC routine took there, each new sample weighing 1/2^IOP_STEERED_DPC_LOAD_SHIFT.
+#define IOP_STEERED_DPC_LOAD_SHIFT      3
+#define IOP_STEERED_DPC_LOAD_SLACK      4096    // Loads this close are treated as equal.
+
+typedef struct DECLSPEC_CACHEALIGN _IOP_STEERED_DPC {
+    KDPC Dpc;
+    struct _IO_DPC_STEERING *Steering;
+    ULONG Load;
+    ULONG Executed;
+    ULONG Redirected;                   // Requests targeted at this processor that were run elsewhere because of its load.
+} IOP_STEERED_DPC, *PIOP_STEERED_DPC;
+
+typedef struct _IO_DPC_STEERING {
+    PDEVICE_OBJECT DeviceObject;
+    PIO_DPC_ROUTINE DpcRoutine;
+    IOP_STEERED_DPC Processor[1];       // One per processor.
+} IO_DPC_STEERING;
+
 typedef struct _IO_UNLOAD_SAFE_COMPLETION_CONTEXT {
     PDEVICE_OBJECT DeviceObject;
     PVOID Context;
@@ -340,6 +484,43 @@ typedef struct  _IOP_IRP_STACK_PROFILER {
 #define DEFAULT_LARGE_IRP_LOCATIONS     8
 #define BASE_STACK_COUNT                DEFAULT_LARGE_IRP_LOCATIONS
 
+// Every packet the I/O manager allocates has room after its last stack location in use for the processor cycle count at which it was dispatched to the top of its stack.
+// The count is only taken when the device at the top of the stack keeps a latency histogram, and is zero otherwise.
+// Such packets are marked with a private allocation flag, which IoInitializeIrp clears.
+// Packets that drivers allocate and initialize themselves are never measured, since the space after their stack may be the driver's own.
+#define IRP_ALLOCATED_START_TIME        0x80
+#define IopSizeOfIrpPacket(StackSize)   ((USHORT)(IoSizeOfIrp((StackSize)) + sizeof(ULONG64)))
+#define IopIrpHasStartTime(Irp)         ((Irp)->AllocationFlags & IRP_ALLOCATED_START_TIME)
+#define IopIrpStartTime(Irp)            (*(ULONG64 UNALIGNED *)((PUCHAR)(Irp) + IoSizeOfIrp((Irp)->StackCount)))
+
+// Define the per processor IRP cache for packets deeper than the large IRP lookaside lists hold.
+// There is one class per stack count up to the deepest stack the reserve IRP is sized for.
+// A cached IRP records its owning processor after its last stack location and is always freed back to that processor:
+// locally onto the Local lists, or from other processors onto the Remote lists, which the owner reclaims in one batch when a Local list runs dry.
+#define IOP_IRP_CACHE_CLASSES           MAX_RESERVE_IRP_STACK_SIZE
+#define IOP_IRP_CACHE_DEPTH             16
+
+#define IopIrpCacheOwner(Irp, StackSize) (*(PULONG)((PUCHAR)(Irp) + IopSizeOfIrpPacket((StackSize))))
+
+typedef struct DECLSPEC_CACHEALIGN _IOP_IRP_CACHE_LOCAL {
+    SLIST_HEADER ListHead[IOP_IRP_CACHE_CLASSES];
+    ULONG TotalAllocates;
+    ULONG AllocateMisses;
+    ULONG TotalFrees;
+    ULONG FreeMisses;
+} IOP_IRP_CACHE_LOCAL, *PIOP_IRP_CACHE_LOCAL;
+
+typedef struct DECLSPEC_CACHEALIGN _IOP_IRP_CACHE_REMOTE {
+    SLIST_HEADER ListHead[IOP_IRP_CACHE_CLASSES];
+    ULONG RemoteFrees;
+    ULONG RemoteFreeMisses;
+} IOP_IRP_CACHE_REMOTE, *PIOP_IRP_CACHE_REMOTE;
+
+typedef struct _IOP_IRP_CACHE {
+    IOP_IRP_CACHE_LOCAL Local;
+    IOP_IRP_CACHE_REMOTE Remote;
+} IOP_IRP_CACHE, *PIOP_IRP_CACHE;
+
 // Defines for IopIrpAllocatorFlags.
 #define IOP_ENABLE_AUTO_SIZING              0x1
 #define IOP_PROFILE_STACK_COUNT             0x2
@@ -365,11 +546,14 @@ extern KDPC IopTimerDpc;
 extern KTIMER IopTimer;
 extern ULONG IopTimerCount;
 extern ULONG IopLargeIrpStackLocations;
+extern PIOP_IRP_CACHE IopIrpCache;
+extern ULONG IopIoPriorityDeadline[MaxIoPriorityTypes];
 extern ULONG IopFailZeroAccessCreate;
 extern ULONG IopFsRegistrationOps;
 
 extern POBJECT_TYPE IoAdapterObjectType;
 extern POBJECT_TYPE IoCompletionObjectType;
+extern POBJECT_TYPE IoRingObjectType;
 extern POBJECT_TYPE IoControllerObjectType;
 extern POBJECT_TYPE IoDeviceHandlerObjectType;
 
@@ -535,6 +719,13 @@ VOID IopDeleteDriver(IN PVOID    Object);
 VOID IopDeleteDevice(IN PVOID    Object);
 VOID IopDeleteFile(IN PVOID    Object);
 VOID IopDeleteIoCompletion(IN PVOID    Object);
+VOID IopDeleteIoRing(IN PVOID    Object);
+NTSTATUS IopOpenIoRing(IN OB_OPEN_REASON OpenReason, IN PEPROCESS Process OPTIONAL, IN PVOID Object, IN ACCESS_MASK GrantedAccess, IN ULONG HandleCount);
+VOID IopCloseIoRing(IN PEPROCESS Process OPTIONAL, IN PVOID Object, IN ACCESS_MASK GrantedAccess, IN ULONG_PTR ProcessHandleCount, IN ULONG_PTR SystemHandleCount);
+BOOLEAN IopLookupCreateCache(IN PIOP_CREATE_CACHE CreateCache, IN PUNICODE_STRING Name, IN BOOLEAN CaseInsensitive, OUT PLONG Generation);
+VOID IopInsertCreateCache(IN PIOP_CREATE_CACHE CreateCache, IN PUNICODE_STRING Name, IN BOOLEAN CaseInsensitive, IN LONG Generation);
+VOID FASTCALL IopRecordIrpLatency(IN PIRP Irp);
+LONG64 IopShareStateDelta(IN PFILE_OBJECT FileObject);
 
 
 // VOID IopDequeueThreadIrp(IN PIRP Irp)
@@ -578,6 +769,8 @@ VOID IopExceptionCleanup(IN PFILE_OBJECT FileObject,
                          IN PKEVENT EventObject OPTIONAL,
                          IN PKEVENT KernelEvent OPTIONAL);
 VOID IopErrorLogThread(IN PVOID StartContext);
+BOOLEAN IopErrorLogAdmitEntry(VOID);
+BOOLEAN IopErrorLogQueueEntry(IN PERROR_LOG_ENTRY Entry);
 VOID IopFreeIrpAndMdls(IN PIRP Irp);
 PDEVICE_OBJECT IopGetDeviceAttachmentBase(IN PDEVICE_OBJECT DeviceObject);
 NTSTATUS IopGetFileInformation(IN PFILE_OBJECT FileObject,
@@ -701,6 +894,18 @@ NTSTATUS IopQueryXxxInformation(IN PFILE_OBJECT FileObject,
 VOID IopQueueWorkRequest(IN PIRP Irp);
 VOID IopRaiseHardError(IN PVOID NormalContext, IN PVOID SystemArgument1, IN PVOID SystemArgument2);
 VOID IopRaiseInformationalHardError(IN PVOID NormalContext, IN PVOID SystemArgument1, IN PVOID SystemArgument2);
+
+// Number of vector segments captured on the stack by the vectored read and write services before falling back to pool.
+#define IOP_FILE_VECTOR_LOCAL_COUNT 8
+
+NTSTATUS IopReadWriteFileVector(IN HANDLE FileHandle,
+                                OUT PIO_STATUS_BLOCK IoStatusBlock,
+                                IN PFILE_IO_VECTOR Vector,
+                                IN ULONG VectorCount,
+                                IN PLARGE_INTEGER ByteOffset OPTIONAL,
+                                IN PULONG Key OPTIONAL,
+                                IN UCHAR MajorFunction);
+
 VOID IopReadyDeviceObjects(IN PDRIVER_OBJECT DriverObject);
 
 
@@ -743,6 +948,12 @@ NTSTATUS IopSynchronousApiServiceTail(IN NTSTATUS ReturnedStatus,
                                       IN PIO_STATUS_BLOCK LocalIoStatus,
                                       OUT PIO_STATUS_BLOCK IoStatusBlock);
 
+// IO_PRIORITY_HINT IopGetProcessIoPriority(IN PEPROCESS Process)
+// Routine Description:
+//     This routine returns the default I/O priority hint of a process, set through the ProcessIoPriority information class.
+#define IopGetProcessIoPriority(Process) \
+    ((IO_PRIORITY_HINT)(((Process)->Flags & PS_PROCESS_FLAGS_DEFAULT_IO_PRIORITY) >> PS_PROCESS_FLAGS_PRIORITY_SHIFT))
+
 NTSTATUS IopSynchronousServiceTail(IN PDEVICE_OBJECT DeviceObject,
                                    IN PIRP Irp,
                                    IN PFILE_OBJECT FileObject,
@@ -944,6 +1155,11 @@ Return Value:
     // Save a pointer to the device object for this request so that it can be used later in completion.
     irpSp->DeviceObject = DeviceObject;
 
+    // If the packet is entering the top of its stack at a device that keeps a latency histogram, note when it was dispatched.
+    if (Irp->CurrentLocation == Irp->StackCount && DeviceObject->DeviceObjectExtension->LatencyHistogram && IopIrpHasStartTime(Irp)) {
+        IopIrpStartTime(Irp) = PerfGetCycleCount();
+    }
+
     driverObject = DeviceObject->DriverObject;// Invoke the driver at its dispatch routine entry point.
 
     status = driverObject->MajorFunction[irpSp->MajorFunction](DeviceObject, Irp);// Prevent the driver from unloading.
@@ -951,9 +1167,32 @@ Return Value:
 }
 
 
+FORCEINLINE PDEVICE_OBJECT IopGetFastIoDeviceObject(IN PDEVICE_OBJECT DeviceObject)
+/*
+Routine Description:
+    This routine returns the device object whose driver should be called for a cached read or write that would be given to a device object.
+    Filters that declared with IoSetFastIoPassThrough that they do nothing with cached reads and writes are skipped,
+    so that the driver below them is called directly instead of through each filter's fast I/O routine.
+    As with IoGetRelatedDeviceObject, the caller must ensure no device object is attaching or detaching from the stack.
+Arguments:
+    DeviceObject - Pointer to the device object the request would be given to.
+Return Value:
+    The device object to pass to the fast I/O routine of its driver.
+*/
+{
+    while ((DeviceObject->DeviceObjectExtension->ExtensionFlags & DOE_FAST_IO_PASS_THROUGH) && DeviceObject->DeviceObjectExtension->AttachedTo != NULL) {
+        DeviceObject = DeviceObject->DeviceObjectExtension->AttachedTo;
+    }
+
+    return DeviceObject;
+}
+
+
 VOID FASTCALL IopfCompleteRequest(IN PIRP Irp, IN  CCHAR   PriorityBost);
 PIRP IopAllocateIrpPrivate(IN  CCHAR   StackSize, IN  BOOLEAN ChargeQuota);
 VOID IopFreeIrp(IN  PIRP    Irp);
+PIRP IopAllocateCachedIrp(IN CCHAR StackSize);
+VOID IopFreeCachedIrp(IN PIRP Irp);
 PVOID IopAllocateErrorLogEntry(IN PDEVICE_OBJECT deviceObject, IN PDRIVER_OBJECT driverObject, IN UCHAR EntrySize);
 VOID IopNotifyAlreadyRegisteredFileSystems(IN PLIST_ENTRY  ListHead,
                                            IN PDRIVER_FS_NOTIFICATION DriverNotificationRoutine,
@@ -0,0 +1,1141 @@
+/*
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+You may only use this code if you agree to the terms of the Windows Research Kernel Source Code License agreement (see License.txt).
+If you do not agree to the terms, do not use the code.
+
+Module Name:
+    ioring.c
+
+Abstract:
+    This module implements the executive I/O ring object.
+    An I/O ring pairs a submission queue in the caller's address space with an I/O completion object,
+    so that a caller can issue many read and write requests with a single system call and reap their completions in batches.
+*/
+
+#include "iomgr.h"
+
+// Define forward referenced function prototypes.
+NTSTATUS IopSubmitIoRingEntry(IN PIOP_IO_RING IoRing, IN PIO_RING_SUBMISSION_ENTRY Entry, IN KPROCESSOR_MODE PreviousMode);
+NTSTATUS IopIssueIoRingRequest(IN PIOP_IO_RING IoRing,
+                               IN PIO_RING_SUBMISSION_ENTRY Entry,
+                               IN PFILE_OBJECT FileObject,
+                               IN ACCESS_MASK GrantedAccess,
+                               IN PIOP_IO_RING_BUFFERS Buffers OPTIONAL,
+                               IN KPROCESSOR_MODE PreviousMode);
+NTSTATUS IopCompleteIoRingRequest(IN PDEVICE_OBJECT DeviceObject, IN PIRP Irp, IN PVOID Context);
+VOID IopFinishIoRingRequest(IN PIRP Irp);
+VOID IopRundownIoRing(IN PIOP_IO_RING IoRing);
+VOID IopReleaseIoRingFiles(IN PIOP_IO_RING_FILE Files, IN ULONG Count);
+VOID IopDereferenceIoRingBuffers(IN PIOP_IO_RING_BUFFERS Buffers);
+
+// Define section types for appropriate functions.
+#pragma alloc_text(PAGE, NtCreateIoRing)
+#pragma alloc_text(PAGE, NtSubmitIoRing)
+#pragma alloc_text(PAGE, NtRegisterIoRingFiles)
+#pragma alloc_text(PAGE, NtRegisterIoRingBuffers)
+#pragma alloc_text(PAGE, IopSubmitIoRingEntry)
+#pragma alloc_text(PAGE, IopIssueIoRingRequest)
+#pragma alloc_text(PAGE, IopRundownIoRing)
+#pragma alloc_text(PAGE, IopReleaseIoRingFiles)
+#pragma alloc_text(PAGE, IopOpenIoRing)
+#pragma alloc_text(PAGE, IopCloseIoRing)
+#pragma alloc_text(PAGE, IopDeleteIoRing)
+
+
+NTSTATUS NtCreateIoRing(__out PHANDLE IoRingHandle,
+                        __in ACCESS_MASK DesiredAccess,
+                        __in_opt POBJECT_ATTRIBUTES ObjectAttributes,
+                        __in HANDLE IoCompletionHandle,
+                        __in_opt PVOID CompletionKey,
+                        __in PIO_RING_SUBMISSION_QUEUE SubmissionQueue,
+                        __in ULONG EntryCount
+)
+/*
+Routine Description:
+    This function creates an I/O ring object over the specified submission queue and opens a handle to the object with the specified desired access.
+    The handle cannot be duplicated or inherited: the ring is usable only by the creating process, and closing its last handle drains the ring's requests.
+Arguments:
+    IoRingHandle - Supplies a pointer to a variable that receives the I/O ring object handle.
+    DesiredAccess - Supplies the desired types of access for the I/O ring object.
+    ObjectAttributes - Supplies a pointer to an object attributes structure.
+    IoCompletionHandle - Supplies a handle to the I/O completion object that receives a completion for every submitted entry.
+    CompletionKey - Supplies the key context returned with every completion of the ring.
+    SubmissionQueue - Supplies a pointer to the submission queue in the caller's address space.
+    EntryCount - Supplies the number of entries in the submission queue. This must be a power of two no larger than IO_RING_MAXIMUM_ENTRIES.
+Return Value:
+    STATUS_SUCCESS is returned if the function is success. Otherwise, an error status is returned.
+*/
+{
+    HANDLE Handle;
+    PVOID IoCompletion;
+    PIOP_IO_RING IoRing;
+    KPROCESSOR_MODE PreviousMode;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    if ((EntryCount == 0) || (EntryCount > IO_RING_MAXIMUM_ENTRIES) || ((EntryCount & (EntryCount - 1)) != 0)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    // Establish an exception handler and probe the output handle address and the submission queue.
+    // If either probe fails, then return the exception code as the service status.
+    PreviousMode = KeGetPreviousMode();
+    try {
+        if (PreviousMode != KernelMode) {
+            ProbeForWriteHandle(IoRingHandle);
+            ProbeForWrite(SubmissionQueue,
+                          FIELD_OFFSET(IO_RING_SUBMISSION_QUEUE, Entries) + (EntryCount * sizeof(IO_RING_SUBMISSION_ENTRY)),
+                          sizeof(ULONG_PTR));
+        }
+    } except(ExSystemExceptionFilter())
+    {
+        return GetExceptionCode();
+    }
+
+    // Reference the I/O completion object that will receive the completions for the ring.
+    Status = ObReferenceObjectByHandle(IoCompletionHandle, IO_COMPLETION_MODIFY_STATE, IoCompletionObjectType, PreviousMode, &IoCompletion, NULL);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    // Allocate and initialize the I/O ring object.
+    // Once the object is created, the delete routine releases the completion object and process references.
+    Status = ObCreateObject(PreviousMode, IoRingObjectType, ObjectAttributes, PreviousMode, NULL, sizeof(IOP_IO_RING), 0, 0, (PVOID *)&IoRing);
+    if (!NT_SUCCESS(Status)) {
+        ObDereferenceObject(IoCompletion);
+        return Status;
+    }
+
+    IoRing->Process = PsGetCurrentProcess();
+    ObReferenceObject(IoRing->Process);
+    IoRing->IoCompletion = IoCompletion;
+    IoRing->CompletionKey = CompletionKey;
+    IoRing->SubmissionQueue = SubmissionQueue;
+    IoRing->EntryCount = EntryCount;
+    ExInitializePushLock(&IoRing->SubmitLock);
+    IoRing->Files = NULL;
+    IoRing->FileCount = 0;
+    IoRing->Buffers = NULL;
+    KeInitializeSpinLock(&IoRing->IrpLock);
+    InitializeListHead(&IoRing->IrpList);
+    IoRing->RunDown = FALSE;
+    IoRing->CancelIrpCompleted = FALSE;
+    IoRing->CancelIrp = NULL;
+    KeInitializeEvent(&IoRing->DrainEvent, NotificationEvent, FALSE);
+
+    Status = ObInsertObject(IoRing, NULL, DesiredAccess, 0, (PVOID *)NULL, &Handle);
+    if (NT_SUCCESS(Status)) {
+        try {
+            *IoRingHandle = Handle;
+        } except(ExSystemExceptionFilter())
+        {// If the write attempt fails, then do not report an error.
+            NOTHING;// When the caller attempts to access the handle value, an access violation will occur.
+        }
+    }
+
+    return Status;
+}
+
+
+NTSTATUS NtSubmitIoRing(__in HANDLE IoRingHandle, __in ULONG Count OPTIONAL, __out_opt PULONG NumberSubmitted)
+/*
+Routine Description:
+    This function submits the entries the caller has queued between the head and the tail of an I/O ring submission queue.
+    Each entry is issued as an I/O request; its completion is posted to the ring's I/O completion object with the entry's user context as the apc context.
+    An entry that fails before its request could be queued is completed immediately with the failure status, so exactly one completion is posted for every consumed entry that has a user context.
+    Entries with a NULL user context are issued without a completion, as for NtReadFile and NtWriteFile.
+    The submit lock is held only while an entry is captured and the head advanced past it; the entry is issued after the lock is released,
+    so a request that is slow to issue does not hold up other submitting threads.
+Arguments:
+    IoRingHandle - Supplies a handle to an I/O ring object.
+    Count - Supplies the maximum number of entries to submit. If zero, all queued entries are submitted.
+    NumberSubmitted - Supplies an optional pointer to a variable that receives the number of entries consumed.
+Return Value:
+    STATUS_SUCCESS is returned if the queue was consumed as requested. Otherwise, an error status is returned and the head index reflects the entries consumed.
+*/
+{
+    BOOLEAN Captured;
+    IO_RING_SUBMISSION_ENTRY Entry;
+    ULONG Head;
+    PIOP_IO_RING IoRing;
+    ULONG Limit;
+    ULONG Pending;
+    KPROCESSOR_MODE PreviousMode;
+    PIO_RING_SUBMISSION_QUEUE Queue;
+    NTSTATUS Status;
+    ULONG Submitted;
+    ULONG Tail;
+
+    PAGED_CODE();
+
+    PreviousMode = KeGetPreviousMode();
+    if ((PreviousMode != KernelMode) && ARGUMENT_PRESENT(NumberSubmitted)) {
+        try {
+            ProbeForWriteUlong(NumberSubmitted);
+        } except(ExSystemExceptionFilter())
+        {
+            return GetExceptionCode();
+        }
+    }
+
+    Status = ObReferenceObjectByHandle(IoRingHandle, IO_RING_SUBMIT, IoRingObjectType, PreviousMode, (PVOID *)&IoRing, NULL);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    // The submission queue address is only meaningful in the process that created the ring.
+    if (IoRing->Process != PsGetCurrentProcess()) {
+        ObDereferenceObject(IoRing);
+        return STATUS_ACCESS_DENIED;
+    }
+
+    Queue = IoRing->SubmissionQueue;
+    if (PreviousMode != KernelMode) {
+        try {
+            ProbeForWrite(Queue,
+                          FIELD_OFFSET(IO_RING_SUBMISSION_QUEUE, Entries) + (IoRing->EntryCount * sizeof(IO_RING_SUBMISSION_ENTRY)),
+                          sizeof(ULONG_PTR));
+        } except(ExSystemExceptionFilter())
+        {
+            ObDereferenceObject(IoRing);
+            return GetExceptionCode();
+        }
+    }
+
+    // The number of entries to submit is fixed by the first capture. Entries the caller queues after this point are left for the next call.
+    Limit = MAXULONG;
+    Submitted = 0;
+
+    KeEnterCriticalRegion();
+    while (Submitted < Limit) {
+        Captured = FALSE;
+        ExAcquirePushLockExclusive(&IoRing->SubmitLock);
+        try {
+            Head = *((volatile ULONG *)&Queue->Head);
+            Tail = *((volatile ULONG *)&Queue->Tail);
+            Pending = Tail - Head;
+            if (Pending > IoRing->EntryCount) {
+                Status = STATUS_INVALID_PARAMETER;
+                leave;
+            }
+
+            if (Limit == MAXULONG) {
+                Limit = ((Count != 0) && (Pending > Count)) ? Count : Pending;
+            }
+
+            if (Pending != 0) {
+                Entry = Queue->Entries[Head & (IoRing->EntryCount - 1)];
+
+                // Read the entry before consuming it, so the caller may refill the slot as soon as the head moves past it.
+                // Only the captured copy is used from here on.
+                KeMemoryBarrierWithoutFence();
+                *((volatile ULONG *)&Queue->Head) = Head + 1;
+                Captured = TRUE;
+            }
+        } except(ExSystemExceptionFilter())
+        {
+            Status = GetExceptionCode();
+        }
+
+        ExReleasePushLockExclusive(&IoRing->SubmitLock);
+        if (!Captured) {
+            break;
+        }
+
+        Submitted += 1;
+        (VOID)IopSubmitIoRingEntry(IoRing, &Entry, PreviousMode);
+    }
+
+    KeLeaveCriticalRegion();
+    ObDereferenceObject(IoRing);
+
+    if (ARGUMENT_PRESENT(NumberSubmitted)) {
+        try {
+            *NumberSubmitted = Submitted;
+        } except(ExSystemExceptionFilter())
+        {
+            NOTHING;
+        }
+    }
+
+    return Status;
+}
+
+
+NTSTATUS IopSubmitIoRingEntry(IN PIOP_IO_RING IoRing, IN PIO_RING_SUBMISSION_ENTRY Entry, IN KPROCESSOR_MODE PreviousMode)
+/*
+Routine Description:
+    This routine issues a single captured submission queue entry.
+    The file of a read or write entry is referenced either from the ring's registered set or through its handle.
+    Requests that fail before an I/O request could be queued are completed to the ring's I/O completion object directly.
+    The caller must be in a critical region and must not hold the ring's submit lock.
+Arguments:
+    IoRing - Supplies a pointer to the I/O ring object.
+    Entry - Supplies a pointer to the captured entry.
+    PreviousMode - Supplies the mode of the submitting caller.
+Return Value:
+    STATUS_PENDING is returned once a request has been passed to the driver. Otherwise, the status the entry was completed with is returned.
+*/
+{
+    PIOP_IO_RING_BUFFERS Buffers;
+    PIOP_IO_RING_FILE File;
+    PFILE_OBJECT FileObject;
+    ACCESS_MASK GrantedAccess;
+    OBJECT_HANDLE_INFORMATION HandleInformation;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    switch (Entry->Operation) {
+    case IoRingOperationNop:
+        Status = STATUS_SUCCESS;
+        break;
+    case IoRingOperationRead:
+    case IoRingOperationWrite:
+        Buffers = NULL;
+        FileObject = NULL;
+        GrantedAccess = 0;
+        if (Entry->Flags & IO_RING_ENTRY_REGISTERED) {
+            // Reference the registered file and buffer set, so that neither is released by a registration while the request is outstanding.
+            Status = STATUS_INVALID_PARAMETER;
+            ExAcquirePushLockShared(&IoRing->SubmitLock);
+            if (((ULONG_PTR)Entry->FileHandle < IoRing->FileCount) &&
+                (IoRing->Buffers != NULL) && (Entry->BufferIndex < IoRing->Buffers->Count)) {
+                File = &IoRing->Files[(ULONG_PTR)Entry->FileHandle];
+                FileObject = File->FileObject;
+                GrantedAccess = File->GrantedAccess;
+                ObReferenceObject(FileObject);
+                Buffers = IoRing->Buffers;
+                InterlockedIncrement(&Buffers->ReferenceCount);
+                Status = STATUS_SUCCESS;
+            }
+
+            ExReleasePushLockShared(&IoRing->SubmitLock);
+        } else {
+            Status = ObReferenceObjectByHandle(Entry->FileHandle, 0, IoFileObjectType, PreviousMode, (PVOID *)&FileObject, &HandleInformation);
+            if (NT_SUCCESS(Status)) {
+                GrantedAccess = HandleInformation.GrantedAccess;
+            }
+        }
+
+        if (!NT_SUCCESS(Status)) {
+            break;
+        }
+
+        // The request takes over the references once it has been issued.
+        Status = IopIssueIoRingRequest(IoRing, Entry, FileObject, GrantedAccess, Buffers, PreviousMode);
+        if (Status != STATUS_PENDING) {
+            if (Buffers != NULL) {
+                IopDereferenceIoRingBuffers(Buffers);
+            }
+
+            ObDereferenceObject(FileObject);
+        }
+        break;
+    default:
+        Status = STATUS_INVALID_PARAMETER;
+        break;
+    }
+
+    // A request that failed without being queued, or an operation the I/O system does not perform, posts no completion of its own.
+    // A nop completes here as well, which lets the caller wake a thread waiting on the completion object.
+    if (Status != STATUS_PENDING) {
+        if (Entry->UserContext != NULL) {
+            IoSetIoCompletion(IoRing->IoCompletion, IoRing->CompletionKey, Entry->UserContext, Status, 0, TRUE);
+        }
+    }
+
+    return Status;
+}
+
+
+NTSTATUS IopIssueIoRingRequest(IN PIOP_IO_RING IoRing,
+                               IN PIO_RING_SUBMISSION_ENTRY Entry,
+                               IN PFILE_OBJECT FileObject,
+                               IN ACCESS_MASK GrantedAccess,
+                               IN PIOP_IO_RING_BUFFERS Buffers OPTIONAL,
+                               IN KPROCESSOR_MODE PreviousMode
+)
+/*
+Routine Description:
+    This routine issues a read or write entry of an I/O ring.
+    The IRP is built directly rather than through the read and write services, so that every request, registered or not, completes through the ring.
+    The buffer of a registered entry is already locked and mapped, so there is no probe and lock and no system buffer.
+    The buffer of any other entry is probed and locked here, in the caller's mode, and stays locked until the request completes.
+    The IRP is thread agnostic. It is linked into the ring rather than the current thread, so that it neither refers to a thread that may exit before it completes
+    nor needs an APC to complete; it completes through IopCompleteIoRingRequest, which posts it to the ring's I/O completion object.
+Arguments:
+    IoRing - Supplies a pointer to the I/O ring object.
+    Entry - Supplies a pointer to the captured entry.
+    FileObject - Supplies a referenced pointer to the target file object.
+    GrantedAccess - Supplies the access granted to the file through the registration or the handle.
+    Buffers - Supplies a referenced pointer to the registered buffer set for a registered entry. Otherwise, NULL.
+    PreviousMode - Supplies the mode of the submitting caller; the request is issued in this mode so the file system applies its usual checks.
+Return Value:
+    STATUS_PENDING is returned once the request has been passed to the driver; the request then owns the file and buffer set references,
+    and its outcome is reported through the completion.
+    Otherwise, an error status is returned, no request was issued, and the references remain the caller's.
+*/
+{
+    PIOP_IO_RING_BUFFER Buffer;
+    ULONG BufferOffset;
+    PDEVICE_OBJECT DeviceObject;
+    LARGE_INTEGER FileOffset;
+    PIRP Irp;
+    PIO_STACK_LOCATION IrpSp;
+    KIRQL Irql;
+    PMDL Mdl;
+    NTSTATUS Status;
+    PUCHAR SystemAddress;
+    PUCHAR UserAddress;
+    BOOLEAN WriteToEnd;
+
+    PAGED_CODE();
+
+    // Requests are issued without the file object lock that synchronous I/O relies on.
+    if (FileObject->Flags & FO_SYNCHRONOUS_IO) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    // Apply the access and offset checks the read and write services make against the handle.
+    FileOffset = Entry->ByteOffset;
+    if (Entry->Operation == IoRingOperationRead) {
+        if (!(GrantedAccess & FILE_READ_DATA)) {
+            return STATUS_ACCESS_DENIED;
+        }
+
+        if (FileOffset.HighPart < 0) {
+            return STATUS_INVALID_PARAMETER;
+        }
+    } else {
+        WriteToEnd = (BOOLEAN)((FileOffset.LowPart == FILE_WRITE_TO_END_OF_FILE) && (FileOffset.HighPart == -1));
+        if (!(GrantedAccess & FILE_WRITE_DATA) && !(WriteToEnd && (GrantedAccess & FILE_APPEND_DATA))) {
+            return STATUS_ACCESS_DENIED;
+        }
+
+        if ((FileOffset.HighPart < 0) && !WriteToEnd) {
+            return STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    DeviceObject = IoGetRelatedDeviceObject(FileObject);
+    if (Buffers != NULL) {
+        BufferOffset = (ULONG)(ULONG_PTR)Entry->Buffer;
+        Buffer = &Buffers->Buffer[Entry->BufferIndex];
+        if (((ULONG_PTR)Entry->Buffer != BufferOffset) ||
+            (BufferOffset > Buffer->Length) || (Entry->Length > (Buffer->Length - BufferOffset))) {
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        UserAddress = (PUCHAR)MmGetMdlVirtualAddress(Buffer->Mdl) + BufferOffset;
+        SystemAddress = Buffer->SystemAddress + BufferOffset;
+    } else {
+        Buffer = NULL;
+        UserAddress = (PUCHAR)Entry->Buffer;
+        SystemAddress = NULL;
+    }
+
+    if (FileObject->Flags & FO_NO_INTERMEDIATE_BUFFERING) {
+        if ((DeviceObject->SectorSize && (Entry->Length % DeviceObject->SectorSize)) ||
+            ((ULONG_PTR)UserAddress & DeviceObject->AlignmentRequirement) ||
+            (DeviceObject->SectorSize && (FileOffset.LowPart % DeviceObject->SectorSize) && (FileOffset.HighPart >= 0))) {
+            return STATUS_INVALID_PARAMETER;
+        }
+    }
+
+    // Allocate one stack location more than the target needs.
+    // The top location belongs to the ring and carries the references the completion routine releases.
+    Irp = IoAllocateIrp((CCHAR)(DeviceObject->StackSize + 1), FALSE);
+    if (Irp == NULL) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    // Describe the transfer with an MDL, so neither the I/O system nor the file system needs to lock the pages again.
+    // A registered buffer is described by a partial MDL of its locked buffer, unless the device buffers its data.
+    // Any other buffer is probed and locked in the caller's mode, and mapped into system space if the device buffers its data.
+    Mdl = NULL;
+    if (Entry->Length != 0) {
+        if (Buffers != NULL) {
+            if (!(DeviceObject->Flags & DO_BUFFERED_IO)) {
+                Mdl = IoAllocateMdl(UserAddress, Entry->Length, FALSE, FALSE, NULL);
+                if (Mdl == NULL) {
+                    IoFreeIrp(Irp);
+                    return STATUS_INSUFFICIENT_RESOURCES;
+                }
+
+                IoBuildPartialMdl(Buffer->Mdl, Mdl, UserAddress, Entry->Length);
+            }
+        } else {
+            Mdl = IoAllocateMdl(UserAddress, Entry->Length, FALSE, FALSE, NULL);
+            if (Mdl == NULL) {
+                IoFreeIrp(Irp);
+                return STATUS_INSUFFICIENT_RESOURCES;
+            }
+
+            try {
+                MmProbeAndLockPages(Mdl, PreviousMode, (Entry->Operation == IoRingOperationRead) ? IoWriteAccess : IoReadAccess);
+            } except(EXCEPTION_EXECUTE_HANDLER)
+            {
+                IoFreeMdl(Mdl);
+                IoFreeIrp(Irp);
+                return GetExceptionCode();
+            }
+
+            if (DeviceObject->Flags & DO_BUFFERED_IO) {
+                SystemAddress = MmGetSystemAddressForMdlSafe(Mdl, NormalPagePriority);
+                if (SystemAddress == NULL) {
+                    MmUnlockPages(Mdl);
+                    IoFreeMdl(Mdl);
+                    IoFreeIrp(Irp);
+                    return STATUS_INSUFFICIENT_RESOURCES;
+                }
+            }
+        }
+    }
+
+    // The request carries the caller's mode, so a device that neither buffers nor maps the data is handed the caller's own address,
+    // which it accesses while the request is being issued in the caller's context.
+    // A buffered device is handed the system mapping of the locked buffer as its system buffer.
+    Irp->Tail.Overlay.OriginalFileObject = FileObject;
+    Irp->Tail.Overlay.Thread = NULL;
+    Irp->RequestorMode = PreviousMode;
+    Irp->Overlay.AsynchronousParameters.UserApcContext = Entry->UserContext;
+    Irp->UserBuffer = UserAddress;
+    if (DeviceObject->Flags & DO_BUFFERED_IO) {
+        Irp->AssociatedIrp.SystemBuffer = SystemAddress;
+    } else {
+        Irp->MdlAddress = Mdl;
+    }
+
+    Irp->Flags = (Entry->Operation == IoRingOperationRead) ? IRP_READ_OPERATION : IRP_WRITE_OPERATION;
+    if (FileObject->Flags & FO_NO_INTERMEDIATE_BUFFERING) {
+        Irp->Flags |= IRP_NOCACHE;
+    }
+
+    IoSetNextIrpStackLocation(Irp);
+    IrpSp = IoGetCurrentIrpStackLocation(Irp);
+    IrpSp->Parameters.Others.Argument1 = IoRing;
+    IrpSp->Parameters.Others.Argument2 = Buffers;
+    IrpSp->Parameters.Others.Argument3 = Mdl;
+
+    IrpSp = IoGetNextIrpStackLocation(Irp);
+    IrpSp->FileObject = FileObject;
+    if (Entry->Operation == IoRingOperationRead) {
+        IrpSp->MajorFunction = IRP_MJ_READ;
+        IrpSp->Parameters.Read.Length = Entry->Length;
+        IrpSp->Parameters.Read.Key = 0;
+        IrpSp->Parameters.Read.ByteOffset = FileOffset;
+    } else {
+        IrpSp->MajorFunction = IRP_MJ_WRITE;
+        IrpSp->Parameters.Write.Length = Entry->Length;
+        IrpSp->Parameters.Write.Key = 0;
+        IrpSp->Parameters.Write.ByteOffset = FileOffset;
+    }
+
+    IoSetCompletionRoutine(Irp, IopCompleteIoRingRequest, NULL, TRUE, TRUE, TRUE);
+
+    // Link the request into the ring, unless the last handle to the ring has already been closed.
+    KeAcquireSpinLock(&IoRing->IrpLock, &Irql);
+    Status = IoRing->RunDown ? STATUS_INVALID_HANDLE : STATUS_SUCCESS;
+    if (NT_SUCCESS(Status)) {
+        InsertTailList(&IoRing->IrpList, &Irp->ThreadListEntry);
+    }
+
+    KeReleaseSpinLock(&IoRing->IrpLock, Irql);
+
+    if (!NT_SUCCESS(Status)) {
+        if (Mdl != NULL) {
+            if (Buffers == NULL) {
+                MmUnlockPages(Mdl);
+            }
+
+            IoFreeMdl(Mdl);
+        }
+
+        IoFreeIrp(Irp);
+        return Status;
+    }
+
+    if (Entry->Operation == IoRingOperationRead) {
+        IopUpdateReadOperationCount();
+    } else {
+        IopUpdateWriteOperationCount();
+    }
+
+    ObReferenceObject(IoRing);
+    (VOID)IoCallDriver(DeviceObject, Irp);
+    return STATUS_PENDING;
+}
+
+
+NTSTATUS IopCompleteIoRingRequest(IN PDEVICE_OBJECT DeviceObject, IN PIRP Irp, IN PVOID Context)
+/*
+Routine Description:
+    This routine is the completion routine for requests issued by an I/O ring.
+    It unlinks the request from the ring and finishes it with IopFinishIoRingRequest,
+    unless the ring's rundown is cancelling this very request, in which case the rundown finishes it once IoCancelIrp has returned.
+Arguments:
+    DeviceObject - Unused.
+    Irp - Supplies a pointer to the completed IRP.
+    Context - Unused.
+Return Value:
+    STATUS_MORE_PROCESSING_REQUIRED, since the IRP is now owned by the ring.
+*/
+{
+    PIOP_IO_RING IoRing;
+    PIO_STACK_LOCATION IrpSp;
+    KIRQL Irql;
+
+    UNREFERENCED_PARAMETER(DeviceObject);
+    UNREFERENCED_PARAMETER(Context);
+
+    IrpSp = IoGetCurrentIrpStackLocation(Irp);
+    IoRing = (PIOP_IO_RING)IrpSp->Parameters.Others.Argument1;
+
+    KeAcquireSpinLock(&IoRing->IrpLock, &Irql);
+    RemoveEntryList(&Irp->ThreadListEntry);
+    InitializeListHead(&Irp->ThreadListEntry);
+    if (IoRing->CancelIrp == Irp) {
+        IoRing->CancelIrpCompleted = TRUE;
+        KeReleaseSpinLock(&IoRing->IrpLock, Irql);
+        return STATUS_MORE_PROCESSING_REQUIRED;
+    }
+
+    if (IoRing->RunDown) {
+        KeSetEvent(&IoRing->DrainEvent, 0, FALSE);
+    }
+
+    KeReleaseSpinLock(&IoRing->IrpLock, Irql);
+
+    IopFinishIoRingRequest(Irp);
+    return STATUS_MORE_PROCESSING_REQUIRED;
+}
+
+
+VOID IopFinishIoRingRequest(IN PIRP Irp)
+/*
+Routine Description:
+    This routine finishes a completed request of an I/O ring and releases the references the request holds.
+    The IRP itself is queued to the ring's I/O completion object as the completion packet, exactly as IopCompleteRequest would queue it,
+    but without first running a special kernel APC in the submitting thread: there is no user I/O status block, event, or buffer copy to process.
+    It may be called at DISPATCH_LEVEL.
+Arguments:
+    Irp - Supplies a pointer to the completed IRP, which has already been unlinked from the ring.
+*/
+{
+    PIOP_IO_RING_BUFFERS Buffers;
+    PFILE_OBJECT FileObject;
+    PIOP_IO_RING IoRing;
+    PIO_STACK_LOCATION IrpSp;
+    PMDL Mdl;
+
+    // Capture everything needed from the IRP before queuing it, since it may be removed and freed at once.
+    IrpSp = IoGetCurrentIrpStackLocation(Irp);
+    IoRing = (PIOP_IO_RING)IrpSp->Parameters.Others.Argument1;
+    Buffers = (PIOP_IO_RING_BUFFERS)IrpSp->Parameters.Others.Argument2;
+    Mdl = (PMDL)IrpSp->Parameters.Others.Argument3;
+    FileObject = Irp->Tail.Overlay.OriginalFileObject;
+
+    // The MDL of a registered buffer is a partial MDL of the locked buffer. Any other MDL locked the caller's buffer for this request alone.
+    Irp->MdlAddress = NULL;
+    if (Mdl != NULL) {
+        if (Buffers == NULL) {
+            MmUnlockPages(Mdl);
+        }
+
+        IoFreeMdl(Mdl);
+    }
+
+    if (Irp->Overlay.AsynchronousParameters.UserApcContext != NULL) {
+        Irp->Tail.CompletionKey = IoRing->CompletionKey;
+        Irp->Tail.Overlay.PacketType = IopCompletionPacketIrp;
+        KeInsertQueue((PKQUEUE)IoRing->IoCompletion, &Irp->Tail.Overlay.ListEntry);
+    } else {
+        IoFreeIrp(Irp);
+    }
+
+    if (Buffers != NULL) {
+        IopDereferenceIoRingBuffers(Buffers);
+    }
+
+    ObDereferenceObject(FileObject);
+    ObDereferenceObject(IoRing);
+}
+
+
+VOID IopRundownIoRing(IN PIOP_IO_RING IoRing)
+/*
+Routine Description:
+    This routine runs down an I/O ring when its last handle is closed, which at the latest happens when the owning process's handle table is run down.
+    No further requests are issued, every outstanding request is cancelled and waited for, and the registered files and buffers are released,
+    so that no page of the process is left locked once its address space is deleted.
+Arguments:
+    IoRing - Supplies a pointer to the I/O ring object.
+*/
+{
+    PIOP_IO_RING_BUFFERS Buffers;
+    BOOLEAN Completed;
+    PLIST_ENTRY Entry;
+    ULONG FileCount;
+    PIOP_IO_RING_FILE Files;
+    LARGE_INTEGER Interval;
+    PIRP Irp;
+    KIRQL Irql;
+
+    PAGED_CODE();
+
+    KeEnterCriticalRegion();
+    ExAcquirePushLockExclusive(&IoRing->SubmitLock);
+    Files = IoRing->Files;
+    FileCount = IoRing->FileCount;
+    Buffers = IoRing->Buffers;
+    IoRing->Files = NULL;
+    IoRing->FileCount = 0;
+    IoRing->Buffers = NULL;
+    KeAcquireSpinLock(&IoRing->IrpLock, &Irql);
+    IoRing->RunDown = TRUE;
+    KeReleaseSpinLock(&IoRing->IrpLock, Irql);
+    ExReleasePushLockExclusive(&IoRing->SubmitLock);
+    KeLeaveCriticalRegion();
+
+    // Cancel each request that has not been cancelled yet, one at a time.
+    // The request is named in CancelIrp while IoCancelIrp runs, so that a completion racing with the cancel leaves the IRP to this routine rather than freeing it.
+    // Once every remaining request has been cancelled, wait for them to complete, polling in case a driver completes a request without cancelling it.
+    Interval.QuadPart = -10 * 1000 * 100;
+    for (;;) {
+        KeAcquireSpinLock(&IoRing->IrpLock, &Irql);
+        if (IsListEmpty(&IoRing->IrpList)) {
+            KeReleaseSpinLock(&IoRing->IrpLock, Irql);
+            break;
+        }
+
+        Irp = NULL;
+        for (Entry = IoRing->IrpList.Flink; Entry != &IoRing->IrpList; Entry = Entry->Flink) {
+            if (!CONTAINING_RECORD(Entry, IRP, ThreadListEntry)->Cancel) {
+                Irp = CONTAINING_RECORD(Entry, IRP, ThreadListEntry);
+                break;
+            }
+        }
+
+        if (Irp == NULL) {
+            KeClearEvent(&IoRing->DrainEvent);
+            KeReleaseSpinLock(&IoRing->IrpLock, Irql);
+            (VOID)KeWaitForSingleObject(&IoRing->DrainEvent, Executive, KernelMode, FALSE, &Interval);
+            continue;
+        }
+
+        IoRing->CancelIrp = Irp;
+        IoRing->CancelIrpCompleted = FALSE;
+        KeReleaseSpinLock(&IoRing->IrpLock, Irql);
+
+        (VOID)IoCancelIrp(Irp);
+
+        KeAcquireSpinLock(&IoRing->IrpLock, &Irql);
+        IoRing->CancelIrp = NULL;
+        Completed = IoRing->CancelIrpCompleted;
+        KeReleaseSpinLock(&IoRing->IrpLock, Irql);
+        if (Completed) {
+            IopFinishIoRingRequest(Irp);
+        }
+    }
+
+    if (Files != NULL) {
+        IopReleaseIoRingFiles(Files, FileCount);
+    }
+
+    if (Buffers != NULL) {
+        IopDereferenceIoRingBuffers(Buffers);
+    }
+}
+
+
+NTSTATUS NtRegisterIoRingFiles(__in HANDLE IoRingHandle, __in ULONG Count, __in_ecount_opt(Count) PHANDLE FileHandles)
+/*
+Routine Description:
+    This function replaces the set of files registered with an I/O ring.
+    Each file object is referenced once here, so registered entries name files by index and skip the handle lookup.
+    Requests already issued against the previous set are not affected.
+Arguments:
+    IoRingHandle - Supplies a handle to an I/O ring object.
+    Count - Supplies the number of handles. If zero, the registered files are released.
+    FileHandles - Supplies an array of handles to files opened for asynchronous I/O.
+Return Value:
+    STATUS_SUCCESS is returned if the function is success. Otherwise, an error status is returned and the registered set is unchanged.
+*/
+{
+    PIOP_IO_RING_FILE Files;
+    PFILE_OBJECT FileObject;
+    OBJECT_HANDLE_INFORMATION HandleInformation;
+    HANDLE Handle;
+    ULONG Index;
+    PIOP_IO_RING IoRing;
+    ULONG OldCount;
+    PIOP_IO_RING_FILE OldFiles;
+    KPROCESSOR_MODE PreviousMode;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    if (Count > IO_RING_MAXIMUM_REGISTERED_FILES) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    PreviousMode = KeGetPreviousMode();
+    if ((PreviousMode != KernelMode) && (Count != 0)) {
+        try {
+            ProbeForRead(FileHandles, Count * sizeof(HANDLE), sizeof(HANDLE));
+        } except(ExSystemExceptionFilter())
+        {
+            return GetExceptionCode();
+        }
+    }
+
+    Status = ObReferenceObjectByHandle(IoRingHandle, IO_RING_REGISTER, IoRingObjectType, PreviousMode, (PVOID *)&IoRing, NULL);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    if (IoRing->Process != PsGetCurrentProcess()) {
+        ObDereferenceObject(IoRing);
+        return STATUS_ACCESS_DENIED;
+    }
+
+    // Reference each file object, remembering the access granted through its handle.
+    Files = NULL;
+    Index = 0;
+    if (Count != 0) {
+        Files = ExAllocatePoolWithQuotaTag(PagedPool | POOL_QUOTA_FAIL_INSTEAD_OF_RAISE, Count * sizeof(IOP_IO_RING_FILE), 'fRoI');
+        if (Files == NULL) {
+            ObDereferenceObject(IoRing);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        for (Index = 0; Index < Count; Index += 1) {
+            try {
+                Handle = FileHandles[Index];
+            } except(ExSystemExceptionFilter())
+            {
+                Status = GetExceptionCode();
+                break;
+            }
+
+            Status = ObReferenceObjectByHandle(Handle, 0, IoFileObjectType, PreviousMode, (PVOID *)&FileObject, &HandleInformation);
+            if (!NT_SUCCESS(Status)) {
+                break;
+            }
+
+            // Registered requests are issued without the file object lock that synchronous I/O relies on.
+            if (FileObject->Flags & FO_SYNCHRONOUS_IO) {
+                ObDereferenceObject(FileObject);
+                Status = STATUS_INVALID_PARAMETER;
+                break;
+            }
+
+            Files[Index].FileObject = FileObject;
+            Files[Index].GrantedAccess = HandleInformation.GrantedAccess;
+        }
+
+        if (!NT_SUCCESS(Status)) {
+            IopReleaseIoRingFiles(Files, Index);
+            ObDereferenceObject(IoRing);
+            return Status;
+        }
+    }
+
+    KeEnterCriticalRegion();
+    ExAcquirePushLockExclusive(&IoRing->SubmitLock);
+    if (IoRing->RunDown) {// A ring whose last handle is closed keeps no registrations, so release the new set instead.
+        OldFiles = Files;
+        OldCount = Count;
+        Status = STATUS_INVALID_HANDLE;
+    } else {
+        OldFiles = IoRing->Files;
+        OldCount = IoRing->FileCount;
+        IoRing->Files = Files;
+        IoRing->FileCount = Count;
+        Status = STATUS_SUCCESS;
+    }
+    ExReleasePushLockExclusive(&IoRing->SubmitLock);
+    KeLeaveCriticalRegion();
+
+    if (OldFiles != NULL) {
+        IopReleaseIoRingFiles(OldFiles, OldCount);
+    }
+
+    ObDereferenceObject(IoRing);
+    return Status;
+}
+
+
+NTSTATUS NtRegisterIoRingBuffers(__in HANDLE IoRingHandle, __in ULONG Count, __in_ecount_opt(Count) PIO_RING_BUFFER_REGISTRATION Buffers)
+/*
+Routine Description:
+    This function replaces the set of buffers registered with an I/O ring.
+    Each buffer is probed, locked and mapped into system space once here, so registered entries name buffers by index and skip the per request probe, lock and MDL build.
+    The previous set stays locked until the last request issued against it completes, and every set is unlocked when the last handle to the ring is closed.
+Arguments:
+    IoRingHandle - Supplies a handle to an I/O ring object.
+    Count - Supplies the number of buffers. If zero, the registered buffers are released.
+    Buffers - Supplies an array describing the buffers. Every buffer must be writable, since it may be the target of a read.
+Return Value:
+    STATUS_SUCCESS is returned if the function is success. Otherwise, an error status is returned and the registered set is unchanged.
+*/
+{
+    IO_RING_BUFFER_REGISTRATION Capture;
+    ULONG Index;
+    PIOP_IO_RING IoRing;
+    PMDL Mdl;
+    PIOP_IO_RING_BUFFERS NewBuffers;
+    PIOP_IO_RING_BUFFERS OldBuffers;
+    KPROCESSOR_MODE PreviousMode;
+    NTSTATUS Status;
+
+    PAGED_CODE();
+
+    if (Count > IO_RING_MAXIMUM_REGISTERED_BUFFERS) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    PreviousMode = KeGetPreviousMode();
+    if ((PreviousMode != KernelMode) && (Count != 0)) {
+        try {
+            ProbeForRead(Buffers, Count * sizeof(IO_RING_BUFFER_REGISTRATION), sizeof(ULONG_PTR));
+        } except(ExSystemExceptionFilter())
+        {
+            return GetExceptionCode();
+        }
+    }
+
+    Status = ObReferenceObjectByHandle(IoRingHandle, IO_RING_REGISTER, IoRingObjectType, PreviousMode, (PVOID *)&IoRing, NULL);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    if (IoRing->Process != PsGetCurrentProcess()) {
+        ObDereferenceObject(IoRing);
+        return STATUS_ACCESS_DENIED;
+    }
+
+    // The buffer set is released from completion routines, so it is allocated from nonpaged pool.
+    NewBuffers = NULL;
+    if (Count != 0) {
+        NewBuffers = ExAllocatePoolWithQuotaTag(NonPagedPool | POOL_QUOTA_FAIL_INSTEAD_OF_RAISE,
+                                                FIELD_OFFSET(IOP_IO_RING_BUFFERS, Buffer) + (Count * sizeof(IOP_IO_RING_BUFFER)),
+                                                'bRoI');
+        if (NewBuffers == NULL) {
+            ObDereferenceObject(IoRing);
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+
+        NewBuffers->ReferenceCount = 1;
+        NewBuffers->Count = 0;
+        for (Index = 0; Index < Count; Index += 1) {
+            Mdl = NULL;
+            try {
+                Capture = Buffers[Index];
+                if (Capture.Length == 0) {
+                    ExRaiseStatus(STATUS_INVALID_PARAMETER);
+                }
+
+                if (PreviousMode != KernelMode) {
+                    ProbeForWrite(Capture.Address, Capture.Length, sizeof(UCHAR));
+                }
+
+                Mdl = IoAllocateMdl(Capture.Address, Capture.Length, FALSE, TRUE, NULL);
+                if (Mdl == NULL) {
+                    ExRaiseStatus(STATUS_INSUFFICIENT_RESOURCES);
+                }
+
+                MmProbeAndLockPages(Mdl, PreviousMode, IoModifyAccess);
+            } except(EXCEPTION_EXECUTE_HANDLER)
+            {
+                if (Mdl != NULL) {
+                    IoFreeMdl(Mdl);
+                }
+
+                Status = GetExceptionCode();
+                break;
+            }
+
+            NewBuffers->Buffer[Index].Mdl = Mdl;
+            NewBuffers->Buffer[Index].Length = Capture.Length;
+            NewBuffers->Buffer[Index].SystemAddress = MmGetSystemAddressForMdlSafe(Mdl, NormalPagePriority);
+            NewBuffers->Count += 1;
+            if (NewBuffers->Buffer[Index].SystemAddress == NULL) {
+                Status = STATUS_INSUFFICIENT_RESOURCES;
+                break;
+            }
+        }
+
+        if (!NT_SUCCESS(Status)) {
+            IopDereferenceIoRingBuffers(NewBuffers);
+            ObDereferenceObject(IoRing);
+            return Status;
+        }
+    }
+
+    KeEnterCriticalRegion();
+    ExAcquirePushLockExclusive(&IoRing->SubmitLock);
+    if (IoRing->RunDown) {// A ring whose last handle is closed keeps no registrations, so unlock the new set instead.
+        OldBuffers = NewBuffers;
+        Status = STATUS_INVALID_HANDLE;
+    } else {
+        OldBuffers = IoRing->Buffers;
+        IoRing->Buffers = NewBuffers;
+        Status = STATUS_SUCCESS;
+    }
+    ExReleasePushLockExclusive(&IoRing->SubmitLock);
+    KeLeaveCriticalRegion();
+
+    if (OldBuffers != NULL) {
+        IopDereferenceIoRingBuffers(OldBuffers);
+    }
+
+    ObDereferenceObject(IoRing);
+    return Status;
+}
+
+
+VOID IopReleaseIoRingFiles(IN PIOP_IO_RING_FILE Files, IN ULONG Count)
+/*
+Routine Description:
+    This routine releases the file object references of a registered file set and frees the set.
+Arguments:
+    Files - Supplies a pointer to the registered file set.
+    Count - Supplies the number of referenced file objects in the set.
+*/
+{
+    ULONG Index;
+
+    PAGED_CODE();
+
+    for (Index = 0; Index < Count; Index += 1) {
+        ObDereferenceObject(Files[Index].FileObject);
+    }
+
+    ExFreePool(Files);
+}
+
+
+VOID IopDereferenceIoRingBuffers(IN PIOP_IO_RING_BUFFERS Buffers)
+/*
+Routine Description:
+    This routine drops a reference to a registered buffer set.
+    When the last reference is dropped, every buffer is unlocked and unmapped and the set is freed.
+    It may be called at DISPATCH_LEVEL from IopCompleteIoRingRequest.
+Arguments:
+    Buffers - Supplies a pointer to the registered buffer set.
+*/
+{
+    ULONG Index;
+
+    if (InterlockedDecrement(&Buffers->ReferenceCount) != 0) {
+        return;
+    }
+
+    for (Index = 0; Index < Buffers->Count; Index += 1) {
+        MmUnlockPages(Buffers->Buffer[Index].Mdl);
+        IoFreeMdl(Buffers->Buffer[Index].Mdl);
+    }
+
+    ExFreePool(Buffers);
+}
+
+
+NTSTATUS IopOpenIoRing(IN OB_OPEN_REASON OpenReason,
+                       IN PEPROCESS Process OPTIONAL,
+                       IN PVOID Object,
+                       IN ACCESS_MASK GrantedAccess,
+                       IN ULONG HandleCount
+)
+/*
+Routine Description:
+    This function is the open routine for I/O ring objects.
+    Handles are confined to the creating process and cannot be duplicated or inherited,
+    so the close of the last handle always happens in that process, no later than the rundown of its handle table.
+Arguments:
+    OpenReason - Supplies the reason the handle is being created.
+    Process - Supplies a pointer to the process that receives the handle.
+    Object - Supplies a pointer to an executive I/O ring object.
+    GrantedAccess - Unused.
+    HandleCount - Unused.
+Return Value:
+    STATUS_SUCCESS is returned if the handle may be created. Otherwise, STATUS_ACCESS_DENIED is returned.
+*/
+{
+    PIOP_IO_RING IoRing = (PIOP_IO_RING)Object;
+
+    UNREFERENCED_PARAMETER(GrantedAccess);
+    UNREFERENCED_PARAMETER(HandleCount);
+
+    PAGED_CODE();
+
+    if ((OpenReason == ObDuplicateHandle) || (OpenReason == ObInheritHandle) || (Process != IoRing->Process) || IoRing->RunDown) {
+        return STATUS_ACCESS_DENIED;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+VOID IopCloseIoRing(IN PEPROCESS Process OPTIONAL,
+                    IN PVOID Object,
+                    IN ACCESS_MASK GrantedAccess,
+                    IN ULONG_PTR ProcessHandleCount,
+                    IN ULONG_PTR SystemHandleCount
+)
+/*
+Routine Description:
+    This function is the close routine for I/O ring objects.
+    When the last handle is closed the ring is run down, releasing the locked buffers while the owning process still exists.
+Arguments:
+    Process - Unused.
+    Object - Supplies a pointer to an executive I/O ring object.
+    GrantedAccess - Unused.
+    ProcessHandleCount - Unused.
+    SystemHandleCount - Supplies the number of handles to the object in the system, including the one being closed.
+*/
+{
+    UNREFERENCED_PARAMETER(Process);
+    UNREFERENCED_PARAMETER(GrantedAccess);
+    UNREFERENCED_PARAMETER(ProcessHandleCount);
+
+    PAGED_CODE();
+
+    if (SystemHandleCount == 1) {
+        IopRundownIoRing((PIOP_IO_RING)Object);
+    }
+}
+
+
+VOID IopDeleteIoRing(IN PVOID Object)
+/*
+Routine Description:
+    This function is the delete routine for I/O ring objects.
+    It releases the registered files and buffers, if the ring was never run down, and the references the ring holds on its I/O completion object and its process.
+Arguments:
+    Object - Supplies a pointer to an executive I/O ring object.
+*/
+{
+    PIOP_IO_RING IoRing = (PIOP_IO_RING)Object;
+
+    PAGED_CODE();
+
+    if (IoRing->Files != NULL) {
+        IopReleaseIoRingFiles(IoRing->Files, IoRing->FileCount);
+    }
+
+    if (IoRing->Buffers != NULL) {
+        IopDereferenceIoRingBuffers(IoRing->Buffers);
+    }
+
+    if (IoRing->IoCompletion != NULL) {
+        ObDereferenceObject(IoRing->IoCompletion);
+    }
+
+    if (IoRing->Process != NULL) {
+        ObDereferenceObject(IoRing->Process);
+    }
+}
@@ -49,6 +49,8 @@ NTSTATUS IopDeleteSessionSymLinks(IN PUNICODE_STRING LinkName);
 #pragma alloc_text(PAGE, IoCheckFunctionAccess)
 #pragma alloc_text(PAGE, IoCheckQuotaBufferValidity)
 #pragma alloc_text(PAGE, IoCheckShareAccess)
+#pragma alloc_text(PAGE, IoCheckShareAccessState)
+#pragma alloc_text(PAGE, IopShareStateDelta)
 #pragma alloc_text(PAGE, IoConnectInterrupt)
 #pragma alloc_text(PAGE, IoCreateController)
 #pragma alloc_text(PAGE, IoCreateDevice)
@@ -87,6 +89,7 @@ NTSTATUS IopDeleteSessionSymLinks(IN PUNICODE_STRING LinkName);
 #pragma alloc_text(PAGE, IoRegisterLastChanceShutdownNotification)
 #pragma alloc_text(PAGE, IoRegisterShutdownNotification)
 #pragma alloc_text(PAGE, IoRemoveShareAccess)
+#pragma alloc_text(PAGE, IoRemoveShareAccessState)
 #pragma alloc_text(PAGE, IoSetInformation)
 #pragma alloc_text(PAGE, IoSetShareAccess)
 #pragma alloc_text(PAGE, IoSetSystemPartition)
@@ -360,6 +363,11 @@ PVOID IopAllocateErrorLogEntry(IN PDEVICE_OBJECT deviceObject, IN PDRIVER_OBJECT
     EntrySize = (UCHAR)((EntrySize + sizeof(PVOID) - 1) & ~(sizeof(PVOID) - 1));// Round entry size to a PVOID size boundary.
     size = sizeof(ERROR_LOG_ENTRY) + EntrySize;// Calculate the size of the entry needed.
 
+    // Refuse the entry without allocating it if this processor is writing entries faster than the error log can absorb them.
+    if (!IopErrorLogAdmitEntry()) {
+        return(NULL);
+    }
+
     // Make sure that there are not too many outstanding packets.
     oldSize = InterlockedExchangeAdd(&IopErrorLogAllocation, size);
     if (oldSize > IOP_MAXIMUM_LOG_ALLOCATION) {
@@ -429,6 +437,95 @@ PIRP IoAllocateIrp(IN CCHAR StackSize, IN BOOLEAN ChargeQuota)
 }
 
 
+PIRP IopAllocateCachedIrp(IN CCHAR StackSize)
+/*
+Routine Description:
+    This routine takes an IRP with exactly StackSize stack locations from the current processor's IRP cache.
+    If the processor's own list is empty, the packets other processors have freed back to it are reclaimed in one batch.
+Arguments:
+    StackSize - Specifies the number of stack locations required. This must not exceed IOP_IRP_CACHE_CLASSES.
+Return Value:
+    The function value is the address of the uninitialized IRP, or NULL if the cache holds no packet of that size.
+*/
+{
+    PIOP_IRP_CACHE cache;
+    PSLIST_ENTRY entry;
+    PSLIST_ENTRY next;
+    PSLIST_ENTRY reclaimed;
+    ULONG index;
+
+    ASSERT((StackSize > 0) && (StackSize <= IOP_IRP_CACHE_CLASSES));
+
+    index = StackSize - 1;
+    cache = &IopIrpCache[KeGetCurrentProcessorNumber()];
+    cache->Local.TotalAllocates += 1;
+    entry = InterlockedPopEntrySList(&cache->Local.ListHead[index]);
+    if (entry == NULL) {
+        cache->Local.AllocateMisses += 1;
+
+        // The first reclaimed packet satisfies this request and the rest refill the local list.
+        // The remote list is bounded by the cache depth, so the local list cannot overflow.
+        entry = InterlockedFlushSList(&cache->Remote.ListHead[index]);
+        if (entry != NULL) {
+            next = entry->Next;
+            while (next != NULL) {
+                reclaimed = next;
+                next = next->Next;
+                InterlockedPushEntrySList(&cache->Local.ListHead[index], reclaimed);
+            }
+        }
+    }
+
+    return (PIRP)entry;
+}
+
+
+VOID IopFreeCachedIrp(IN PIRP Irp)
+/*
+Routine Description:
+    This routine returns an IRP allocated with IRP_ALLOCATED_FROM_CACHE to the cache of the processor that owns it.
+    If that cache is full the packet is freed to pool instead.
+Arguments:
+    Irp - I/O Request Packet to deallocate.
+*/
+{
+    PIOP_IRP_CACHE cache;
+    PSLIST_HEADER listHead;
+    ULONG index;
+    ULONG owner;
+
+    owner = IopIrpCacheOwner(Irp, Irp->StackCount);
+    index = Irp->StackCount - 1;
+    ASSERT((owner < (ULONG)KeNumberProcessors) && (index < IOP_IRP_CACHE_CLASSES));
+
+    cache = &IopIrpCache[owner];
+    if (owner == KeGetCurrentProcessorNumber()) {
+        cache->Local.TotalFrees += 1;
+        listHead = &cache->Local.ListHead[index];
+        if (ExQueryDepthSList(listHead) >= IOP_IRP_CACHE_DEPTH) {
+            cache->Local.FreeMisses += 1;
+            ExFreePool(Irp);
+            return;
+        }
+    } else {
+        cache->Remote.RemoteFrees += 1;
+        listHead = &cache->Remote.ListHead[index];
+        if (ExQueryDepthSList(listHead) >= IOP_IRP_CACHE_DEPTH) {
+            cache->Remote.RemoteFreeMisses += 1;
+            ExFreePool(Irp);
+            return;
+        }
+    }
+
+    if (Irp->AllocationFlags & IRP_QUOTA_CHARGED) {
+        Irp->AllocationFlags ^= IRP_QUOTA_CHARGED;
+        ExReturnPoolQuota(Irp);
+    }
+
+    InterlockedPushEntrySList(listHead, (PSLIST_ENTRY)Irp);
+}
+
+
 PIRP IopAllocateIrpPrivate(IN CCHAR StackSize, IN BOOLEAN ChargeQuota)
 /*
 Routine Description:
@@ -461,7 +558,7 @@ Return Value:
     irp = NULL;
 
     fixedSize = 0;
-    packetSize = IoSizeOfIrp(StackSize);
+    packetSize = IopSizeOfIrpPacket(StackSize);
     allocateSize = packetSize;
     prcb = KeGetCurrentPrcb();
 
@@ -471,7 +568,7 @@ Return Value:
         fixedSize = IRP_ALLOCATED_FIXED_SIZE;
         number = LookasideSmallIrpList;
         if (StackSize != 1) {
-            allocateSize = IoSizeOfIrp((CCHAR)largeIrpStackLocations);
+            allocateSize = IopSizeOfIrpPacket((CCHAR)largeIrpStackLocations);
             number = LookasideLargeIrpList;
         }
 
@@ -501,6 +598,12 @@ Return Value:
                 allocateSize = (USHORT)irp->IoStatus.Information;
             }
         }
+    } else if ((IopIrpCache != NULL) && (StackSize <= IOP_IRP_CACHE_CLASSES) && ((ChargeQuota == FALSE) || (prcb->LookasideIrpFloat > 0))) {
+        // Deeper packets are cached per processor by exact stack count.
+        // They carry the number of their owning processor after the last stack location.
+        fixedSize = IRP_ALLOCATED_FROM_CACHE;
+        allocateSize = (USHORT)(packetSize + sizeof(ULONG));
+        irp = IopAllocateCachedIrp(StackSize);
     }
 
     // If an IRP was not allocated from the lookaside list,
@@ -522,6 +625,10 @@ Return Value:
         if (!irp) {
             return NULL;
         }
+
+        if (fixedSize == IRP_ALLOCATED_FROM_CACHE) {
+            IopIrpCacheOwner(irp, StackSize) = KeGetCurrentProcessorNumber();
+        }
     } else {
         if (ChargeQuota != FALSE) {
             lookasideAllocation = IRP_LOOKASIDE_ALLOCATION;
@@ -532,9 +639,11 @@ Return Value:
     }
 
     // Initialize the packet.
-    // Note that irp->Size may not be equal to IoSizeOfIrp(StackSize)
-    IopInitializeIrp(irp, allocateSize, StackSize);
-    irp->AllocationFlags = (fixedSize | lookasideAllocation);
+    // Note that irp->Size may not be equal to IoSizeOfIrp(StackSize).
+    // Only the stack locations in use are zeroed, so reusing a large cached packet for a shallow request stays cheap.
+    IopInitializeCachedIrp(irp, allocateSize, StackSize);
+    IopIrpStartTime(irp) = 0;
+    irp->AllocationFlags = (fixedSize | lookasideAllocation | IRP_ALLOCATED_START_TIME);
     if (ChargeQuota) {
         irp->AllocationFlags |= IRP_QUOTA_CHARGED;
     }
@@ -1984,6 +2093,132 @@ Note:
 }
 
 
+LONG64 IopShareStateDelta(IN PFILE_OBJECT FileObject)
+/*
+Routine Description:
+    This routine computes what an open adds to a packed share access state, from the accesses recorded in its file object.
+Arguments:
+    FileObject - Pointer to the file object of the open.
+Return Value:
+    The amount to add to the state when the open is admitted, and to subtract when it is closed.
+*/
+{
+    LONG64 delta = 0;
+
+    PAGED_CODE();
+
+    if (FileObject->ReadAccess) {
+        delta += IopShareStateUnit(IOP_SHARE_STATE_READERS);
+    }
+
+    if (FileObject->WriteAccess) {
+        delta += IopShareStateUnit(IOP_SHARE_STATE_WRITERS);
+    }
+
+    if (FileObject->DeleteAccess) {
+        delta += IopShareStateUnit(IOP_SHARE_STATE_DELETERS);
+    }
+
+    if (!FileObject->SharedRead) {
+        delta += IopShareStateUnit(IOP_SHARE_STATE_DENY_READ);
+    }
+
+    if (!FileObject->SharedWrite) {
+        delta += IopShareStateUnit(IOP_SHARE_STATE_DENY_WRITE);
+    }
+
+    if (!FileObject->SharedDelete) {
+        delta += IopShareStateUnit(IOP_SHARE_STATE_DENY_DELETE);
+    }
+
+    return delta;
+}
+
+
+NTSTATUS IoCheckShareAccessState(IN ACCESS_MASK DesiredAccess,
+                                 IN ULONG DesiredShareAccess,
+                                 IN OUT PFILE_OBJECT FileObject,
+                                 IN OUT PSHARE_ACCESS_STATE ShareState,
+                                 IN BOOLEAN Update
+)
+/*
+Routine Description:
+    This routine is the equivalent of IoCheckShareAccess for a packed share access state.
+    The check, and the update if one is requested, are made as a single interlocked operation,
+    so unlike IoCheckShareAccess the caller need not lock the state against other opens and closes of the file.
+Arguments:
+    DesiredAccess - Desired access of current open request.
+    DesiredShareAccess - Shared access requested by current open request.
+    FileObject - Pointer to the file object of the current open request.
+    ShareState - Pointer to the packed share access state of the file.
+    Update - Specifies whether or not the share access state of the file is to be updated.
+Return Value:
+    STATUS_SUCCESS if the accessor has access to the file, STATUS_SHARING_VIOLATION if it does not,
+    or STATUS_TOO_MANY_OPENED_FILES if the file already has as many opens of one kind as the state can count.
+*/
+{
+    LONG64 state;
+    LONG64 previousState;
+    LONG64 delta;
+    ULONG field;
+
+    PAGED_CODE();
+
+    FileObject->ReadAccess = (BOOLEAN)((DesiredAccess & (FILE_EXECUTE | FILE_READ_DATA)) != 0);
+    FileObject->WriteAccess = (BOOLEAN)((DesiredAccess & (FILE_WRITE_DATA | FILE_APPEND_DATA)) != 0);
+    FileObject->DeleteAccess = (BOOLEAN)((DesiredAccess & DELETE) != 0);
+
+    // As in IoCheckShareAccess, opens that only read or write attributes are not accounted for.
+    if (!(FileObject->ReadAccess || FileObject->WriteAccess || FileObject->DeleteAccess)) {
+        return STATUS_SUCCESS;
+    }
+
+    FileObject->SharedRead = (BOOLEAN)((DesiredShareAccess & FILE_SHARE_READ) != 0);
+    FileObject->SharedWrite = (BOOLEAN)((DesiredShareAccess & FILE_SHARE_WRITE) != 0);
+    FileObject->SharedDelete = (BOOLEAN)((DesiredShareAccess & FILE_SHARE_DELETE) != 0);
+
+    if (FileObject->Flags & FO_FILE_OBJECT_HAS_EXTENSION) {
+        PIOP_FILE_OBJECT_EXTENSION  fileObjectExtension = (PIOP_FILE_OBJECT_EXTENSION)(FileObject + 1);
+
+        if (fileObjectExtension->FileObjectExtensionFlags & FO_EXTENSION_IGNORE_SHARE_ACCESS_CHECK) {
+            return STATUS_SUCCESS;
+        }
+    }
+
+    delta = IopShareStateDelta(FileObject);
+
+    // Read the state with an interlocked operation so that it cannot be torn on platforms without atomic 64 bit loads.
+    state = InterlockedCompareExchange64(&ShareState->State, 0, 0);
+    for (;;) {
+        if ((FileObject->ReadAccess && IopShareStateCount(state, IOP_SHARE_STATE_DENY_READ)) ||
+            (FileObject->WriteAccess && IopShareStateCount(state, IOP_SHARE_STATE_DENY_WRITE)) ||
+            (FileObject->DeleteAccess && IopShareStateCount(state, IOP_SHARE_STATE_DENY_DELETE)) ||
+            (IopShareStateCount(state, IOP_SHARE_STATE_READERS) && !FileObject->SharedRead) ||
+            (IopShareStateCount(state, IOP_SHARE_STATE_WRITERS) && !FileObject->SharedWrite) ||
+            (IopShareStateCount(state, IOP_SHARE_STATE_DELETERS) && !FileObject->SharedDelete)) {
+            return STATUS_SHARING_VIOLATION;
+        }
+
+        if (!Update) {
+            return STATUS_SUCCESS;
+        }
+
+        for (field = 0; field < IOP_SHARE_STATE_FIELDS; field++) {
+            if (IopShareStateCount(delta, field) && IopShareStateCount(state, field) == IOP_SHARE_STATE_FIELD_MASK) {
+                return STATUS_TOO_MANY_OPENED_FILES;
+            }
+        }
+
+        previousState = InterlockedCompareExchange64(&ShareState->State, state + delta, state);
+        if (previousState == state) {
+            return STATUS_SUCCESS;
+        }
+
+        state = previousState;// Another open or close changed the state, so check against the new state.
+    }
+}
+
+
 VOID FASTCALL IofCompleteRequest(IN PIRP Irp, IN CCHAR PriorityBoost)
 {
     // This routine will either jump immediately to IopfCompleteRequest, or rather IovCompleteRequest.
@@ -2013,7 +2248,9 @@ Routine Description:
         5.  A check is made to determine whether or not completion of the request can be deferred until later.
             If it can be, then this routine simply exits and leaves it up to the originator of the request to fully complete the IRP.
             By not initializing and queueing the special kernel APC to the calling thread (which is the current thread by definition), a lot of interrupt and queueing processing can be avoided.
-        6.  The final rundown routine is invoked to queue the request packet to the target (requesting) thread as a special kernel mode APC.
+        6.  If the request is being completed in the requesting thread at passive level, where the special kernel APC would be delivered as soon as it was queued,
+            then the final rundown routine is simply called here.
+        7.  Otherwise, the final rundown routine is invoked to queue the request packet to the target (requesting) thread as a special kernel mode APC.
 Arguments:
     Irp - Pointer to the I/O Request Packet to complete.
     PriorityBoost - Supplies the amount of priority boost that is to be given to the target thread when the special kernel APC is queued.
@@ -2038,6 +2275,8 @@ Arguments:
     KIRQL irql;
     PVOID saveAuxiliaryPointer = NULL;
     NTSTATUS    errorStatus;
+    PKNORMAL_ROUTINE normalRoutine;
+    PVOID normalContext;
 
     // Begin by ensuring that this packet has not already been completed by someone.
     if (Irp->CurrentLocation > (CCHAR)(Irp->StackCount + 1) || Irp->Type != IO_TYPE_IRP) {
@@ -2055,6 +2294,11 @@ Arguments:
     // This is apparently a common problem in some drivers, and has no meaning as a status code.
     ASSERT(Irp->IoStatus.Status != 0xffffffff);
 
+    // If the packet was timed when it was dispatched to the top of its stack, account for it in that device's latency histogram.
+    if (IopIrpHasStartTime(Irp) && IopIrpStartTime(Irp)) {
+        IopRecordIrpLatency(Irp);
+    }
+
     // Diagnosability support.
     bottomSp = ((PIO_STACK_LOCATION)((UCHAR*)(Irp)+sizeof(IRP)));
     if (bottomSp->Control & SL_ERROR_RETURNED) {
@@ -2250,6 +2494,17 @@ Arguments:
     thread = Irp->Tail.Overlay.Thread;
     fileObject = Irp->Tail.Overlay.OriginalFileObject;
     if (!Irp->Cancel) {
+        // If the packet is being completed by the requesting thread itself, in the APC environment it was issued from, at passive level and with special kernel APCs enabled,
+        // then the APC would be delivered immediately upon being queued anyway.
+        // This happens, for example, when a lower driver pends the request but completes it before returning to the I/O system.
+        // Call the rundown routine directly and save the APC initialization, queueing and interrupt.
+        if (thread == PsGetCurrentThread() && Irp->ApcEnvironment == KeGetCurrentApcEnvironment() && !KeAreAllApcsDisabled()) {
+            KeRaiseIrql(APC_LEVEL, &irql);
+            IopCompleteRequest(&Irp->Tail.Apc, &normalRoutine, &normalContext, (PVOID*)& fileObject, &saveAuxiliaryPointer);
+            KeLowerIrql(irql);
+            return;
+        }
+
         KeInitializeApc(&Irp->Tail.Apc,
                         &thread->Tcb,
                         Irp->ApcEnvironment,
@@ -4162,10 +4417,12 @@ Arguments:
         InterlockedIncrement(&prcb->LookasideIrpFloat);
     }
 
-    if (!(Irp->AllocationFlags & IRP_ALLOCATED_FIXED_SIZE) || (Irp->AllocationFlags & IRP_ALLOCATED_MUST_SUCCEED)) {
+    if (Irp->AllocationFlags & IRP_ALLOCATED_FROM_CACHE) {
+        IopFreeCachedIrp(Irp);
+    } else if (!(Irp->AllocationFlags & IRP_ALLOCATED_FIXED_SIZE) || (Irp->AllocationFlags & IRP_ALLOCATED_MUST_SUCCEED)) {
         ExFreePool(Irp);
     } else {
-        if (IopIrpAutoSizingEnabled() && (Irp->Size != IoSizeOfIrp(IopLargeIrpStackLocations)) && (Irp->Size != IoSizeOfIrp(1))) {
+        if (IopIrpAutoSizingEnabled() && (Irp->Size != IopSizeOfIrpPacket(IopLargeIrpStackLocations)) && (Irp->Size != IopSizeOfIrpPacket(1))) {
             ExFreePool(Irp);
             return;
         }
@@ -4718,6 +4975,10 @@ Arguments:
     AllocationFlags = Irp->AllocationFlags;
     StackSize = Irp->StackCount;
     PacketSize = IoSizeOfIrp(StackSize);
+    if (IopIrpHasStartTime(Irp)) {// Keep the room for the dispatch time if the packet has it.
+        PacketSize = IopSizeOfIrpPacket(StackSize);
+    }
+
     IopInitializeIrp(Irp, PacketSize, StackSize);
     Irp->AllocationFlags = AllocationFlags;
     Irp->IoStatus.Status = Status;
@@ -5175,7 +5436,7 @@ Return Value:
     // then attempt to allocate the packet from the lookaside lists.
     associatedIrp = NULL;
     fixedSize = 0;
-    packetSize = IoSizeOfIrp(StackSize);
+    packetSize = IopSizeOfIrpPacket(StackSize);
     allocateSize = packetSize;
     largeIrpStackLocations = (CCHAR)IopLargeIrpStackLocations;
 
@@ -5183,7 +5444,7 @@ Return Value:
         fixedSize = IRP_ALLOCATED_FIXED_SIZE;
         number = LookasideSmallIrpList;
         if (StackSize != 1) {
-            allocateSize = IoSizeOfIrp(largeIrpStackLocations);
+            allocateSize = IopSizeOfIrpPacket(largeIrpStackLocations);
             number = LookasideLargeIrpList;
         }
 
@@ -5230,7 +5491,7 @@ Return Value:
     IopInitializeIrp(associatedIrp, allocateSize, StackSize);
     associatedIrp->Flags |= IRP_ASSOCIATED_IRP;
     associatedIrp->Flags |= (Irp->Flags & IRP_HIGH_PRIORITY_PAGING_IO);
-    associatedIrp->AllocationFlags |= (fixedSize);
+    associatedIrp->AllocationFlags |= (fixedSize | IRP_ALLOCATED_START_TIME);
     associatedIrp->Tail.Overlay.Thread = Irp->Tail.Overlay.Thread;// Set the thread ID to be that of the master.
     associatedIrp->AssociatedIrp.MasterIrp = Irp;// Now make the association between this packet and the master.
     return associatedIrp;
@@ -5414,8 +5675,9 @@ Arguments:
     PETHREAD           Thread;
 
     // If pop-ups are disabled for the requesting thread, just complete the request.
+    // A thread agnostic request, such as one issued by an I/O ring, has no thread to raise the pop-up in.
     Thread = Irp->Tail.Overlay.Thread;
-    if ((Thread->CrossThreadFlags & PS_CROSS_THREAD_FLAGS_HARD_ERRORS_DISABLED) != 0) {
+    if ((Thread == NULL) || (Thread->CrossThreadFlags & PS_CROSS_THREAD_FLAGS_HARD_ERRORS_DISABLED) != 0) {
         // An error was incurred, so zero out the information field before completing the request if this was an input operation.
         // Otherwise, IopCompleteRequest will try to copy to the user's buffer.
         if (Irp->Flags & IRP_INPUT_OPERATION) {
@@ -6026,6 +6288,45 @@ Arguments:
 }
 
 
+VOID IoRemoveShareAccessState(IN PFILE_OBJECT FileObject, IN OUT PSHARE_ACCESS_STATE ShareState)
+/*
+Routine Description:
+    This routine is the equivalent of IoRemoveShareAccess for a packed share access state.
+    The caller need not lock the state.
+Arguments:
+    FileObject - Pointer to the file object of the current access being closed.
+    ShareState - Pointer to the packed share access state of the file.
+*/
+{
+    LONG64 state;
+    LONG64 previousState;
+    LONG64 delta;
+
+    PAGED_CODE();
+
+    if (FileObject->Flags & FO_FILE_OBJECT_HAS_EXTENSION) {
+        PIOP_FILE_OBJECT_EXTENSION  fileObjectExtension = (PIOP_FILE_OBJECT_EXTENSION)(FileObject + 1);
+        if (fileObjectExtension->FileObjectExtensionFlags & FO_EXTENSION_IGNORE_SHARE_ACCESS_CHECK) {
+            return;
+        }
+    }
+
+    if (FileObject->ReadAccess || FileObject->WriteAccess || FileObject->DeleteAccess) {
+        delta = IopShareStateDelta(FileObject);
+        state = InterlockedCompareExchange64(&ShareState->State, 0, 0);
+        for (;;) {
+            ASSERT(state >= delta);
+            previousState = InterlockedCompareExchange64(&ShareState->State, state - delta, state);
+            if (previousState == state) {
+                break;
+            }
+
+            state = previousState;
+        }
+    }
+}
+
+
 VOID IoSetDeviceToVerify(IN PETHREAD Thread, IN PDEVICE_OBJECT DeviceObject)
 /*
 Routine Description:
@@ -6643,9 +6944,20 @@ Arguments:
     }
 
     // If a key parameter was specified, then insert the request into the work queue according to the key; 
-    // otherwise, simply insert it at the tail.
+    // otherwise, if the driver asked for priority queueing, insert it according to the deadline of its I/O priority,
+    // and otherwise simply insert it at the tail.
+    // Since the device queue is sorted by deadline and dequeued from the head, packets are started earliest deadline first,
+    // and in arrival order among packets with the same deadline.
+    // Deadlines are compared across the wrap of the tick count, so a packet queued just before the wrap is not overtaken by every later one.
     if (Key) {
         i = KeInsertByKeyDeviceQueue(&DeviceObject->DeviceQueue, &Irp->Tail.Overlay.DeviceQueueEntry, *Key);
+    } else if (DeviceObject->DeviceObjectExtension->StartIoFlags & DOE_STARTIO_PRIORITY) {
+        LARGE_INTEGER tickCount;
+
+        KeQueryTickCount(&tickCount);
+        i = KeInsertByDeadlineDeviceQueue(&DeviceObject->DeviceQueue,
+                                          &Irp->Tail.Overlay.DeviceQueueEntry,
+                                          tickCount.LowPart + IopIoPriorityDeadline[IoGetIoPriorityHint(Irp)]);
     } else {
         i = KeInsertDeviceQueue(&DeviceObject->DeviceQueue, &Irp->Tail.Overlay.DeviceQueueEntry);
     }
@@ -6789,6 +7101,52 @@ Arguments:
 }
 
 
+VOID IoSetFastIoPassThrough(IN PDEVICE_OBJECT FilterDeviceObject, IN BOOLEAN PassThrough)
+/*
+Routine Description:
+    This routine is invoked by a file system filter to declare that it does nothing with cached reads and writes
+    other than pass them to the device object it is attached to.
+    NtReadFile, NtWriteFile and the vectored transfers then call the fast I/O routine of the first driver below the filter that has not declared this,
+    instead of calling each filter's routine in turn.
+    The filter still sees every request that is sent as an IRP.
+    It should be called before the filter attaches, and must not be changed while requests can be in progress.
+Arguments:
+    FilterDeviceObject - Pointer to the filter's device object.
+    PassThrough - If TRUE cached reads and writes skip the filter; if FALSE they are passed to its fast I/O routines.
+*/
+{
+    KIRQL irql;
+
+    irql = KeAcquireQueuedSpinLock(LockQueueIoDatabaseLock);
+    if (PassThrough) {
+        FilterDeviceObject->DeviceObjectExtension->ExtensionFlags |= DOE_FAST_IO_PASS_THROUGH;
+    } else {
+        FilterDeviceObject->DeviceObjectExtension->ExtensionFlags &= ~DOE_FAST_IO_PASS_THROUGH;
+    }
+    KeReleaseQueuedSpinLock(LockQueueIoDatabaseLock, irql);
+}
+
+
+VOID IoSetStartIoPriorityQueueing(IN PDEVICE_OBJECT DeviceObject, IN BOOLEAN PriorityQueueing)
+/*
+Routine Description:
+    This routine selects how IoStartPacket queues packets that are not given a key while the device is busy.
+    By default they are queued in arrival order.
+    With priority queueing, each packet is given a deadline based on its I/O priority hint, and packets are started earliest deadline first.
+    The driver must not otherwise use the device queue keys, and should set this before the first packet is started.
+Arguments:
+    DeviceObject - Pointer to device object itself.
+    PriorityQueueing - If TRUE packets are started by I/O priority deadline; if FALSE in arrival order.
+*/
+{
+    if (PriorityQueueing) {
+        DeviceObject->DeviceObjectExtension->StartIoFlags |= DOE_STARTIO_PRIORITY;
+    } else {
+        DeviceObject->DeviceObjectExtension->StartIoFlags &= ~DOE_STARTIO_PRIORITY;
+    }
+}
+
+
 VOID IoStartTimer(IN PDEVICE_OBJECT DeviceObject)
 /*
 Routine Description:
@@ -7208,8 +7566,8 @@ Arguments:
     PERROR_LOG_ENTRY entry;
     KIRQL oldIrql;
 
-    // Get the address of the error log entry header, acquire the spin lock, insert the entry onto the queue,
-    // if there are no pending requests then queue a worker thread request and release the spin lock.
+    // Get the address of the error log entry header, insert the entry onto the queue of the current processor,
+    // and if there are no pending requests then queue a worker thread request.
     entry = ((PERROR_LOG_ENTRY)ElEntry) - 1;
     if (IopErrorLogDisabledThisBoot) {// Do nothing, drop the reference.
         if (entry->DeviceObject != NULL) {
@@ -7228,18 +7586,21 @@ Arguments:
 
     // Set the time that the entry was logged.
     KeQuerySystemTime((PVOID)& entry->TimeStamp);
-    ExAcquireSpinLock(&IopErrorLogLock, &oldIrql);
-
-    InsertTailList(&IopErrorLogListHead, &entry->ListEntry);// Queue the request to the error log queue.
+    if (IopErrorLogQueues != NULL) {
+        if (!IopErrorLogQueueEntry(entry)) {
+            return;// The entry duplicated a recent one and was dropped.
+        }
+    } else {
+        ExAcquireSpinLock(&IopErrorLogLock, &oldIrql);
+        InsertTailList(&IopErrorLogListHead, &entry->ListEntry);// Queue the request to the error log queue.
+        ExReleaseSpinLock(&IopErrorLogLock, oldIrql);
+    }
 
     // If there is no pending work, then queue a request to a worker thread.
-    if (!IopErrorLogPortPending) {
-        IopErrorLogPortPending = TRUE;
+    if (InterlockedCompareExchange(&IopErrorLogPortPending, TRUE, FALSE) == FALSE) {
         ExInitializeWorkItem(&IopErrorLogWorkItem, IopErrorLogThread, NULL);
         ExQueueWorkItem(&IopErrorLogWorkItem, DelayedWorkQueue);
     }
-
-    ExReleaseSpinLock(&IopErrorLogLock, oldIrql);
 }
 
 
@@ -8499,6 +8860,55 @@ Return Value:
 }
 
 
+IO_PRIORITY_HINT IoGetIoPriorityHint(IN PIRP Irp)
+/*
+Routine Description:
+    This routine returns the I/O priority hint of an IRP.
+    Packets that were not assigned a hint derive one from their type:
+    high priority paging I/O is critical, paging I/O that a thread is waiting on is high, and everything else is normal.
+Arguments:
+    Irp - Pointer to the IRP.
+Return Value:
+    Returns the I/O priority hint.
+*/
+{
+    if (Irp->Flags & IRP_PRIORITY_MASK) {
+        return (IO_PRIORITY_HINT)(((Irp->Flags & IRP_PRIORITY_MASK) >> IRP_PRIORITY_SHIFT) - 1);
+    }
+
+    if (Irp->Flags & IRP_HIGH_PRIORITY_PAGING_IO) {
+        return IoPriorityCritical;
+    }
+
+    if ((Irp->Flags & (IRP_PAGING_IO | IRP_SYNCHRONOUS_PAGING_IO)) == (IRP_PAGING_IO | IRP_SYNCHRONOUS_PAGING_IO)) {
+        return IoPriorityHigh;
+    }
+
+    return IoPriorityNormal;
+}
+
+
+NTSTATUS IoSetIoPriorityHint(IN PIRP Irp, IN IO_PRIORITY_HINT PriorityHint)
+/*
+Routine Description:
+    This routine assigns an I/O priority hint to an IRP.
+    It is called by the originator of the packet before it is sent, or by a driver before it queues the packet.
+Arguments:
+    Irp - Pointer to the IRP.
+    PriorityHint - Supplies the I/O priority hint.
+Return Value:
+    STATUS_SUCCESS, or STATUS_INVALID_PARAMETER if the hint is out of range.
+*/
+{
+    if ((ULONG)PriorityHint >= MaxIoPriorityTypes) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    Irp->Flags = (Irp->Flags & ~IRP_PRIORITY_MASK) | (((ULONG)PriorityHint + 1) << IRP_PRIORITY_SHIFT);
+    return STATUS_SUCCESS;
+}
+
+
 PDEVICE_OBJECT IoFindDeviceThatFailedIrp(IN  PIRP Irp)
 /*
 Routine Description:
@@ -0,0 +1,224 @@
+/*
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+You may only use this code if you agree to the terms of the Windows Research Kernel Source Code License agreement (see License.txt).
+If you do not agree to the terms, do not use the code.
+
+Module Name:
+    latency.c
+
+Abstract:
+    This module implements the request latency histograms of device objects.
+    When a driver opts a device object in, every packet that IoCallDriver passes to the device as the top of its stack is stamped with the processor cycle count,
+    and when a driver first completes the packet the elapsed cycles are counted, by major function, in a log2 bucket of the completing processor's copy of the histogram.
+    The histograms of a device or of all of a driver's devices can be queried at any time, and each sample is also logged as a trace event when driver tracing is on.
+*/
+
+#include "iomgr.h"
+
+VOID IopAddLatencyHistogram(IN PDEVICE_OBJECT DeviceObject, IN OUT PIO_LATENCY_HISTOGRAM Histogram);
+
+#pragma alloc_text(PAGE, IoEnableLatencyHistogram)
+#pragma alloc_text(PAGE, IoQueryDeviceLatencyHistogram)
+#pragma alloc_text(PAGE, IoQueryDriverLatencyHistogram)
+#pragma alloc_text(PAGE, IopAddLatencyHistogram)
+
+
+NTSTATUS IoEnableLatencyHistogram(IN PDEVICE_OBJECT DeviceObject)
+/*
+Routine Description:
+    This routine is invoked by a driver to start keeping the request latency histogram of one of its device objects.
+    Only requests that are passed to the device as the top of their stack are measured, so a filter attached above the device hides its requests.
+    Once enabled, the histogram is kept until the device object is deleted.
+Arguments:
+    DeviceObject - Supplies the device object.
+Return Value:
+    STATUS_SUCCESS, or STATUS_INSUFFICIENT_RESOURCES if the histogram could not be allocated.
+*/
+{
+    PIOP_LATENCY_HISTOGRAM histogram;
+    ULONG size;
+
+    PAGED_CODE();
+
+    if (DeviceObject->DeviceObjectExtension->LatencyHistogram) {
+        return STATUS_SUCCESS;
+    }
+
+    size = KeNumberProcessors * sizeof(IOP_LATENCY_HISTOGRAM);
+    histogram = ExAllocatePoolWithTag(NonPagedPoolCacheAligned, size, 'hLoI');
+    if (!histogram) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(histogram, size);
+
+    if (InterlockedCompareExchangePointer(&DeviceObject->DeviceObjectExtension->LatencyHistogram, histogram, NULL) != NULL) {
+        ExFreePool(histogram);
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+VOID FASTCALL IopRecordIrpLatency(IN PIRP Irp)
+/*
+Routine Description:
+    This routine is invoked by IoCompleteRequest for a packet that was stamped when it was dispatched to the top of its stack.
+    It counts the packet in the latency histogram of the device at the top of the stack and clears the stamp,
+    so that a packet that is completed again after a completion routine sent it back down is only counted once.
+Arguments:
+    Irp - Supplies the packet being completed.
+*/
+{
+    PERFINFO_REQUEST_LATENCY_INFORMATION latencyInformation;
+    PIOP_LATENCY_HISTOGRAM histogram;
+    PIO_STACK_LOCATION topSp;
+    ULONG64 cycles;
+    ULONG64 bucketCycles;
+    ULONG bucket;
+
+    cycles = PerfGetCycleCount() - IopIrpStartTime(Irp);
+    IopIrpStartTime(Irp) = 0;
+
+    // The cycle counters of the processors are not guaranteed to be synchronized,
+    // so a packet completed on a different processor than it was dispatched on may appear to have finished before it started.
+    if ((LONG64)cycles < 0) {
+        cycles = 0;
+    }
+
+    topSp = (PIO_STACK_LOCATION)((PUCHAR)Irp + sizeof(IRP)) + (Irp->StackCount - 1);
+    if (topSp->MajorFunction > IRP_MJ_MAXIMUM_FUNCTION || topSp->DeviceObject == NULL) {
+        return;
+    }
+
+    histogram = topSp->DeviceObject->DeviceObjectExtension->LatencyHistogram;
+    if (histogram == NULL) {
+        return;
+    }
+
+    bucket = 0;
+    for (bucketCycles = cycles >> IOP_LATENCY_HISTOGRAM_SHIFT; bucketCycles != 0 && bucket < IO_LATENCY_HISTOGRAM_BUCKETS - 1; bucketCycles >>= 1) {
+        bucket += 1;
+    }
+
+    // The count is interlocked because the thread may move to another processor after the processor number is read,
+    // but the cache line belongs to this processor in the common case so the update does not contend.
+    InterlockedIncrement((PLONG)&histogram[KeGetCurrentProcessorNumber()].Count[topSp->MajorFunction][bucket]);
+
+    if (PERFINFO_IS_GROUP_ON(PERF_DRIVERS)) {
+        latencyInformation.ElapsedCycles = cycles;
+        latencyInformation.DeviceObject = topSp->DeviceObject;
+        latencyInformation.Irp = Irp;
+        latencyInformation.Status = Irp->IoStatus.Status;
+        latencyInformation.MajorFunction = topSp->MajorFunction;
+        latencyInformation.MinorFunction = topSp->MinorFunction;
+        PerfInfoLogBytes(PERFINFO_LOG_TYPE_DRIVER_REQUEST_LATENCY, &latencyInformation, sizeof(latencyInformation));
+    }
+}
+
+
+VOID IopAddLatencyHistogram(IN PDEVICE_OBJECT DeviceObject, IN OUT PIO_LATENCY_HISTOGRAM Histogram)
+/*
+Routine Description:
+    This routine adds the per processor copies of the latency histogram of a device to a histogram.
+    The copies are read without synchronization, so a sample recorded during the sum may or may not be included.
+Arguments:
+    DeviceObject - Supplies the device object.
+    Histogram - Supplies the histogram to add the device's counts to.
+*/
+{
+    PIOP_LATENCY_HISTOGRAM histogram;
+    ULONG processor;
+    ULONG majorFunction;
+    ULONG bucket;
+
+    PAGED_CODE();
+
+    histogram = DeviceObject->DeviceObjectExtension->LatencyHistogram;
+    if (histogram == NULL) {
+        return;
+    }
+
+    for (processor = 0; processor < (ULONG)KeNumberProcessors; processor++) {
+        for (majorFunction = 0; majorFunction <= IRP_MJ_MAXIMUM_FUNCTION; majorFunction++) {
+            for (bucket = 0; bucket < IO_LATENCY_HISTOGRAM_BUCKETS; bucket++) {
+                Histogram->Count[majorFunction][bucket] += histogram[processor].Count[majorFunction][bucket];
+            }
+        }
+    }
+}
+
+
+VOID IoQueryDeviceLatencyHistogram(IN PDEVICE_OBJECT DeviceObject, OUT PIO_LATENCY_HISTOGRAM Histogram)
+/*
+Routine Description:
+    This routine returns the request latency histogram of a device object.
+    The histogram is empty if it was never enabled with IoEnableLatencyHistogram.
+Arguments:
+    DeviceObject - Supplies the device object.
+    Histogram - Receives the counts of the requests the device has completed, by major function and latency.
+*/
+{
+    PAGED_CODE();
+
+    RtlZeroMemory(Histogram, sizeof(IO_LATENCY_HISTOGRAM));
+    IopAddLatencyHistogram(DeviceObject, Histogram);
+}
+
+
+NTSTATUS IoQueryDriverLatencyHistogram(IN PDRIVER_OBJECT DriverObject, OUT PIO_LATENCY_HISTOGRAM Histogram)
+/*
+Routine Description:
+    This routine returns the sum of the request latency histograms of all the device objects of a driver.
+Arguments:
+    DriverObject - Supplies the driver object.
+    Histogram - Receives the counts of the requests the driver's devices have completed, by major function and latency.
+Return Value:
+    STATUS_SUCCESS, or STATUS_INSUFFICIENT_RESOURCES if the device objects could not be enumerated.
+*/
+{
+    PDEVICE_OBJECT* deviceList = NULL;
+    ULONG deviceCount = 0;
+    ULONG numberOfDevices;
+    ULONG i;
+    NTSTATUS status;
+
+    PAGED_CODE();
+
+    RtlZeroMemory(Histogram, sizeof(IO_LATENCY_HISTOGRAM));
+
+    // Devices can be created while the list is allocated, so retry until it is large enough.
+    for (;;) {
+        status = IoEnumerateDeviceObjectList(DriverObject, deviceList, deviceCount * sizeof(PDEVICE_OBJECT), &numberOfDevices);
+        if (status != STATUS_BUFFER_TOO_SMALL) {
+            break;
+        }
+
+        // The devices that did fit were referenced.
+        for (i = 0; i < deviceCount; i++) {
+            ObDereferenceObject(deviceList[i]);
+        }
+
+        if (deviceList) {
+            ExFreePool(deviceList);
+        }
+
+        deviceCount = numberOfDevices;
+        deviceList = ExAllocatePoolWithTag(PagedPool, deviceCount * sizeof(PDEVICE_OBJECT), 'hLoI');
+        if (!deviceList) {
+            return STATUS_INSUFFICIENT_RESOURCES;
+        }
+    }
+
+    for (i = 0; i < numberOfDevices; i++) {
+        IopAddLatencyHistogram(deviceList[i], Histogram);
+        ObDereferenceObject(deviceList[i]);
+    }
+
+    if (deviceList) {
+        ExFreePool(deviceList);
+    }
+
+    return STATUS_SUCCESS;
+}
@@ -467,6 +467,16 @@ Arguments:
 
     IopDestroyDeviceNode(deviceObject->DeviceObjectExtension->DeviceNode);
 
+    // Free the negative create cache, if the file system enabled one for this volume.
+    if (deviceObject->DeviceObjectExtension->CreateCache) {
+        ExFreePool(deviceObject->DeviceObjectExtension->CreateCache);
+    }
+
+    // Free the latency histograms, if the driver enabled them for this device.
+    if (deviceObject->DeviceObjectExtension->LatencyHistogram) {
+        ExFreePool(deviceObject->DeviceObjectExtension->LatencyHistogram);
+    }
+
     // If there's still a VPB attached then free it.
     vpb = InterlockedExchangePointer(&(deviceObject->Vpb), vpb);
     if (vpb != NULL) {
@@ -255,6 +255,8 @@ NTSTATUS IopParseDevice(IN PVOID ParseObject,
     BOOLEAN  relativeVolumeOpen = FALSE;     // True if opening a filesystem volume
     PETHREAD CurrentThread;
     ULONG returnedLength;
+    PIOP_CREATE_CACHE createCache = NULL;
+    LONG createCacheGeneration = 0;
 
     PAGED_CODE();
 
@@ -264,6 +266,7 @@ NTSTATUS IopParseDevice(IN PVOID ParseObject,
 
 reparse_loop:
     *Object = (PVOID)NULL;// Assume failure by setting the returned object pointer to NULL.
+    createCache = NULL;
     op = Context;// Get the address of the Open Packet (OP).
 
     // Ensure that this routine is actually being invoked because someone is attempting to open a device or a file through NtCreateFile.
@@ -361,16 +364,15 @@ reparse_loop:
             ExAcquireResourceSharedLite(&IopSecurityResource, TRUE);
             SeLockSubjectContext(&AccessState->SubjectSecurityContext);
             subjectContextLocked = TRUE;
-            accessGranted = SeAccessCheck(parseDeviceObject->SecurityDescriptor,
-                                          &AccessState->SubjectSecurityContext,
-                                          subjectContextLocked,
-                                          desiredAccess,
-                                          0,
-                                          &privileges,
-                                          &IoFileObjectType->TypeInfo.GenericMapping,
-                                          UserMode,
-                                          &grantedAccess,
-                                          &status);
+            accessGranted = ObCachedAccessCheck(parseDeviceObject->SecurityDescriptor,
+                                                &AccessState->SubjectSecurityContext,
+                                                desiredAccess,
+                                                0,
+                                                &privileges,
+                                                IoFileObjectType,
+                                                UserMode,
+                                                &grantedAccess,
+                                                &status);
             if (privileges) {
                 (VOID)SeAppendPrivileges(AccessState, privileges);
                 SeFreePrivileges(privileges);
@@ -417,16 +419,15 @@ reparse_loop:
                     // Perform a full-blown access check to determine whether some other ACE allows traverse access.
                     SeLockSubjectContext(&AccessState->SubjectSecurityContext);
                     subjectContextLocked = TRUE;
-                    accessGranted = SeAccessCheck(parseDeviceObject->SecurityDescriptor,
-                                                  &AccessState->SubjectSecurityContext,
-                                                  subjectContextLocked,
-                                                  FILE_TRAVERSE,
-                                                  0,
-                                                  &privileges,
-                                                  &IoFileObjectType->TypeInfo.GenericMapping,
-                                                  UserMode,
-                                                  &grantedAccess,
-                                                  &status);
+                    accessGranted = ObCachedAccessCheck(parseDeviceObject->SecurityDescriptor,
+                                                        &AccessState->SubjectSecurityContext,
+                                                        FILE_TRAVERSE,
+                                                        0,
+                                                        &privileges,
+                                                        IoFileObjectType,
+                                                        UserMode,
+                                                        &grantedAccess,
+                                                        &status);
                     if (privileges) {
                         (VOID)SeAppendPrivileges(AccessState, privileges);
                         SeFreePrivileges(privileges);
@@ -561,16 +562,15 @@ reparse_loop:
         ExAcquireResourceSharedLite(&IopSecurityResource, TRUE);
         SeLockSubjectContext(&AccessState->SubjectSecurityContext);
         subjectContextLocked = TRUE;
-        accessGranted = SeAccessCheck(parseDeviceObject->SecurityDescriptor,
-                                      &AccessState->SubjectSecurityContext,
-                                      subjectContextLocked,
-                                      desiredAccess,
-                                      0,
-                                      &privileges,
-                                      &IoFileObjectType->TypeInfo.GenericMapping,
-                                      UserMode,
-                                      &grantedAccess,
-                                      &status);
+        accessGranted = ObCachedAccessCheck(parseDeviceObject->SecurityDescriptor,
+                                            &AccessState->SubjectSecurityContext,
+                                            desiredAccess,
+                                            0,
+                                            &privileges,
+                                            IoFileObjectType,
+                                            UserMode,
+                                            &grantedAccess,
+                                            &status);
         if (privileges) {
             (VOID)SeAppendPrivileges(AccessState, privileges);
             SeFreePrivileges(privileges);
@@ -606,6 +606,31 @@ reparse_loop:
         }
     }
 
+    // If the volume's file system maintains a negative create cache, consult it for plain opens of existing files by absolute name.
+    // The open must go straight to the volume device object, since a filter above it may present a different namespace,
+    // and the caller must be able to traverse without checks, so that the file system would have failed it with the same status.
+    // Special opens are excluded: an open of the target directory of a rename or link succeeds precisely when the final component does not exist,
+    // and paging file and open by id opens do not resolve the name the way a plain open does.
+    // Since the cache is only remembered here, a failure of any excluded open is never inserted either.
+    if (vpb &&
+        deviceObject == vpb->DeviceObject &&
+        vpb->DeviceObject->DeviceObjectExtension->CreateCache &&
+        !op->RelatedFileObject &&
+        RemainingName->Length &&
+        op->CreateFileType == CreateFileTypeNone &&
+        (op->Disposition == FILE_OPEN || op->Disposition == FILE_OVERWRITE) &&
+        !(op->CreateOptions & FILE_OPEN_BY_FILE_ID) &&
+        !(op->Options & (IO_OPEN_TARGET_DIRECTORY | IO_OPEN_PAGING_FILE)) &&
+        (AccessState->Flags & TOKEN_HAS_TRAVERSE_PRIVILEGE)) {
+        createCache = vpb->DeviceObject->DeviceObjectExtension->CreateCache;
+        if (IopLookupCreateCache(createCache, RemainingName, (BOOLEAN)((Attributes & OBJ_CASE_INSENSITIVE) != 0), &createCacheGeneration)) {
+            IopDecrementDeviceObjectRef(parseDeviceObject, FALSE, FALSE);
+            IopDereferenceVpbAndFree(vpb);
+            op->Information = 0;
+            return op->FinalStatus = STATUS_OBJECT_NAME_NOT_FOUND;
+        }
+    }
+
     // Allocate and fill in the I/O Request Packet (IRP) to use in interfacing to the driver.
     // The allocation is done using an exception handler in case the caller does not have enough quota to allocate the packet.
     irp = IopAllocateIrp(deviceObject->StackSize, FALSE);
@@ -909,6 +934,11 @@ reparse_loop:
             }
         } else {
             // The operation ended in an error.
+            // If the file system did not find the name in a plain open, remember that in the volume's negative create cache.
+            if (createCache && status == STATUS_OBJECT_NAME_NOT_FOUND) {
+                IopInsertCreateCache(createCache, RemainingName, (BOOLEAN)((Attributes & OBJ_CASE_INSENSITIVE) != 0), createCacheGeneration);
+            }
+
             // Kill the file object, dereference the device object, and return a null pointer.
             if (fileObject->FileName.Length) {
                 ExFreePool(fileObject->FileName.Buffer);
@@ -21,6 +21,7 @@ const KPRIORITY IopCacheHitIncrement = IO_NO_INCREMENT;
 
 #pragma alloc_text(PAGE, NtReadFile)
 #pragma alloc_text(PAGE, NtReadFileScatter)
+#pragma alloc_text(PAGE, NtReadFileVector)
 
 
 NTSTATUS NtReadFile(
@@ -61,6 +62,7 @@ Return Value:
     PFILE_OBJECT fileObject;
     PDEVICE_OBJECT deviceObject;
     PFAST_IO_DISPATCH fastIoDispatch;
+    PDEVICE_OBJECT fastIoDeviceObject;
     KPROCESSOR_MODE requestorMode;
     PIO_STACK_LOCATION irpSp;
     NTSTATUS exceptionCode;
@@ -194,7 +196,9 @@ Return Value:
         }
     }
 
-    fastIoDispatch = deviceObject->DriverObject->FastIoDispatch;// Get the address of the driver object's Fast I/O dispatch structure.
+    // Get the address of the Fast I/O dispatch structure of the driver that handles cached reads, skipping pass-through filters.
+    fastIoDeviceObject = IopGetFastIoDeviceObject(deviceObject);
+    fastIoDispatch = fastIoDeviceObject->DriverObject->FastIoDispatch;
 
     // Make a special check here to determine whether this is a synchronous I/O operation.
     // If it is, then wait here until the file is owned by the current thread.
@@ -232,7 +236,7 @@ Return Value:
                 return STATUS_INVALID_PARAMETER;
             }
 
-            if (fastIoDispatch->FastIoRead(fileObject, &fileOffset, Length, TRUE, keyValue, Buffer, &localIoStatus, deviceObject) &&
+            if (fastIoDispatch->FastIoRead(fileObject, &fileOffset, Length, TRUE, keyValue, Buffer, &localIoStatus, fastIoDeviceObject) &&
                 ((localIoStatus.Status == STATUS_SUCCESS) || (localIoStatus.Status == STATUS_BUFFER_OVERFLOW) || (localIoStatus.Status == STATUS_END_OF_FILE))) {
                 // Boost the priority of the current thread so that it appears as if it just did I/O.
                 // This causes background jobs that get cache hits to be more responsive in terms of getting more CPU time.
@@ -783,6 +787,35 @@ Notes:
     return status;
 }
 
+NTSTATUS NtReadFileVector(
+    __in HANDLE FileHandle,
+    __out PIO_STATUS_BLOCK IoStatusBlock,
+    __in_ecount(VectorCount) PFILE_IO_VECTOR Vector,
+    __in ULONG VectorCount,
+    __in_opt PLARGE_INTEGER ByteOffset,
+    __in_opt PULONG Key
+)
+/*
+Routine Description:
+    This service reads data from the file associated with FileHandle, starting at ByteOffset, into the buffer segments described by Vector, in order.
+    Segments may have any address and length; the transfer is performed as a single operation on the file object.
+    Segments of a cached file are copied from the cache directly by the file system's Fast I/O path where possible.
+Arguments:
+    FileHandle - Supplies a handle to the file, which must have been opened for synchronous I/O.
+    IoStatusBlock - Address of the caller's I/O status block; receives the total number of bytes read.
+    Vector - Supplies the array of buffer segments.
+    VectorCount - Supplies the number of entries in Vector.
+    ByteOffset - Optionally specifies the starting byte offset within the file; if not specified, the current file position is used.
+    Key - Optionally specifies a key to be used if there are locks associated with the file.
+Return Value:
+    The final status of the operation.
+*/
+{
+    PAGED_CODE();
+
+    return IopReadWriteFileVector(FileHandle, IoStatusBlock, Vector, VectorCount, ByteOffset, Key, IRP_MJ_READ);
+}
+
 
 #ifdef ALLOC_DATA_PRAGMA
 #pragma const_seg()
@@ -0,0 +1,248 @@
+/*
+Copyright (c) Microsoft Corporation. All rights reserved.
+
+You may only use this code if you agree to the terms of the Windows Research Kernel Source Code License agreement (see License.txt).
+If you do not agree to the terms, do not use the code.
+
+Module Name:
+    steer.c
+
+Abstract:
+    This module implements interrupt and DPC steering for devices with multiple request queues.
+    IoConnectQueueInterrupts binds the interrupt of each queue to a single processor, spreading the queues over the active processors,
+    so that a driver can submit each request on the queue whose interrupt is delivered to the processor that issued it.
+    A DPC steering object holds one DPC per processor,
+    so that the completion of a request can be targeted at the processor that issued it even when the interrupt was delivered elsewhere.
+    Requests are redirected to the interrupting processor when the DPC load measured on the target processor is well above the load on the interrupting one.
+*/
+
+#include "iomgr.h"
+
+VOID IopSteeredDpcRoutine(IN PKDPC Dpc, IN PVOID DeferredContext, IN PVOID SystemArgument1, IN PVOID SystemArgument2);
+
+#pragma alloc_text(PAGE, IoConnectQueueInterrupts)
+#pragma alloc_text(PAGE, IoDisconnectQueueInterrupts)
+#pragma alloc_text(PAGE, IoCreateDpcSteering)
+#pragma alloc_text(PAGE, IoDeleteDpcSteering)
+
+
+NTSTATUS IoConnectQueueInterrupts(IN PKSERVICE_ROUTINE ServiceRoutine,
+                                  IN OUT PIO_QUEUE_INTERRUPT Queues,
+                                  IN ULONG QueueCount,
+                                  IN KIRQL Irql,
+                                  IN KINTERRUPT_MODE InterruptMode,
+                                  IN BOOLEAN ShareVector
+)
+/*
+Routine Description:
+    This routine connects the interrupts of the queues of a multi-queue device, each to a single processor.
+    Queue N is bound to the Nth active processor, wrapping around when there are more queues than processors.
+    The interrupts of all queues are synchronized at their own IRQL with a spin lock of their own.
+Arguments:
+    ServiceRoutine - Address of the interrupt service routine shared by all the queues.
+    Queues - Supplies the vector and ISR context of each queue.
+        Receives the interrupt object of each queue and the processor its interrupt was bound to.
+    QueueCount - Supplies the number of queues.
+    Irql - Supplies the IRQL upon which the interrupts occur.
+    InterruptMode - Specifies the interrupt mode of the device.
+    ShareVector - Supplies whether the vectors can be shared with other interrupt objects.
+Return Value:
+    STATUS_SUCCESS if every queue was connected.
+    Otherwise the status of the first queue that could not be connected, in which case no queue is left connected.
+*/
+{
+    KAFFINITY activeProcessors;
+    ULONG processor;
+    ULONG queue;
+    NTSTATUS status;
+
+    PAGED_CODE();
+
+    if (QueueCount == 0) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    activeProcessors = KeActiveProcessors;
+    processor = 0;
+
+    for (queue = 0; queue < QueueCount; queue++) {
+        // Advance to the next active processor, wrapping around to the first one.
+        while (!(activeProcessors & AFFINITY_MASK(processor))) {
+            processor = (processor + 1) % MAXIMUM_PROCESSORS;
+        }
+
+        Queues[queue].Processor = processor;
+        status = IoConnectInterrupt(&Queues[queue].InterruptObject,
+                                    ServiceRoutine,
+                                    Queues[queue].ServiceContext,
+                                    NULL,
+                                    Queues[queue].Vector,
+                                    Irql,
+                                    Irql,
+                                    InterruptMode,
+                                    ShareVector,
+                                    AFFINITY_MASK(processor),
+                                    FALSE);
+        if (!NT_SUCCESS(status)) {
+            IoDisconnectQueueInterrupts(Queues, queue);
+            return status;
+        }
+
+        processor = (processor + 1) % MAXIMUM_PROCESSORS;
+    }
+
+    return STATUS_SUCCESS;
+}
+
+
+VOID IoDisconnectQueueInterrupts(IN PIO_QUEUE_INTERRUPT Queues, IN ULONG QueueCount)
+/*
+Routine Description:
+    This routine disconnects the queue interrupts connected by IoConnectQueueInterrupts.
+Arguments:
+    Queues - Supplies the queues whose interrupts are to be disconnected.
+    QueueCount - Supplies the number of queues.
+*/
+{
+    ULONG queue;
+
+    PAGED_CODE();
+
+    for (queue = 0; queue < QueueCount; queue++) {
+        if (Queues[queue].InterruptObject) {
+            IoDisconnectInterrupt(Queues[queue].InterruptObject);
+            Queues[queue].InterruptObject = NULL;
+        }
+    }
+}
+
+
+NTSTATUS IoCreateDpcSteering(IN PDEVICE_OBJECT DeviceObject, IN PIO_DPC_ROUTINE DpcRoutine, OUT PIO_DPC_STEERING* Steering)
+/*
+Routine Description:
+    This routine creates a DPC steering object for a device.
+    The object holds a DPC targeted at each processor, all of which call the same DPC routine.
+Arguments:
+    DeviceObject - Supplies the device object passed to the DPC routine.
+    DpcRoutine - Address of the driver's DPC routine.
+    Steering - Receives the steering object, which is passed to IoRequestSteeredDpc.
+Return Value:
+    STATUS_SUCCESS, or STATUS_INSUFFICIENT_RESOURCES if the object could not be allocated.
+*/
+{
+    PIO_DPC_STEERING steering;
+    ULONG size;
+    ULONG processor;
+
+    PAGED_CODE();
+
+    size = FIELD_OFFSET(IO_DPC_STEERING, Processor) + KeNumberProcessors * sizeof(IOP_STEERED_DPC);
+    steering = ExAllocatePoolWithTag(NonPagedPoolCacheAligned, size, 'sDoI');
+    if (!steering) {
+        return STATUS_INSUFFICIENT_RESOURCES;
+    }
+
+    RtlZeroMemory(steering, size);
+    steering->DeviceObject = DeviceObject;
+    steering->DpcRoutine = DpcRoutine;
+
+    for (processor = 0; processor < (ULONG)KeNumberProcessors; processor++) {
+        steering->Processor[processor].Steering = steering;
+        KeInitializeDpc(&steering->Processor[processor].Dpc, IopSteeredDpcRoutine, &steering->Processor[processor]);
+        KeSetTargetProcessorDpc(&steering->Processor[processor].Dpc, (CCHAR)processor);
+    }
+
+    *Steering = steering;
+    return STATUS_SUCCESS;
+}
+
+
+VOID IoDeleteDpcSteering(IN PIO_DPC_STEERING Steering)
+/*
+Routine Description:
+    This routine deletes a DPC steering object.
+    The caller must have disconnected the interrupts that request its DPCs.
+    DPCs that are still queued are removed, and the routine waits for any that are running to return.
+Arguments:
+    Steering - Supplies the steering object.
+*/
+{
+    ULONG processor;
+
+    PAGED_CODE();
+
+    for (processor = 0; processor < (ULONG)KeNumberProcessors; processor++) {
+        KeRemoveQueueDpc(&Steering->Processor[processor].Dpc);
+    }
+
+    KeFlushQueuedDpcs();
+    ExFreePool(Steering);
+}
+
+
+BOOLEAN IoRequestSteeredDpc(IN PIO_DPC_STEERING Steering, IN ULONG TargetProcessor, IN PIRP Irp, IN PVOID Context)
+/*
+Routine Description:
+    This routine is invoked by the device driver's interrupt service routine to queue its DPC routine on a given processor.
+    As with IoRequestDpc, a request made while the DPC for the processor is still queued is coalesced with it.
+    If the measured DPC load of the target processor is more than twice the load of the current processor,
+    the DPC is queued on the current processor instead, trading locality for throughput.
+Arguments:
+    Steering - Supplies the steering object.
+    TargetProcessor - Supplies the processor to run the DPC on, normally the processor that issued the request being completed.
+        A number that is not a valid processor selects the current processor.
+    Irp - Pointer to the I/O Request Packet passed to the DPC routine.
+    Context - Provides a general context parameter to be passed to the DPC routine.
+Return Value:
+    TRUE if the DPC was queued, FALSE if it was already queued.
+*/
+{
+    PIOP_STEERED_DPC target;
+    PIOP_STEERED_DPC current;
+
+    current = &Steering->Processor[KeGetCurrentProcessorNumber()];
+    if (TargetProcessor >= (ULONG)KeNumberProcessors) {
+        target = current;
+    } else {
+        target = &Steering->Processor[TargetProcessor];
+    }
+
+    // The load of a processor is only updated when its DPC runs, so a processor that was once busy would be avoided for good.
+    // Let its load decay each time a request is redirected away from it; the update races with the DPC routine, which only makes the estimate less precise.
+    if (target != current && target->Load / 2 > current->Load + IOP_STEERED_DPC_LOAD_SLACK) {
+        target->Load -= target->Load >> IOP_STEERED_DPC_LOAD_SHIFT;
+        target->Redirected += 1;
+        target = current;
+    }
+
+    return KeInsertQueueDpc(&target->Dpc, Irp, Context);
+}
+
+
+VOID IopSteeredDpcRoutine(IN PKDPC Dpc, IN PVOID DeferredContext, IN PVOID SystemArgument1, IN PVOID SystemArgument2)
+/*
+Routine Description:
+    This routine is the deferred routine of every DPC of a steering object.
+    It calls the driver's DPC routine and folds the cycles it took into the load of the processor.
+Arguments:
+    Dpc - Supplies the DPC of the current processor.
+    DeferredContext - Supplies the steered DPC of the current processor.
+    SystemArgument1 - Supplies the IRP passed to IoRequestSteeredDpc.
+    SystemArgument2 - Supplies the context passed to IoRequestSteeredDpc.
+*/
+{
+    PIOP_STEERED_DPC steeredDpc = (PIOP_STEERED_DPC)DeferredContext;
+    PIO_DPC_STEERING steering = steeredDpc->Steering;
+    ULONG64 cycles;
+
+    cycles = PerfGetCycleCount();
+    steering->DpcRoutine(Dpc, steering->DeviceObject, (PIRP)SystemArgument1, SystemArgument2);
+    cycles = PerfGetCycleCount() - cycles;
+
+    if (cycles > MAXULONG) {
+        cycles = MAXULONG;
+    }
+
+    steeredDpc->Load = steeredDpc->Load - (steeredDpc->Load >> IOP_STEERED_DPC_LOAD_SHIFT) + ((ULONG)cycles >> IOP_STEERED_DPC_LOAD_SHIFT);
+    steeredDpc->Executed += 1;
+}
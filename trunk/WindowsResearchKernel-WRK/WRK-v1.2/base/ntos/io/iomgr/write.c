@@ -15,6 +15,7 @@ Abstract:
 
 #pragma alloc_text(PAGE, NtWriteFile)
 #pragma alloc_text(PAGE, NtWriteFileGather)
+#pragma alloc_text(PAGE, NtWriteFileVector)
 
 
 NTSTATUS NtWriteFile(
@@ -57,6 +58,7 @@ Return Value:
     PFILE_OBJECT fileObject;
     PDEVICE_OBJECT deviceObject;
     PFAST_IO_DISPATCH fastIoDispatch;
+    PDEVICE_OBJECT fastIoDeviceObject;
     KPROCESSOR_MODE requestorMode;
     PMDL mdl;
     PIO_STACK_LOCATION irpSp;
@@ -211,7 +213,9 @@ Return Value:
         }
     }
 
-    fastIoDispatch = deviceObject->DriverObject->FastIoDispatch;// Get the address of the fast io dispatch structure.
+    // Get the address of the fast io dispatch structure of the driver that handles cached writes, skipping pass-through filters.
+    fastIoDeviceObject = IopGetFastIoDeviceObject(deviceObject);
+    fastIoDispatch = fastIoDeviceObject->DriverObject->FastIoDispatch;
 
     // Make a special check here to determine whether this is a synchronous I/O operation.
     // If it is, then wait here until the file is owned by the current thread.
@@ -259,7 +263,7 @@ Return Value:
                 return STATUS_INVALID_PARAMETER;
             }
 
-            if (fastIoDispatch->FastIoWrite(fileObject, &fileOffset, Length, TRUE, keyValue, Buffer, &localIoStatus, deviceObject) && (localIoStatus.Status == STATUS_SUCCESS)) {
+            if (fastIoDispatch->FastIoWrite(fileObject, &fileOffset, Length, TRUE, keyValue, Buffer, &localIoStatus, fastIoDeviceObject) && (localIoStatus.Status == STATUS_SUCCESS)) {
                 IopUpdateWriteOperationCount();
                 IopUpdateWriteTransferCount((ULONG)localIoStatus.Information);
 
@@ -854,4 +858,33 @@ Notes:
     // Queue the packet, call the driver, and synchronize appropriately with I/O completion.
     status = IopSynchronousServiceTail(deviceObject, irp, fileObject, TRUE, requestorMode, synchronousIo, WriteTransfer);
     return status;
+}
+
+NTSTATUS NtWriteFileVector(
+    __in HANDLE FileHandle,
+    __out PIO_STATUS_BLOCK IoStatusBlock,
+    __in_ecount(VectorCount) PFILE_IO_VECTOR Vector,
+    __in ULONG VectorCount,
+    __in_opt PLARGE_INTEGER ByteOffset,
+    __in_opt PULONG Key
+)
+/*
+Routine Description:
+    This service writes data to the file associated with FileHandle, starting at ByteOffset, from the buffer segments described by Vector, in order.
+    Segments may have any address and length; the transfer is performed as a single operation on the file object.
+    Segments of a cached file are copied to the cache directly by the file system's Fast I/O path where possible.
+Arguments:
+    FileHandle - Supplies a handle to the file, which must have been opened for synchronous I/O.
+    IoStatusBlock - Address of the caller's I/O status block; receives the total number of bytes written.
+    Vector - Supplies the array of buffer segments.
+    VectorCount - Supplies the number of entries in Vector.
+    ByteOffset - Optionally specifies the starting byte offset within the file; if not specified, the current file position is used.
+    Key - Optionally specifies a key to be used if there are locks associated with the file.
+Return Value:
+    The final status of the operation.
+*/
+{
+    PAGED_CODE();
+
+    return IopReadWriteFileVector(FileHandle, IoStatusBlock, Vector, VectorCount, ByteOffset, Key, IRP_MJ_WRITE);
 }
\ No newline at end of file
@@ -52,6 +52,19 @@ extern POBJECT_TYPE IoDeviceObjectType;
             ( (StackSize) * sizeof( IO_STACK_LOCATION )))); }
 
 
+// VOID IopInitializeCachedIrp(IN OUT PIRP Irp, IN USHORT PacketSize, IN CCHAR StackSize)
+// Routine Description:
+//     Initializes an IRP whose allocation may hold more stack locations than are requested.
+//     Only the header and the StackSize stack locations in use are zeroed; the rest of the allocation is never referenced.
+// Arguments:
+//     Irp - a pointer to the IRP to initialize.
+//     PacketSize - length, in bytes, of the allocation.
+//     StackSize - Number of stack locations in the IRP.
+#define IopInitializeCachedIrp( Irp, PacketSize, StackSize ) {    \
+    IopInitializeIrp( (Irp), IoSizeOfIrp( (StackSize) ), (StackSize) ); \
+    (Irp)->Size = (USHORT) ((PacketSize)); }
+
+
 // IO manager exports to PNP
 BOOLEAN IopCallBootDriverReinitializationRoutines();
 BOOLEAN IopCallDriverReinitializationRoutines();
@@ -371,8 +371,17 @@ TABLE_ENTRY  WaitForDebugEvent, 0, 0
 TABLE_ENTRY  WaitForKeyedEvent, 0, 0
 TABLE_ENTRY  WaitHighEventPair, 0, 0
 TABLE_ENTRY  WaitLowEventPair, 0, 0
+TABLE_ENTRY  CloseMultiple, 0, 0
+TABLE_ENTRY  DuplicateObjects, 1, 4
+TABLE_ENTRY  RemoveIoCompletionEx, 1, 1
+TABLE_ENTRY  CreateIoRing, 1, 3
+TABLE_ENTRY  SubmitIoRing, 0, 0
+TABLE_ENTRY  RegisterIoRingFiles, 0, 0
+TABLE_ENTRY  RegisterIoRingBuffers, 0, 0
+TABLE_ENTRY  ReadFileVector, 1, 2
+TABLE_ENTRY  WriteFileVector, 1, 2
 
-TABLE_END 295
+TABLE_END 304
 
 ARGTBL_BEGIN
 ARGTBL_ENTRY 0,0,0,20,24,20,4,0
@@ -412,5 +421,7 @@ ARGTBL_ENTRY 0,0,0,4,0,0,0,0
 ARGTBL_ENTRY 0,0,4,0,0,0,0,0
 ARGTBL_ENTRY 0,8,0,0,0,0,0,0
 ARGTBL_ENTRY 0,4,0,0,0,0,0,0
+ARGTBL_ENTRY 0,16,4,12,0,0,0,8
+ARGTBL_ENTRY 8,0,0,0,0,0,0,0
 
 ARGTBL_END
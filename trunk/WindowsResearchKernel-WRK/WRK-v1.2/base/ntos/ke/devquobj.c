@@ -193,6 +193,65 @@ Return Value:
 }
 
 
+BOOLEAN KeInsertByDeadlineDeviceQueue(__inout PKDEVICE_QUEUE DeviceQueue, __inout PKDEVICE_QUEUE_ENTRY DeviceQueueEntry, __in ULONG Deadline)
+/*
+Routine Description:
+    This function inserts a device queue entry into the specified device queue according to a deadline expressed in clock ticks.
+    If the device is not busy, then it is set busy and the entry is not placed in the device queue.
+    Otherwise the specified entry is placed in the device queue after every entry whose deadline is not later and before every entry whose deadline is later.
+    Deadlines are taken from the low part of the tick count, which wraps, so they are compared by their signed difference rather than by value.
+    This orders them correctly as long as the deadlines in the queue lie within 2^31 ticks of each other.
+Arguments:
+    DeviceQueue - Supplies a pointer to a control object of type device queue.
+    DeviceQueueEntry - Supplies a pointer to a device queue entry.
+    Deadline - Supplies the tick count by which the entry should be started.
+Return Value:
+    If the device is not busy, then a value of FALSE is returned.
+    Otherwise a value of TRUE is returned.
+*/
+{
+    BOOLEAN Busy;
+    BOOLEAN Inserted;
+    KLOCK_QUEUE_HANDLE LockHandle;
+    PLIST_ENTRY NextEntry;
+    PKDEVICE_QUEUE_ENTRY QueueEntry;
+
+    ASSERT_DEVICE_QUEUE(DeviceQueue);
+
+    // Set inserted to FALSE and lock specified device queue.
+    Inserted = FALSE;
+    DeviceQueueEntry->SortKey = Deadline;
+    KiAcquireInStackQueuedSpinLockForDpc(&DeviceQueue->Lock, &LockHandle);
+
+    // Insert the specified device queue entry in the device queue at the position specified by the deadline if the device queue is busy.
+    // Otherwise set the device queue busy and don't insert the device queue entry.
+    Busy = DeviceQueue->Busy;
+    DeviceQueue->Busy = TRUE;
+    if (Busy == TRUE) {
+        NextEntry = &DeviceQueue->DeviceListHead;
+        if (IsListEmpty(NextEntry) == FALSE) {
+            // Check the last queue entry in the list, which will have the latest deadline.
+            // If its deadline is not later than the specified deadline, then the insertion point has been found.
+            // Otherwise, walk the list forward until the insertion point is found.
+            QueueEntry = CONTAINING_RECORD(NextEntry->Blink, KDEVICE_QUEUE_ENTRY, DeviceListEntry);
+            if ((LONG)(Deadline - QueueEntry->SortKey) < 0) {
+                do {
+                    NextEntry = NextEntry->Flink;
+                    QueueEntry = CONTAINING_RECORD(NextEntry, KDEVICE_QUEUE_ENTRY, DeviceListEntry);
+                } while ((LONG)(Deadline - QueueEntry->SortKey) >= 0);
+            }
+        }
+
+        InsertTailList(NextEntry, &DeviceQueueEntry->DeviceListEntry);
+        Inserted = TRUE;
+    }
+
+    DeviceQueueEntry->Inserted = Inserted;
+    KiReleaseInStackQueuedSpinLockForDpc(&LockHandle);// Unlock specified device queue.
+    return Inserted;
+}
+
+
 PKDEVICE_QUEUE_ENTRY KeRemoveDeviceQueue(__inout PKDEVICE_QUEUE DeviceQueue)
 /*
 Routine Description:
@@ -2481,5 +2481,77 @@ SYSSTUBS_ENTRY5  295, WaitForMultipleObjects32, 5
 SYSSTUBS_ENTRY6  295, WaitForMultipleObjects32, 5
 SYSSTUBS_ENTRY7  295, WaitForMultipleObjects32, 5
 SYSSTUBS_ENTRY8  295, WaitForMultipleObjects32, 5
+SYSSTUBS_ENTRY1  296, CloseMultiple, 3
+SYSSTUBS_ENTRY2  296, CloseMultiple, 3
+SYSSTUBS_ENTRY3  296, CloseMultiple, 3
+SYSSTUBS_ENTRY4  296, CloseMultiple, 3
+SYSSTUBS_ENTRY5  296, CloseMultiple, 3
+SYSSTUBS_ENTRY6  296, CloseMultiple, 3
+SYSSTUBS_ENTRY7  296, CloseMultiple, 3
+SYSSTUBS_ENTRY8  296, CloseMultiple, 3
+SYSSTUBS_ENTRY1  297, DuplicateObjects, 8
+SYSSTUBS_ENTRY2  297, DuplicateObjects, 8
+SYSSTUBS_ENTRY3  297, DuplicateObjects, 8
+SYSSTUBS_ENTRY4  297, DuplicateObjects, 8
+SYSSTUBS_ENTRY5  297, DuplicateObjects, 8
+SYSSTUBS_ENTRY6  297, DuplicateObjects, 8
+SYSSTUBS_ENTRY7  297, DuplicateObjects, 8
+SYSSTUBS_ENTRY8  297, DuplicateObjects, 8
+SYSSTUBS_ENTRY1  298, RemoveIoCompletionEx, 5
+SYSSTUBS_ENTRY2  298, RemoveIoCompletionEx, 5
+SYSSTUBS_ENTRY3  298, RemoveIoCompletionEx, 5
+SYSSTUBS_ENTRY4  298, RemoveIoCompletionEx, 5
+SYSSTUBS_ENTRY5  298, RemoveIoCompletionEx, 5
+SYSSTUBS_ENTRY6  298, RemoveIoCompletionEx, 5
+SYSSTUBS_ENTRY7  298, RemoveIoCompletionEx, 5
+SYSSTUBS_ENTRY8  298, RemoveIoCompletionEx, 5
+SYSSTUBS_ENTRY1  299, CreateIoRing, 7
+SYSSTUBS_ENTRY2  299, CreateIoRing, 7
+SYSSTUBS_ENTRY3  299, CreateIoRing, 7
+SYSSTUBS_ENTRY4  299, CreateIoRing, 7
+SYSSTUBS_ENTRY5  299, CreateIoRing, 7
+SYSSTUBS_ENTRY6  299, CreateIoRing, 7
+SYSSTUBS_ENTRY7  299, CreateIoRing, 7
+SYSSTUBS_ENTRY8  299, CreateIoRing, 7
+SYSSTUBS_ENTRY1  300, SubmitIoRing, 3
+SYSSTUBS_ENTRY2  300, SubmitIoRing, 3
+SYSSTUBS_ENTRY3  300, SubmitIoRing, 3
+SYSSTUBS_ENTRY4  300, SubmitIoRing, 3
+SYSSTUBS_ENTRY5  300, SubmitIoRing, 3
+SYSSTUBS_ENTRY6  300, SubmitIoRing, 3
+SYSSTUBS_ENTRY7  300, SubmitIoRing, 3
+SYSSTUBS_ENTRY8  300, SubmitIoRing, 3
+SYSSTUBS_ENTRY1  301, RegisterIoRingFiles, 3
+SYSSTUBS_ENTRY2  301, RegisterIoRingFiles, 3
+SYSSTUBS_ENTRY3  301, RegisterIoRingFiles, 3
+SYSSTUBS_ENTRY4  301, RegisterIoRingFiles, 3
+SYSSTUBS_ENTRY5  301, RegisterIoRingFiles, 3
+SYSSTUBS_ENTRY6  301, RegisterIoRingFiles, 3
+SYSSTUBS_ENTRY7  301, RegisterIoRingFiles, 3
+SYSSTUBS_ENTRY8  301, RegisterIoRingFiles, 3
+SYSSTUBS_ENTRY1  302, RegisterIoRingBuffers, 3
+SYSSTUBS_ENTRY2  302, RegisterIoRingBuffers, 3
+SYSSTUBS_ENTRY3  302, RegisterIoRingBuffers, 3
+SYSSTUBS_ENTRY4  302, RegisterIoRingBuffers, 3
+SYSSTUBS_ENTRY5  302, RegisterIoRingBuffers, 3
+SYSSTUBS_ENTRY6  302, RegisterIoRingBuffers, 3
+SYSSTUBS_ENTRY7  302, RegisterIoRingBuffers, 3
+SYSSTUBS_ENTRY8  302, RegisterIoRingBuffers, 3
+SYSSTUBS_ENTRY1  303, ReadFileVector, 6
+SYSSTUBS_ENTRY2  303, ReadFileVector, 6
+SYSSTUBS_ENTRY3  303, ReadFileVector, 6
+SYSSTUBS_ENTRY4  303, ReadFileVector, 6
+SYSSTUBS_ENTRY5  303, ReadFileVector, 6
+SYSSTUBS_ENTRY6  303, ReadFileVector, 6
+SYSSTUBS_ENTRY7  303, ReadFileVector, 6
+SYSSTUBS_ENTRY8  303, ReadFileVector, 6
+SYSSTUBS_ENTRY1  304, WriteFileVector, 6
+SYSSTUBS_ENTRY2  304, WriteFileVector, 6
+SYSSTUBS_ENTRY3  304, WriteFileVector, 6
+SYSSTUBS_ENTRY4  304, WriteFileVector, 6
+SYSSTUBS_ENTRY5  304, WriteFileVector, 6
+SYSSTUBS_ENTRY6  304, WriteFileVector, 6
+SYSSTUBS_ENTRY7  304, WriteFileVector, 6
+SYSSTUBS_ENTRY8  304, WriteFileVector, 6
 
 STUBS_END
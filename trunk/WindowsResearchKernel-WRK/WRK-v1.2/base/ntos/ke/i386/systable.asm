@@ -389,8 +389,17 @@ TABLE_ENTRY  WaitForKeyedEvent, 1, 4
 TABLE_ENTRY  QueryPortInformationProcess, 0, 0
 TABLE_ENTRY  GetCurrentProcessorNumber, 0, 0
 TABLE_ENTRY  WaitForMultipleObjects32, 1, 5
+TABLE_ENTRY  CloseMultiple, 1, 3
+TABLE_ENTRY  DuplicateObjects, 1, 8
+TABLE_ENTRY  RemoveIoCompletionEx, 1, 5
+TABLE_ENTRY  CreateIoRing, 1, 7
+TABLE_ENTRY  SubmitIoRing, 1, 3
+TABLE_ENTRY  RegisterIoRingFiles, 1, 3
+TABLE_ENTRY  RegisterIoRingBuffers, 1, 3
+TABLE_ENTRY  ReadFileVector, 1, 6
+TABLE_ENTRY  WriteFileVector, 1, 6
 
-TABLE_END 295
+TABLE_END 304
 
 ARGTBL_BEGIN
 ARGTBL_ENTRY 24,32,44,44,64,44,64,68
@@ -430,5 +439,7 @@ ARGTBL_ENTRY 24,8,8,8,0,16,16,4
 ARGTBL_ENTRY 4,8,8,20,16,8,8,16
 ARGTBL_ENTRY 20,12,4,4,36,36,24,20
 ARGTBL_ENTRY 0,16,12,16,16,0,0,20
+ARGTBL_ENTRY 12,32,20,28,12,12,12,24
+ARGTBL_ENTRY 24,0,0,0,0,0,0,0
 
 ARGTBL_END
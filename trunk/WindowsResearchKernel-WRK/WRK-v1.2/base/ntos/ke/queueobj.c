@@ -316,6 +316,69 @@ Return Value:
 }
 
 
+ULONG KeRemoveQueueEx(__inout PRKQUEUE Queue,
+                      __in KPROCESSOR_MODE WaitMode,
+                      __in_opt PLARGE_INTEGER Timeout,
+                      __out_ecount(Count) PLIST_ENTRY *EntryArray,
+                      __in ULONG Count)
+/*
+Routine Description:
+    This function removes up to the specified number of entries from the Queue object entry list.
+    The first entry is removed exactly as KeRemoveQueue removes it, waiting if no entry is available.
+    Any further entries that are already in the list are then removed without waiting under a single acquisition of the dispatcher lock.
+    N.B. The calling thread counts once against the target maximum number of threads no matter how many entries it removes.
+Arguments:
+    Queue - Supplies a pointer to a dispatcher object of type Queue.
+    WaitMode  - Supplies the processor mode in which the wait is to occur.
+    Timeout - Supplies a pointer to an optional absolute of relative time over which the wait is to occur.
+    EntryArray - Supplies a pointer to an array that receives the addresses of the removed entries.
+    Count - Supplies the maximum number of entries to remove. This must be at least one.
+Return Value:
+    The number of values stored in the entry array.
+    If the wait ends with STATUS_TIMEOUT or STATUS_USER_APC, then one is returned and that status is the only value stored, as KeRemoveQueue returns it.
+*/
+{
+    PLIST_ENTRY Entry;
+    ULONG Index;
+    KIRQL OldIrql;
+
+    ASSERT_QUEUE(Queue);
+    ASSERT(Count != 0);
+
+    // Remove the first entry, waiting for it if necessary.
+    Entry = KeRemoveQueue(Queue, WaitMode, Timeout);
+    EntryArray[0] = Entry;
+    if (((LONG_PTR)Entry == STATUS_TIMEOUT) || ((LONG_PTR)Entry == STATUS_USER_APC) || (Count == 1)) {
+        return 1;
+    }
+
+    // If more entries are queued, then raise IRQL to SYNCH level, lock the dispatcher database, and take as many as will fit.
+    // The current thread is already active on the queue so the current number of active threads is not changed.
+    // N.B. The unlocked read of the signal state only avoids the lock when the queue is empty.
+    Index = 1;
+    if (Queue->Header.SignalState > 0) {
+        KiLockDispatcherDatabase(&OldIrql);
+        while (Index < Count) {
+            Entry = Queue->EntryListHead.Flink;
+            if (Entry == &Queue->EntryListHead) {
+                break;
+            }
+
+            Queue->Header.SignalState -= 1;
+            RemoveEntryList(Entry);
+            Entry->Flink = NULL;
+            EntryArray[Index] = Entry;
+            Index += 1;
+        }
+
+        KiUnlockDispatcherDatabaseFromSynchLevel();
+        KiExitDispatcher(OldIrql);
+    }
+
+    return Index;
+}
+
+
 PLIST_ENTRY KeRundownQueue(__inout PRKQUEUE Queue)
 /*
 Routine Description:
@@ -20,6 +20,9 @@ Abstract:
 #pragma alloc_text(PAGE,ObpCloseHandleTableEntry)
 #pragma alloc_text(PAGE,ObCloseHandle)
 #pragma alloc_text(PAGE,ObpCloseHandle)
+#pragma alloc_text(PAGE,ObpCloseHandles)
+#pragma alloc_text(PAGE,ObpDereferenceObjectBatch)
+#pragma alloc_text(PAGE,NtCloseMultiple)
 #endif
 
 extern BOOLEAN SepAdtAuditingEnabled;//  Indicates if auditing is enabled so we have to close down the object audit alarm
@@ -30,7 +33,8 @@ NTSTATUS ObpCloseHandleTableEntry(
     IN PHANDLE_TABLE_ENTRY ObjectTableEntry,
     IN HANDLE Handle,
     IN KPROCESSOR_MODE PreviousMode,
-    IN BOOLEAN Rundown)
+    IN BOOLEAN Rundown,
+    OUT PVOID *DeferredObject OPTIONAL)
     /*
     Routine Description:
         This function is used to close a handle table entry
@@ -38,6 +42,8 @@ NTSTATUS ObpCloseHandleTableEntry(
         ObjectTableEntry - Supplies the entry being closed. It must be locked
         PreviousMode     - Mode of caller
         Rundown          - Called as part of process rundown, ignore protected handles in this mode
+        DeferredObject   - If present receives the object whose handle was closed instead of it being dereferenced here.
+                           The caller then owns the reference the handle held. Left untouched if the handle is not closed.
     */
 {
     POBJECT_HEADER ObjectHeader;
@@ -110,7 +116,12 @@ NTSTATUS ObpCloseHandleTableEntry(
 
     //  Since we took the handle away we need to decrement the objects handle count, and remove a reference
     ObpDecrementHandleCount(PsGetCurrentProcess(), ObjectHeader, ObjectType, CapturedGrantedAccess);
-    ObDereferenceObject(Object);
+    if (ARGUMENT_PRESENT(DeferredObject)) {
+        *DeferredObject = Object;
+    } else {
+        ObDereferenceObject(Object);
+    }
+
     return STATUS_SUCCESS;//  And return to our caller
 }
 
@@ -158,7 +169,7 @@ Return Value:
 
     ObjectTableEntry = ExMapHandleToPointer(ObjectTable, Handle);
     if (ObjectTableEntry != NULL) {//  Check that the specified handle is legitimate otherwise we can assume the caller just passed in some bogus handle value
-        Status = ObpCloseHandleTableEntry(ObjectTable, ObjectTableEntry, Handle, PreviousMode, FALSE);
+        Status = ObpCloseHandleTableEntry(ObjectTable, ObjectTableEntry, Handle, PreviousMode, FALSE, NULL);
         KeLeaveCriticalRegionThread(&CurrentThread->Tcb);
         if (AttachedToProcess) {//  If we are attached to the system process then detach
             KeUnstackDetachProcess(&ApcState);
@@ -229,6 +240,167 @@ Return Value:
 }
 
 
+VOID ObpDereferenceObjectBatch(IN PVOID *Objects, IN ULONG Count)
+/*
+Routine Description:
+    This function drops one reference on each object in an array.
+    Runs of the same object are dereferenced with a single interlocked operation.
+Arguments:
+    Objects - Supplies the objects to dereference. NULL entries are skipped.
+    Count - Supplies the number of entries in the array
+*/
+{
+    ULONG Index, Run;
+
+    PAGED_CODE();
+
+    for (Index = 0; Index < Count; Index += Run) {
+        Run = 1;
+        if (Objects[Index] == NULL) {
+            continue;
+        }
+
+        while ((Index + Run < Count) && (Objects[Index + Run] == Objects[Index])) {
+            Run += 1;
+        }
+
+        //  A single reference is dropped with ObDereferenceObject so that the object is deleted inline at passive level if this was the last one.
+        if (Run == 1) {
+            ObDereferenceObject(Objects[Index]);
+        } else {
+            ObDereferenceObjectEx(Objects[Index], Run);
+        }
+    }
+}
+
+
+VOID ObpCloseHandles(IN ULONG Count, IN PHANDLE Handles, OUT PNTSTATUS Statuses, IN KPROCESSOR_MODE PreviousMode)
+/*
+Routine Description:
+    This function closes a batch of handles in the current process.
+    The handle table entries are all closed inside a single critical region and the object references the handles held are dropped afterwards in one pass.
+
+    Unlike ObpCloseHandle an invalid handle does not raise an exception, its status is simply returned.
+Arguments:
+    Count - Supplies the number of handles, at most OBP_HANDLE_BATCH
+    Handles - Supplies the captured handles to close
+    Statuses - Receives the close status for each handle
+    PreviousMode - Processor mode to be used in the handle access checks.
+*/
+{
+    PHANDLE_TABLE ObjectTable;
+    PHANDLE_TABLE_ENTRY ObjectTableEntry;
+    PVOID Objects[OBP_HANDLE_BATCH];
+    PETHREAD CurrentThread;
+    HANDLE Handle;
+    ULONG Index;
+
+    PAGED_CODE();
+
+    ObpValidateIrql("NtCloseMultiple");
+    ASSERT(Count <= OBP_HANDLE_BATCH);
+
+    CurrentThread = PsGetCurrentThread();
+    ObjectTable = PsGetCurrentProcessByThread(CurrentThread)->ObjectTable;
+
+    KeEnterCriticalRegionThread(&CurrentThread->Tcb);//  Protect ourselves from being interrupted while we hold handle table entry locks
+    for (Index = 0; Index < Count; Index += 1) {
+        Objects[Index] = NULL;
+        Handle = Handles[Index];
+
+        //  Kernel handles live in the system process handle table so they go through the single handle path that attaches to it
+        if (IsKernelHandle(Handle, PreviousMode)) {
+            Statuses[Index] = ObpCloseHandle(Handle, PreviousMode);
+            continue;
+        }
+
+        ObjectTableEntry = ExMapHandleToPointer(ObjectTable, Handle);
+        if (ObjectTableEntry != NULL) {
+            Statuses[Index] = ObpCloseHandleTableEntry(ObjectTable, ObjectTableEntry, Handle, PreviousMode, FALSE, &Objects[Index]);
+        } else {
+            Statuses[Index] = STATUS_INVALID_HANDLE;
+        }
+    }
+    KeLeaveCriticalRegionThread(&CurrentThread->Tcb);
+
+    ObpDereferenceObjectBatch(Objects, Count);
+}
+
+
+NTSTATUS NtCloseMultiple(__in ULONG Count, __in_ecount(Count) PHANDLE Handles, __out_ecount_opt(Count) PNTSTATUS Statuses)
+/*
+Routine Description:
+    This function is used to close access to a set of handles with a single system call
+Arguments:
+    Count - Supplies the number of handles to close, at most MAXIMUM_HANDLE_BATCH
+    Handles - Supplies an array of handles to close
+    Statuses - Optionally receives the close status of each handle
+Return Value:
+    STATUS_SUCCESS if every handle was closed, otherwise the status of the first handle that could not be closed.
+    All handles are attempted regardless of earlier failures.
+*/
+{
+    KPROCESSOR_MODE PreviousMode;
+    HANDLE CapturedHandles[OBP_HANDLE_BATCH];
+    NTSTATUS CapturedStatuses[OBP_HANDLE_BATCH];
+    NTSTATUS Status;
+    ULONG Done, Chunk, Index;
+
+    PAGED_CODE();
+
+    if ((Count == 0) || (Count > MAXIMUM_HANDLE_BATCH)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    PreviousMode = KeGetPreviousMode();
+    if (PreviousMode != KernelMode) {
+        try {
+            ProbeForRead(Handles, Count * sizeof(HANDLE), sizeof(HANDLE));
+            if (ARGUMENT_PRESENT(Statuses)) {
+                ProbeForWrite(Statuses, Count * sizeof(NTSTATUS), sizeof(NTSTATUS));
+            }
+        } except(EXCEPTION_EXECUTE_HANDLER)
+        {
+            return GetExceptionCode();
+        }
+    }
+
+    //  Capture and close the handles a batch at a time
+    Status = STATUS_SUCCESS;
+    for (Done = 0; Done < Count; Done += Chunk) {
+        Chunk = Count - Done;
+        if (Chunk > OBP_HANDLE_BATCH) {
+            Chunk = OBP_HANDLE_BATCH;
+        }
+
+        try {
+            RtlCopyMemory(CapturedHandles, &Handles[Done], Chunk * sizeof(HANDLE));
+        } except(EXCEPTION_EXECUTE_HANDLER)
+        {
+            return GetExceptionCode();
+        }
+
+        ObpCloseHandles(Chunk, CapturedHandles, CapturedStatuses, PreviousMode);
+        for (Index = 0; Index < Chunk; Index += 1) {
+            if (NT_SUCCESS(Status) && !NT_SUCCESS(CapturedStatuses[Index])) {
+                Status = CapturedStatuses[Index];
+            }
+        }
+
+        if (ARGUMENT_PRESENT(Statuses)) {
+            try {
+                RtlCopyMemory(&Statuses[Done], CapturedStatuses, Chunk * sizeof(NTSTATUS));
+            } except(EXCEPTION_EXECUTE_HANDLER)
+            {
+                //  Fall through, since we cannot undo the closes we have done.
+            }
+        }
+    }
+
+    return Status;
+}
+
+
 NTSTATUS NtMakeTemporaryObject(__in HANDLE Handle)
 /*
 Routine Description:
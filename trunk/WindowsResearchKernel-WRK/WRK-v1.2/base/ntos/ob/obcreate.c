@@ -635,6 +635,8 @@ NTSTATUS ObpAllocateObject(
         if (ObjectType->TotalNumberOfObjects > ObjectType->HighWaterNumberOfObjects) {
             ObjectType->HighWaterNumberOfObjects = ObjectType->TotalNumberOfObjects;
         }
+
+        ObpIncrementTypeStatistic(ObjectType, Creates);
     }
 
 #if DBG
@@ -711,6 +713,7 @@ Arguments:
 
     //  Decrement the number of objects of this type
     InterlockedDecrement((PLONG)&ObjectType->TotalNumberOfObjects);
+    ObpIncrementTypeStatistic(ObjectType, Deletes);
 
     //  Check where we were in the object initialization phase.
     //  This flag really only tests if we have charged quota for this object.
@@ -26,6 +26,17 @@ VOID ObpReleaseExclusiveNameLock(IN POBJECT_HEADER ObjectHeader);
 POBJECT_DIRECTORY_ENTRY ObpUnlinkDirectoryEntry(IN POBJECT_DIRECTORY Directory, IN ULONG HashIndex);
 VOID ObpLinkDirectoryEntry(IN POBJECT_DIRECTORY Directory, IN ULONG HashIndex, IN POBJECT_DIRECTORY_ENTRY NewDirectoryEntry);
 VOID ObpReleaseLookupContextObject(IN POBP_LOOKUP_CONTEXT LookupContext);
+NTSTATUS ObpLookupObjectNameWorker(IN HANDLE RootDirectoryHandle OPTIONAL,
+                                   IN PUNICODE_STRING ObjectName,
+                                   IN ULONG Attributes,
+                                   IN POBJECT_TYPE ObjectType,
+                                   IN KPROCESSOR_MODE AccessMode,
+                                   IN PVOID ParseContext OPTIONAL,
+                                   IN PSECURITY_QUALITY_OF_SERVICE SecurityQos OPTIONAL,
+                                   IN PVOID InsertObject OPTIONAL,
+                                   IN OUT PACCESS_STATE AccessState,
+                                   OUT POBP_LOOKUP_CONTEXT LookupContext,
+                                   OUT PVOID* FoundObject);
 
 #if defined(ALLOC_PRAGMA)
 #pragma alloc_text(PAGE,NtCreateDirectoryObject)
@@ -35,6 +46,7 @@ VOID ObpReleaseLookupContextObject(IN POBP_LOOKUP_CONTEXT LookupContext);
 #pragma alloc_text(PAGE,ObpInsertDirectoryEntry)
 #pragma alloc_text(PAGE,ObpDeleteDirectoryEntry)
 #pragma alloc_text(PAGE,ObpLookupObjectName)
+#pragma alloc_text(PAGE,ObpLookupObjectNameWorker)
 #pragma alloc_text(PAGE,NtMakePermanentObject)
 
 #ifdef OBP_PAGEDPOOL_NAMESPACE
@@ -998,6 +1010,81 @@ NTSTATUS ObpLookupObjectName(IN HANDLE RootDirectoryHandle OPTIONAL,
                              OUT PVOID* FoundObject
 )
 /*
+Routine Description:
+    This function will search a given directoroy for a specified object name.
+    It will also create a new object specified by InsertObject.
+
+    The lookup itself is done by ObpLookupObjectNameWorker.
+    This routine times it and charges the lookup to the type of the object found, or to the requested type if nothing was found.
+    Lookups that take longer than OBP_SLOW_LOOKUP_CYCLES are traced when the PERF_OBJECTS group is enabled.
+Arguments:
+    See ObpLookupObjectNameWorker.
+Return Value:
+    An appropriate status value.
+    N.B. If the status returned is SUCCESS the caller has the responsibility to release the lookup context
+*/
+{
+    NTSTATUS Status;
+    LONGLONG StartTime;
+    ULONGLONG ElapsedTime;
+    POBJECT_TYPE StatisticsType;
+    POBP_TYPE_STATISTICS Statistics;
+    PERFINFO_OB_LOOKUP_INFORMATION LookupInformation;
+
+    StartTime = PerfGetCycleCount();
+    Status = ObpLookupObjectNameWorker(RootDirectoryHandle,
+                                       ObjectName,
+                                       Attributes,
+                                       ObjectType,
+                                       AccessMode,
+                                       ParseContext,
+                                       SecurityQos,
+                                       InsertObject,
+                                       AccessState,
+                                       LookupContext,
+                                       FoundObject);
+    ElapsedTime = (ULONGLONG)(PerfGetCycleCount() - StartTime);
+
+    StatisticsType = ObjectType;
+    if (NT_SUCCESS(Status) && (*FoundObject != NULL)) {
+        StatisticsType = OBJECT_TO_OBJECT_HEADER(*FoundObject)->Type;
+    }
+
+    if (StatisticsType != NULL) {
+        Statistics = ObpGetTypeStatistics(StatisticsType);
+        if (Statistics != NULL) {
+            InterlockedIncrement((PLONG)&Statistics->Lookups);
+            ExInterlockedAddLargeStatistic(&Statistics->LookupCycles, (ULONG)ElapsedTime);
+            if (ElapsedTime >= OBP_SLOW_LOOKUP_CYCLES) {
+                InterlockedIncrement((PLONG)&Statistics->SlowLookups);
+            }
+        }
+    }
+
+    if ((ElapsedTime >= OBP_SLOW_LOOKUP_CYCLES) && PERFINFO_IS_GROUP_ON(PERF_OBJECTS)) {
+        LookupInformation.ElapsedCycles = ElapsedTime;
+        LookupInformation.ObjectType = StatisticsType;
+        LookupInformation.Status = Status;
+        PerfInfoLogBytesAndUnicodeString(PERFINFO_LOG_TYPE_OB_SLOW_LOOKUP, &LookupInformation, sizeof(LookupInformation), ObjectName);
+    }
+
+    return Status;
+}
+
+
+NTSTATUS ObpLookupObjectNameWorker(IN HANDLE RootDirectoryHandle OPTIONAL,
+                                   IN PUNICODE_STRING ObjectName,
+                                   IN ULONG Attributes,
+                                   IN POBJECT_TYPE ObjectType,
+                                   IN KPROCESSOR_MODE AccessMode,
+                                   IN PVOID ParseContext OPTIONAL,
+                                   IN PSECURITY_QUALITY_OF_SERVICE SecurityQos OPTIONAL,
+                                   IN PVOID InsertObject OPTIONAL,
+                                   IN OUT PACCESS_STATE AccessState,
+                                   OUT POBP_LOOKUP_CONTEXT LookupContext,
+                                   OUT PVOID* FoundObject
+)
+/*
 Routine Description:
     This function will search a given directoroy for a specified object name.
     It will also create a new object specified by InsertObject.
@@ -41,9 +41,24 @@ NTSTATUS ObpCaptureHandleInformationEx(
 USHORT ObpComputeGrantedAccessIndex(ACCESS_MASK GrantedAccess);
 ACCESS_MASK ObpTranslateGrantedAccessIndex(USHORT GrantedAccessIndex);
 USHORT RtlLogUmodeStackBackTrace(VOID);
+NTSTATUS ObpDuplicateReferencedObject(
+    IN PEPROCESS SourceProcess,
+    IN HANDLE SourceHandle,
+    IN PVOID SourceObject,
+    IN POBJECT_HANDLE_INFORMATION HandleInformation,
+    IN ACCESS_MASK AuditMask,
+    IN PEPROCESS TargetProcess,
+    IN PHANDLE_TABLE TargetObjectTable,
+    OUT PHANDLE TargetHandle,
+    IN ACCESS_MASK DesiredAccess,
+    IN ULONG HandleAttributes,
+    IN ULONG Options,
+    IN KPROCESSOR_MODE PreviousMode
+);
 
 #ifdef ALLOC_PRAGMA
 #pragma alloc_text(PAGE,NtDuplicateObject)
+#pragma alloc_text(PAGE,NtDuplicateObjects)
 #pragma alloc_text(PAGE,ObGetHandleInformation)
 #pragma alloc_text(PAGE,ObGetHandleInformationEx)
 #pragma alloc_text(PAGE,ObpCaptureHandleInformation)
@@ -58,6 +73,7 @@ USHORT RtlLogUmodeStackBackTrace(VOID);
 #pragma alloc_text(PAGE,ObpCreateUnnamedHandle)
 #pragma alloc_text(PAGE,ObpValidateDesiredAccess)
 #pragma alloc_text(PAGE,ObDuplicateObject)
+#pragma alloc_text(PAGE,ObpDuplicateReferencedObject)
 #pragma alloc_text(PAGE,ObReferenceProcessHandleTable)
 #pragma alloc_text(PAGE,ObDereferenceProcessHandleTable)
 #pragma alloc_text(PAGE,ObpComputeGrantedAccessIndex)
@@ -130,11 +146,15 @@ Return Value:
 }
 
 
-NTSTATUS ObDuplicateObject(
+NTSTATUS ObpDuplicateReferencedObject(
     IN PEPROCESS SourceProcess,
     IN HANDLE SourceHandle,
-    IN PEPROCESS TargetProcess OPTIONAL,
-    OUT PHANDLE TargetHandle OPTIONAL,
+    IN PVOID SourceObject,
+    IN POBJECT_HANDLE_INFORMATION HandleInformation,
+    IN ACCESS_MASK AuditMask,
+    IN PEPROCESS TargetProcess,
+    IN PHANDLE_TABLE TargetObjectTable,
+    OUT PHANDLE TargetHandle,
     IN ACCESS_MASK DesiredAccess,
     IN ULONG HandleAttributes,
     IN ULONG Options,
@@ -142,125 +162,49 @@ NTSTATUS ObDuplicateObject(
 )
 /*
 Routine Description:
-    This function creates a handle that is a duplicate of the specified source handle.
-    The source handle is evaluated in the context of the specified source process.
-    The calling process must have PROCESS_DUP_HANDLE access to the source process.
-    The duplicate handle is created with the specified attributes and desired access.
-    The duplicate handle is created in the handle table of the specified target process.
-    The calling process must have PROCESS_DUP_HANDLE access to the target process.
+    This function creates a handle in the target process for an object that has already been referenced from the source handle.
+    The caller must be attached to the target process and hold references to the handle tables of both processes.
+    Closing the source handle for DUPLICATE_CLOSE_SOURCE is left to the caller.
 Arguments:
     SourceProcess - Supplies a pointer to the source process for the handle being duplicated
     SourceHandle - Supplies the handle being duplicated
-    TargetProcess - Optionally supplies a pointer to the target process that is to receive the new handle
-    TargetHandle - Optionally returns a the new duplicated handle
+    SourceObject - Supplies the referenced object. The reference is consumed by this routine.
+    HandleInformation - Supplies the granted access and attributes of the source handle
+    AuditMask - Supplies the audit mask of the source handle
+    TargetProcess - Supplies a pointer to the target process that is to receive the new handle
+    TargetObjectTable - Supplies the referenced handle table of the target process
+    TargetHandle - Returns the new duplicated handle, or NULL on failure
     DesiredAccess - Desired access for the new handle
     HandleAttributes - Desired attributes for the new handle
-    Options - Duplication options that control things like close source, same access, and same attributes.
+    Options - Duplication options that control things like same access, and same attributes.
     PreviousMode - Mode of caller
 Return Value:
     NTSTATUS - Status pf call
 */
 {
     NTSTATUS Status;
-    PVOID SourceObject;
     POBJECT_HEADER ObjectHeader;
     POBJECT_TYPE ObjectType;
-    BOOLEAN Attached;
-    PHANDLE_TABLE SourceObjectTable, TargetObjectTable;
     HANDLE_TABLE_ENTRY ObjectTableEntry;
-    OBJECT_HANDLE_INFORMATION HandleInformation;
     HANDLE NewHandle;
     ACCESS_STATE AccessState;
     AUX_ACCESS_DATA AuxData;
     ACCESS_MASK SourceAccess;
     ACCESS_MASK TargetAccess;
-    ACCESS_MASK AuditMask = (ACCESS_MASK)0;
     PACCESS_STATE PassedAccessState = NULL;
     HANDLE_TABLE_ENTRY_INFO ObjectInfo;
-    KAPC_STATE ApcState;
-
-    if (ARGUMENT_PRESENT(TargetHandle)) {
-        *TargetHandle = NULL;
-    }
-
-    //  If the caller is not asking for the same access then validate the access they are requesting doesn't contain any bad bits
-    if (!(Options & DUPLICATE_SAME_ACCESS)) {
-        Status = ObpValidateDesiredAccess(DesiredAccess);
-        if (!NT_SUCCESS(Status)) {
-            return(Status);
-        }
-    }
-
-    Attached = FALSE;//  The Attached variable indicates if we needed to attach to the source process because it was not the current process.
-
-    //  Lock down access to the process object tables
-    SourceObjectTable = ObReferenceProcessHandleTable(SourceProcess);
-    if (SourceObjectTable == NULL) {//  Make sure the source process has an object table still
-        return STATUS_PROCESS_IS_TERMINATING;
-    }
-
-    //  The the input source handle get a pointer to the source object itself, 
-    //  then detach from the process if necessary and check if we were given a good source handle.
-    Status = ObpReferenceProcessObjectByHandle(SourceHandle, SourceProcess, SourceObjectTable, PreviousMode, &SourceObject, &HandleInformation, &AuditMask);
-    if (NT_SUCCESS(Status)) {
-        if ((HandleInformation.HandleAttributes & OBJ_AUDIT_OBJECT_CLOSE) == 0) {
-            AuditMask = 0;
-        }
-    }
-
-    if (!NT_SUCCESS(Status)) {
-        ObDereferenceProcessHandleTable(SourceProcess);
-        return(Status);
-    }
-
-    //  We are all done if no target process handle was specified.
-    //  This is practically a noop because the only really end result could be that we've closed the source handle.
-    if (!ARGUMENT_PRESENT(TargetProcess)) {
-        //  If no TargetProcessHandle, then only possible option is to close the source handle in the context of the source process.
-        if (!(Options & DUPLICATE_CLOSE_SOURCE)) {
-            Status = STATUS_INVALID_PARAMETER;
-        }
-
-        if (Options & DUPLICATE_CLOSE_SOURCE) {
-            KeStackAttachProcess(&SourceProcess->Pcb, &ApcState);
-            NtClose(SourceHandle);
-            KeUnstackDetachProcess(&ApcState);
-        }
-
-        ObDereferenceProcessHandleTable(SourceProcess);
-        ObDereferenceObject(SourceObject);
-        return(Status);
-    }
-
-    SourceAccess = HandleInformation.GrantedAccess;
-
-    //  Make sure the target process has not exited
-    TargetObjectTable = ObReferenceProcessHandleTable(TargetProcess);
-    if (TargetObjectTable == NULL) {
-        if (Options & DUPLICATE_CLOSE_SOURCE) {
-            KeStackAttachProcess(&SourceProcess->Pcb, &ApcState);
-            NtClose(SourceHandle);
-            KeUnstackDetachProcess(&ApcState);
-        }
 
-        ObDereferenceProcessHandleTable(SourceProcess);
-        ObDereferenceObject(SourceObject);
-        return STATUS_PROCESS_IS_TERMINATING;
-    }
-
-    if (PsGetCurrentProcess() != TargetProcess) {//  If the specified target process is not the current process, attach to the specified target process.
-        KeStackAttachProcess(&TargetProcess->Pcb, &ApcState);
-        Attached = TRUE;
-    }
+    *TargetHandle = NULL;
+    SourceAccess = HandleInformation->GrantedAccess;
 
     if (Options & DUPLICATE_SAME_ACCESS) {//  Construct the proper desired access and attributes for the new handle
         DesiredAccess = SourceAccess;
     }
 
     if (Options & DUPLICATE_SAME_ATTRIBUTES) {
-        HandleAttributes = HandleInformation.HandleAttributes;
+        HandleAttributes = HandleInformation->HandleAttributes;
     } else {//  Always propagate auditing information.        
-        HandleAttributes |= HandleInformation.HandleAttributes & OBJ_AUDIT_OBJECT_CLOSE;
+        HandleAttributes |= HandleInformation->HandleAttributes & OBJ_AUDIT_OBJECT_CLOSE;
     }
 
     //  Get the object header for the source object
@@ -304,24 +248,11 @@ Return Value:
                                          SourceObject, ObjectType, PassedAccessState, PreviousMode, HandleAttributes);
     }
 
-    if (Attached) {
-        KeUnstackDetachProcess(&ApcState);
-        Attached = FALSE;
-    }
-
-    if (Options & DUPLICATE_CLOSE_SOURCE) {
-        KeStackAttachProcess(&SourceProcess->Pcb, &ApcState);
-        NtClose(SourceHandle);
-        KeUnstackDetachProcess(&ApcState);
-    }
-
     if (!NT_SUCCESS(Status)) {
         if (PassedAccessState != NULL) {
             SeDeleteAccessState(PassedAccessState);
         }
 
-        ObDereferenceProcessHandleTable(SourceProcess);
-        ObDereferenceProcessHandleTable(TargetProcess);
         ObDereferenceObject(SourceObject);
         return(Status);
     }
@@ -400,14 +331,157 @@ Return Value:
         Status = STATUS_INSUFFICIENT_RESOURCES;
     }
 
-    if (ARGUMENT_PRESENT(TargetHandle)) {
-        *TargetHandle = NewHandle;
-    }
+    *TargetHandle = NewHandle;
 
     //  Cleanup from our selfs and then return to our caller
     if (PassedAccessState != NULL) {
         SeDeleteAccessState(PassedAccessState);
     }
+
+    return(Status);
+}
+
+
+NTSTATUS ObDuplicateObject(
+    IN PEPROCESS SourceProcess,
+    IN HANDLE SourceHandle,
+    IN PEPROCESS TargetProcess OPTIONAL,
+    OUT PHANDLE TargetHandle OPTIONAL,
+    IN ACCESS_MASK DesiredAccess,
+    IN ULONG HandleAttributes,
+    IN ULONG Options,
+    IN KPROCESSOR_MODE PreviousMode
+)
+/*
+Routine Description:
+    This function creates a handle that is a duplicate of the specified source handle.
+    The source handle is evaluated in the context of the specified source process.
+    The calling process must have PROCESS_DUP_HANDLE access to the source process.
+    The duplicate handle is created with the specified attributes and desired access.
+    The duplicate handle is created in the handle table of the specified target process.
+    The calling process must have PROCESS_DUP_HANDLE access to the target process.
+Arguments:
+    SourceProcess - Supplies a pointer to the source process for the handle being duplicated
+    SourceHandle - Supplies the handle being duplicated
+    TargetProcess - Optionally supplies a pointer to the target process that is to receive the new handle
+    TargetHandle - Optionally returns a the new duplicated handle
+    DesiredAccess - Desired access for the new handle
+    HandleAttributes - Desired attributes for the new handle
+    Options - Duplication options that control things like close source, same access, and same attributes.
+    PreviousMode - Mode of caller
+Return Value:
+    NTSTATUS - Status pf call
+*/
+{
+    NTSTATUS Status;
+    PVOID SourceObject;
+    BOOLEAN Attached;
+    PHANDLE_TABLE SourceObjectTable, TargetObjectTable;
+    OBJECT_HANDLE_INFORMATION HandleInformation;
+    HANDLE NewHandle;
+    ACCESS_MASK AuditMask = (ACCESS_MASK)0;
+    KAPC_STATE ApcState;
+
+    if (ARGUMENT_PRESENT(TargetHandle)) {
+        *TargetHandle = NULL;
+    }
+
+    //  If the caller is not asking for the same access then validate the access they are requesting doesn't contain any bad bits
+    if (!(Options & DUPLICATE_SAME_ACCESS)) {
+        Status = ObpValidateDesiredAccess(DesiredAccess);
+        if (!NT_SUCCESS(Status)) {
+            return(Status);
+        }
+    }
+
+    Attached = FALSE;//  The Attached variable indicates if we needed to attach to the source process because it was not the current process.
+
+    //  Lock down access to the process object tables
+    SourceObjectTable = ObReferenceProcessHandleTable(SourceProcess);
+    if (SourceObjectTable == NULL) {//  Make sure the source process has an object table still
+        return STATUS_PROCESS_IS_TERMINATING;
+    }
+
+    //  The the input source handle get a pointer to the source object itself, 
+    //  then detach from the process if necessary and check if we were given a good source handle.
+    Status = ObpReferenceProcessObjectByHandle(SourceHandle, SourceProcess, SourceObjectTable, PreviousMode, &SourceObject, &HandleInformation, &AuditMask);
+    if (NT_SUCCESS(Status)) {
+        if ((HandleInformation.HandleAttributes & OBJ_AUDIT_OBJECT_CLOSE) == 0) {
+            AuditMask = 0;
+        }
+    }
+
+    if (!NT_SUCCESS(Status)) {
+        ObDereferenceProcessHandleTable(SourceProcess);
+        return(Status);
+    }
+
+    //  We are all done if no target process handle was specified.
+    //  This is practically a noop because the only really end result could be that we've closed the source handle.
+    if (!ARGUMENT_PRESENT(TargetProcess)) {
+        //  If no TargetProcessHandle, then only possible option is to close the source handle in the context of the source process.
+        if (!(Options & DUPLICATE_CLOSE_SOURCE)) {
+            Status = STATUS_INVALID_PARAMETER;
+        }
+
+        if (Options & DUPLICATE_CLOSE_SOURCE) {
+            KeStackAttachProcess(&SourceProcess->Pcb, &ApcState);
+            NtClose(SourceHandle);
+            KeUnstackDetachProcess(&ApcState);
+        }
+
+        ObDereferenceProcessHandleTable(SourceProcess);
+        ObDereferenceObject(SourceObject);
+        return(Status);
+    }
+
+    //  Make sure the target process has not exited
+    TargetObjectTable = ObReferenceProcessHandleTable(TargetProcess);
+    if (TargetObjectTable == NULL) {
+        if (Options & DUPLICATE_CLOSE_SOURCE) {
+            KeStackAttachProcess(&SourceProcess->Pcb, &ApcState);
+            NtClose(SourceHandle);
+            KeUnstackDetachProcess(&ApcState);
+        }
+
+        ObDereferenceProcessHandleTable(SourceProcess);
+        ObDereferenceObject(SourceObject);
+        return STATUS_PROCESS_IS_TERMINATING;
+    }
+
+    if (PsGetCurrentProcess() != TargetProcess) {//  If the specified target process is not the current process, attach to the specified target process.
+        KeStackAttachProcess(&TargetProcess->Pcb, &ApcState);
+        Attached = TRUE;
+    }
+
+    Status = ObpDuplicateReferencedObject(SourceProcess,
+                                          SourceHandle,
+                                          SourceObject,
+                                          &HandleInformation,
+                                          AuditMask,
+                                          TargetProcess,
+                                          TargetObjectTable,
+                                          &NewHandle,
+                                          DesiredAccess,
+                                          HandleAttributes,
+                                          Options,
+                                          PreviousMode);
+
+    if (Attached) {
+        KeUnstackDetachProcess(&ApcState);
+        Attached = FALSE;
+    }
+
+    if (Options & DUPLICATE_CLOSE_SOURCE) {
+        KeStackAttachProcess(&SourceProcess->Pcb, &ApcState);
+        NtClose(SourceHandle);
+        KeUnstackDetachProcess(&ApcState);
+    }
+
+    if (ARGUMENT_PRESENT(TargetHandle)) {
+        *TargetHandle = NewHandle;
+    }
+
     ObDereferenceProcessHandleTable(SourceProcess);
     ObDereferenceProcessHandleTable(TargetProcess);
     return(Status);
@@ -503,6 +577,208 @@ Arguments:
     return(Status);
 }
 
+NTSTATUS NtDuplicateObjects(
+    __in HANDLE SourceProcessHandle,
+    __in ULONG Count,
+    __in_ecount(Count) PHANDLE SourceHandles,
+    __in HANDLE TargetProcessHandle,
+    __out_ecount(Count) PHANDLE TargetHandles,
+    __in ACCESS_MASK DesiredAccess,
+    __in ULONG HandleAttributes,
+    __in ULONG Options
+)
+/*
+Routine Description:
+    This function duplicates a set of handles from a source process into a target process with a single system call.
+    Each handle is duplicated as NtDuplicateObject would, but both processes are referenced once for the whole set
+    and the target process is attached once per batch of handles rather than once per handle.
+Arguments:
+    SourceProcessHandle - Supplies a handle to the source process for the handles being duplicated
+    Count - Supplies the number of handles to duplicate, at most MAXIMUM_HANDLE_BATCH
+    SourceHandles - Supplies the handles being duplicated
+    TargetProcessHandle - Supplies a handle to the target process that is to receive the new handles
+    TargetHandles - Returns the new duplicated handles. Entries for handles that could not be duplicated are set to NULL.
+    DesiredAccess - Desired access for the new handles
+    HandleAttributes - Desired attributes for the new handles
+    Options - Duplication options that control things like close source, same access, and same attributes.
+Return Value:
+    STATUS_SUCCESS if every handle was duplicated, otherwise the status of the first handle that could not be duplicated.
+    All handles are attempted regardless of earlier failures.
+*/
+{
+    KPROCESSOR_MODE PreviousMode;
+    NTSTATUS Status, Status1;
+    PEPROCESS SourceProcess;
+    PEPROCESS TargetProcess;
+    PHANDLE_TABLE SourceObjectTable, TargetObjectTable;
+    HANDLE CapturedHandles[OBP_HANDLE_BATCH];
+    HANDLE NewHandles[OBP_HANDLE_BATCH];
+    PVOID SourceObjects[OBP_HANDLE_BATCH];
+    OBJECT_HANDLE_INFORMATION HandleInformation[OBP_HANDLE_BATCH];
+    union {//  The audit masks are consumed by the duplicates before the source handles are closed
+        ACCESS_MASK AuditMasks[OBP_HANDLE_BATCH];
+        NTSTATUS CloseStatuses[OBP_HANDLE_BATCH];
+    };
+    ULONG Done, Chunk, Index, CloseCount;
+    BOOLEAN Attached;
+    KAPC_STATE ApcState;
+
+    PAGED_CODE();
+
+    if ((Count == 0) || (Count > MAXIMUM_HANDLE_BATCH)) {
+        return STATUS_INVALID_PARAMETER;
+    }
+
+    //  Get previous processor mode and probe the handle arrays if necessary.
+    PreviousMode = KeGetPreviousMode();
+    if (PreviousMode != KernelMode) {
+        try {
+            ProbeForRead(SourceHandles, Count * sizeof(HANDLE), sizeof(HANDLE));
+            ProbeForWrite(TargetHandles, Count * sizeof(HANDLE), sizeof(HANDLE));
+        } except(EXCEPTION_EXECUTE_HANDLER)
+        {
+            return(GetExceptionCode());
+        }
+    }
+
+    //  If the caller is not asking for the same access then validate the access they are requesting doesn't contain any bad bits
+    if (!(Options & DUPLICATE_SAME_ACCESS)) {
+        Status = ObpValidateDesiredAccess(DesiredAccess);
+        if (!NT_SUCCESS(Status)) {
+            return(Status);
+        }
+    }
+
+    //  Reference both processes and their handle tables once for the whole set.
+    //  Unlike NtDuplicateObject a bad target process fails the call before any source handle is closed.
+    Status = ObReferenceObjectByHandle(SourceProcessHandle, PROCESS_DUP_HANDLE, PsProcessType, PreviousMode, (PVOID *)&SourceProcess, NULL);
+    if (!NT_SUCCESS(Status)) {
+        return Status;
+    }
+
+    Status = ObReferenceObjectByHandle(TargetProcessHandle, PROCESS_DUP_HANDLE, PsProcessType, PreviousMode, (PVOID *)&TargetProcess, NULL);
+    if (!NT_SUCCESS(Status)) {
+        ObDereferenceObject(SourceProcess);
+        return Status;
+    }
+
+    SourceObjectTable = ObReferenceProcessHandleTable(SourceProcess);
+    TargetObjectTable = ObReferenceProcessHandleTable(TargetProcess);
+    if ((SourceObjectTable == NULL) || (TargetObjectTable == NULL)) {
+        if (SourceObjectTable != NULL) {
+            ObDereferenceProcessHandleTable(SourceProcess);
+        }
+
+        if (TargetObjectTable != NULL) {
+            ObDereferenceProcessHandleTable(TargetProcess);
+        }
+
+        ObDereferenceObject(SourceProcess);
+        ObDereferenceObject(TargetProcess);
+        return STATUS_PROCESS_IS_TERMINATING;
+    }
+
+    Status = STATUS_SUCCESS;
+    for (Done = 0; Done < Count; Done += Chunk) {
+        Chunk = Count - Done;
+        if (Chunk > OBP_HANDLE_BATCH) {
+            Chunk = OBP_HANDLE_BATCH;
+        }
+
+        try {
+            RtlCopyMemory(CapturedHandles, &SourceHandles[Done], Chunk * sizeof(HANDLE));
+        } except(EXCEPTION_EXECUTE_HANDLER)
+        {
+            Status = GetExceptionCode();
+            break;
+        }
+
+        //  Reference the source objects.  This does not require attaching to the source process.
+        for (Index = 0; Index < Chunk; Index += 1) {
+            NewHandles[Index] = NULL;
+            Status1 = ObpReferenceProcessObjectByHandle(CapturedHandles[Index],
+                                                        SourceProcess,
+                                                        SourceObjectTable,
+                                                        PreviousMode,
+                                                        &SourceObjects[Index],
+                                                        &HandleInformation[Index],
+                                                        &AuditMasks[Index]);
+            if (NT_SUCCESS(Status1)) {
+                if ((HandleInformation[Index].HandleAttributes & OBJ_AUDIT_OBJECT_CLOSE) == 0) {
+                    AuditMasks[Index] = 0;
+                }
+            } else {
+                SourceObjects[Index] = NULL;
+                if (NT_SUCCESS(Status)) {
+                    Status = Status1;
+                }
+            }
+        }
+
+        //  Attach to the target process once and create the new handles.  Each duplicate consumes its source object reference.
+        Attached = FALSE;
+        if (PsGetCurrentProcess() != TargetProcess) {
+            KeStackAttachProcess(&TargetProcess->Pcb, &ApcState);
+            Attached = TRUE;
+        }
+
+        for (Index = 0; Index < Chunk; Index += 1) {
+            if (SourceObjects[Index] != NULL) {
+                Status1 = ObpDuplicateReferencedObject(SourceProcess,
+                                                      CapturedHandles[Index],
+                                                      SourceObjects[Index],
+                                                      &HandleInformation[Index],
+                                                      AuditMasks[Index],
+                                                      TargetProcess,
+                                                      TargetObjectTable,
+                                                      &NewHandles[Index],
+                                                      DesiredAccess,
+                                                      HandleAttributes,
+                                                      Options,
+                                                      PreviousMode);
+                if (NT_SUCCESS(Status) && !NT_SUCCESS(Status1)) {
+                    Status = Status1;
+                }
+            }
+        }
+
+        if (Attached) {
+            KeUnstackDetachProcess(&ApcState);
+        }
+
+        //  As with NtDuplicateObject, close every source handle that could be referenced whether or not its duplicate succeeded.
+        if (Options & DUPLICATE_CLOSE_SOURCE) {
+            CloseCount = 0;
+            for (Index = 0; Index < Chunk; Index += 1) {
+                if (SourceObjects[Index] != NULL) {
+                    CapturedHandles[CloseCount] = CapturedHandles[Index];
+                    CloseCount += 1;
+                }
+            }
+
+            if (CloseCount != 0) {
+                KeStackAttachProcess(&SourceProcess->Pcb, &ApcState);
+                ObpCloseHandles(CloseCount, CapturedHandles, CloseStatuses, PreviousMode);
+                KeUnstackDetachProcess(&ApcState);
+            }
+        }
+
+        try {
+            RtlCopyMemory(&TargetHandles[Done], NewHandles, Chunk * sizeof(HANDLE));
+        } except(EXCEPTION_EXECUTE_HANDLER)
+        {
+            //  Fall through, since we cannot undo what we have done.
+        }
+    }
+
+    ObDereferenceProcessHandleTable(SourceProcess);
+    ObDereferenceProcessHandleTable(TargetProcess);
+    ObDereferenceObject(SourceProcess);
+    ObDereferenceObject(TargetProcess);
+    return(Status);
+}
+
+
 
 NTSTATUS ObGetHandleInformation(OUT PSYSTEM_HANDLE_INFORMATION HandleInformation, IN ULONG Length, OUT PULONG ReturnLength OPTIONAL)
 /*
@@ -1052,6 +1328,7 @@ NTSTATUS ObpIncrementHandleCount(
 
         //  Do some simple bookkeeping for the handle counts and then return to our caller
         NewTotal = (ULONG)InterlockedIncrement((PLONG)&ObjectType->TotalNumberOfHandles);
+        ObpIncrementTypeStatistic(ObjectType, HandleOpens);
 
         //  Note: The highwater mark is only for bookkeeping. We can do this w/o lock. In the worst case next time will be updated
         if (NewTotal > ObjectType->HighWaterNumberOfHandles) {
@@ -1204,6 +1481,7 @@ NTSTATUS ObpIncrementUnnamedHandleCount(
 
         //  Do some simple bookkeeping for the handle counts and then return to our caller
         NewTotal = (ULONG)InterlockedIncrement((PLONG)&ObjectType->TotalNumberOfHandles);
+        ObpIncrementTypeStatistic(ObjectType, HandleOpens);
         if (NewTotal > ObjectType->HighWaterNumberOfHandles) {
             ObjectType->HighWaterNumberOfHandles = NewTotal;
         }
@@ -215,8 +215,13 @@ Return Value:
         Prcb->PPLookasideList[LookasideNameBufferList].L = &ObpNameBufferLookasideList;
         Prcb->PPLookasideList[LookasideNameBufferList].P = &ObpNameBufferLookasideList;
 
-        ObpRemoveObjectList = NULL;//  Initialize the object removal queue listhead.
+        for (Index = 0; Index < OBP_MAX_REMOVE_OBJECT_QUEUES; Index += 1) {//  Initialize the object removal queue listheads and their work items.
+            ObpRemoveObjectQueues[Index].ListHead = NULL;
+            ExInitializeWorkItem(&ObpRemoveObjectQueues[Index].WorkItem, ObpProcessRemoveObjectQueue, &ObpRemoveObjectQueues[Index]);
+        }
+
         ObpInitSecurityDescriptorCache();//  Initialize security descriptor cache
+        ObpInitAccessCache();//  Initialize the access check result cache
 
         KeInitializeEvent(&ObpDefaultObject, NotificationEvent, TRUE);
         ExInitializePushLock(&ObpLock);
@@ -238,8 +243,6 @@ Return Value:
         ExSetHandleTableStrictFIFO(ObpKernelHandleTable);// On checked make handle reuse take much longer
 #endif
 
-        ExInitializeWorkItem(&ObpRemoveObjectWorkItem, ObpProcessRemoveObjectQueue, NULL);// Initialize the deferred delete work item.
-
         //  Create an object type for the "Type" object.  This is the start of of the object types and goes in the ObpTypeDirectoryObject.
         RtlZeroMemory(&ObjectTypeInitializer, sizeof(ObjectTypeInitializer));
         ObjectTypeInitializer.Length = sizeof(ObjectTypeInitializer);
@@ -688,7 +691,7 @@ Arguments:
     POBP_SWEEP_CONTEXT SweepContext;
 
     SweepContext = EnumParameter;
-    ObpCloseHandleTableEntry(SweepContext->HandleTable, HandleTableEntry, Handle, SweepContext->PreviousMode, TRUE);
+    ObpCloseHandleTableEntry(SweepContext->HandleTable, HandleTableEntry, Handle, SweepContext->PreviousMode, TRUE, NULL);
     return TRUE;
 }
 
@@ -78,8 +78,19 @@ struct _OBJECT_BODY_HEADER;
 EX_PUSH_LOCK ObpLock;
 
 KEVENT ObpDefaultObject;
-WORK_QUEUE_ITEM ObpRemoveObjectWorkItem;
-PVOID ObpRemoveObjectList;
+
+//  Objects whose last reference is dropped at raised IRQL are pushed onto one of several deferred delete queues.
+//  The queue is selected by the current processor so that teardown on many processors does not funnel through a single list head,
+//  and each queue has its own work item so that the deletions are spread over several worker threads.
+#define OBP_MAX_REMOVE_OBJECT_QUEUES 8
+#define OBP_REMOVE_OBJECT_BATCH      32//  Maximum number of objects of one type unlinked under a single type mutex acquisition
+
+typedef struct DECLSPEC_CACHEALIGN _OBP_REMOVE_OBJECT_QUEUE {
+    PVOID ListHead;
+    WORK_QUEUE_ITEM WorkItem;
+} OBP_REMOVE_OBJECT_QUEUE, *POBP_REMOVE_OBJECT_QUEUE;
+
+OBP_REMOVE_OBJECT_QUEUE ObpRemoveObjectQueues[OBP_MAX_REMOVE_OBJECT_QUEUES];
 
 //  This global lock is used to protect the device map tear down and build up
 //  We can no longer use an individual lock in the device map itself because that wasn't sufficient to protect the device map itself.
@@ -170,6 +181,38 @@ extern BOOLEAN ObpTraceEnabled;
 #define OBP_MAX_DEFINED_OBJECT_TYPES 48
 POBJECT_TYPE ObpObjectTypes[OBP_MAX_DEFINED_OBJECT_TYPES];
 
+//  Per type activity counters, indexed like the object types table.
+//  Each type has several cache aligned counter blocks and an update goes to the block selected by the current processor,
+//  so that a busy type does not bounce one cache line between processors. A query sums the blocks of a type.
+#define OBP_TYPE_STATISTICS_SLOTS 8
+#define OBP_SLOW_LOOKUP_CYCLES    0x100000//  Name lookups taking at least this many cycles are traced under PERF_OBJECTS
+
+typedef struct DECLSPEC_CACHEALIGN _OBP_TYPE_STATISTICS {
+    ULONG Creates;
+    ULONG Deletes;
+    ULONG HandleOpens;
+    ULONG Lookups;
+    ULONG SlowLookups;
+    LARGE_INTEGER LookupCycles;
+} OBP_TYPE_STATISTICS, *POBP_TYPE_STATISTICS;
+
+OBP_TYPE_STATISTICS ObpTypeStatistics[OBP_MAX_DEFINED_OBJECT_TYPES][OBP_TYPE_STATISTICS_SLOTS];
+
+//  Types past the end of the object types table are not tracked and yield NULL
+#define ObpGetTypeStatistics(_ObjectType)                                                                  \
+    ((((_ObjectType)->Index - 1) < OBP_MAX_DEFINED_OBJECT_TYPES) ?                                         \
+     &ObpTypeStatistics[(_ObjectType)->Index - 1][KeGetCurrentProcessorNumber() % OBP_TYPE_STATISTICS_SLOTS] : \
+     NULL)
+
+#define ObpIncrementTypeStatistic(_ObjectType, _Field) {                        \
+    POBP_TYPE_STATISTICS _Statistics = ObpGetTypeStatistics(_ObjectType);       \
+    if (_Statistics != NULL) {                                                  \
+        InterlockedIncrement((PLONG)&_Statistics->_Field);                      \
+    }                                                                           \
+}
+
+VOID ObpQueryTypeStatistics(IN POBJECT_TYPE ObjectType, OUT POBJECT_TYPE_STATISTICS_INFORMATION Statistics);
+
 
 //  This is some special purpose code to keep a table of access masks correlated with back traces.
 //  If used these routines replace the GrantedAccess mask in the preceding object table entry with a granted access index and a call back index.
@@ -181,6 +224,10 @@ USHORT ObpMaxCachedGrantedAccessIndex;
 PACCESS_MASK ObpCachedGrantedAccesses;
 #endif // i386
 
+//  Number of handles the bulk close and duplicate services process per handle table pass.
+//  The per batch state lives on the kernel stack next to the access state of handle creation, so keep this small.
+#define OBP_HANDLE_BATCH 16
+
 //  The three low order bits of the object table entry are used for handle attributes.
 
 extern ULONG ObpAccessProtectCloseBit;//  We moved the PROTECT_CLOSE in the granted access mask
@@ -222,9 +269,8 @@ typedef struct _SECURITY_DESCRIPTOR_HEADER {
     LIST_ENTRY Link;
     ULONG  RefCount;
     ULONG  FullHash;
-#if defined (_WIN64)
-    PVOID  Spare;   // Align to 16 byte boundary.
-#endif
+    ULONG  Length;  // Length of the cached self relative security descriptor
+    ULONG  Sequence;// Distinguishes this entry from earlier entries that lived at the same address. Also aligns to 8 (16 on 64 bit) bytes.
     QUAD   SecurityDescriptor;
 } SECURITY_DESCRIPTOR_HEADER, *PSECURITY_DESCRIPTOR_HEADER;
 
@@ -237,6 +283,28 @@ typedef struct _SECURITY_DESCRIPTOR_HEADER {
 #define SECURITY_DESCRIPTOR_CACHE_ENTRIES    257//  Number of minor hash entries
 
 
+//  Access check result cache.
+
+//  The result of an access check is a function of the effective token, the security descriptor, the object type's generic mapping and the requested access.
+//  Cached security descriptors are immutable so the descriptor is identified by its cache entry address and sequence number,
+//  and a token is identified by its token id and modified id, which changes every time the token is adjusted.
+//  A change to either one therefore simply stops matching the stale entry.
+#define OBP_ACCESS_CACHE_BUCKETS 512//  Must be a power of two
+
+typedef struct DECLSPEC_CACHEALIGN _OBP_ACCESS_CACHE_ENTRY {
+    EX_PUSH_LOCK PushLock;
+    PSECURITY_DESCRIPTOR_HEADER SecurityDescriptor;
+    POBJECT_TYPE ObjectType;
+    ULONG Sequence;
+    ACCESS_MASK DesiredAccess;
+    ACCESS_MASK PreviouslyGrantedAccess;
+    ACCESS_MASK GrantedAccess;
+    NTSTATUS AccessStatus;
+    LUID TokenId;
+    LUID ModifiedId;
+} OBP_ACCESS_CACHE_ENTRY, *POBP_ACCESS_CACHE_ENTRY;
+
+
 //  Lock state signatures
 #define OBP_LOCK_WAITEXCLUSIVE_SIGNATURE    0xAAAA1234
 #define OBP_LOCK_WAITSHARED_SIGNATURE       0xBBBB1234
@@ -405,6 +473,7 @@ VOID FASTCALL ObfDereferenceDeviceMap(IN PDEVICE_MAP DeviceMap);
 //  Internal entry points defined in obref.c
 VOID ObpDeleteNameCheck(IN PVOID Object);
 VOID ObpProcessRemoveObjectQueue(PVOID Parameter);
+VOID ObpRemoveObjectsFromTypeList(IN POBJECT_HEADER *ObjectHeaders, IN ULONG Count);
 VOID ObpRemoveObjectRoutine(IN  PVOID   Object, IN  BOOLEAN CalledOnWorkerThread);
 
 //  Internal entry points defined in obhandle.c
@@ -472,13 +541,17 @@ PSECURITY_DESCRIPTOR ObpReferenceSecurityDescriptor(POBJECT_HEADER ObjectHeader)
 PVOID ObpDestroySecurityDescriptorHeader(IN PSECURITY_DESCRIPTOR_HEADER Header);
 BOOLEAN ObpCompareSecurityDescriptors(IN PSECURITY_DESCRIPTOR SD1, ULONG Length, IN PSECURITY_DESCRIPTOR SD2);
 NTSTATUS ObpValidateAccessMask(PACCESS_STATE AccessState);
+VOID ObpInitAccessCache(VOID);
 NTSTATUS ObpCloseHandleTableEntry(
     IN PHANDLE_TABLE ObjectTable,
     IN PHANDLE_TABLE_ENTRY ObjectTableEntry,
     IN HANDLE Handle,
     IN KPROCESSOR_MODE PreviousMode,
-    IN BOOLEAN Rundown);
+    IN BOOLEAN Rundown,
+    OUT PVOID *DeferredObject OPTIONAL);
 NTSTATUS ObpCloseHandle(IN HANDLE Handle, IN KPROCESSOR_MODE PreviousMode);
+VOID ObpCloseHandles(IN ULONG Count, IN PHANDLE Handles, OUT PNTSTATUS Statuses, IN KPROCESSOR_MODE PreviousMode);
+VOID ObpDereferenceObjectBatch(IN PVOID *Objects, IN ULONG Count);
 VOID ObpDeleteObjectType(IN  PVOID   Object);
 VOID ObpAuditObjectAccess(IN HANDLE Handle, IN PHANDLE_TABLE_ENTRY_INFO ObjectTableEntryInfo, IN PUNICODE_STRING ObjectTypeName, IN ACCESS_MASK DesiredAccess);
 NTSTATUS ObpQueryNameString(IN PVOID Object, OUT POBJECT_NAME_INFORMATION ObjectNameInfo, IN ULONG Length, OUT PULONG ReturnLength, IN KPROCESSOR_MODE Mode);
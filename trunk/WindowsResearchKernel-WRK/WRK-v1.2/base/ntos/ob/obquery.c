@@ -30,6 +30,7 @@ BOOLEAN ObpSetHandleAttributes(IN OUT PVOID TableEntry, IN ULONG_PTR Parameter);
 #pragma alloc_text(PAGE, ObQueryNameString)
 #pragma alloc_text(PAGE, ObQueryTypeName)
 #pragma alloc_text(PAGE, ObQueryTypeInfo)
+#pragma alloc_text(PAGE, ObpQueryTypeStatistics)
 #pragma alloc_text(PAGE, ObQueryObjectAuditingByHandle)
 #pragma alloc_text(PAGE, NtSetInformationObject)
 #pragma alloc_text(PAGE, ObpSetHandleAttributes)
@@ -73,6 +74,9 @@ NTSTATUS NtQueryObject(
     OBJECT_BASIC_INFORMATION ObjectBasicInfo;
     POBJECT_TYPES_INFORMATION TypesInformation;
     POBJECT_TYPE_INFORMATION TypeInfo;
+    POBJECT_TYPES_STATISTICS_INFORMATION TypesStatistics;
+    OBJECT_TYPE_STATISTICS_INFORMATION TypeStatistics;
+    ULONG NumberOfTypes;
     ULONG i;
 
     PAGED_CODE();
@@ -102,7 +106,7 @@ NTSTATUS NtQueryObject(
 
     //  If the query is not for types information then we will have to get the object in question.
     //  Otherwise for types information there really isn't an object to grab.
-    if (ObjectInformationClass != ObjectTypesInformation) {
+    if ((ObjectInformationClass != ObjectTypesInformation) && (ObjectInformationClass != ObjectTypesStatisticsInformation)) {
         Status = ObReferenceObjectByHandle(Handle, 0, NULL, PreviousMode, &Object, &HandleInformation);
         if (!NT_SUCCESS(Status)) {
             return(Status);
@@ -302,6 +306,34 @@ NTSTATUS NtQueryObject(
             Status = GetExceptionCode();
         }
 
+        break;
+    case ObjectTypesStatisticsInformation:
+        //  Count the defined types to size the output, then sum the counters of each type into the callers buffer.
+        //  The count is kept locally, since the callers buffer can be changed underneath us.
+        for (NumberOfTypes = 0; NumberOfTypes < OBP_MAX_DEFINED_OBJECT_TYPES; NumberOfTypes++) {
+            if (ObpObjectTypes[NumberOfTypes] == NULL) {
+                break;
+            }
+        }
+
+        TempReturnLength = FIELD_OFFSET(OBJECT_TYPES_STATISTICS_INFORMATION, TypeStatistics) + (NumberOfTypes * sizeof(OBJECT_TYPE_STATISTICS_INFORMATION));
+        if (ObjectInformationLength < TempReturnLength) {
+            Status = STATUS_INFO_LENGTH_MISMATCH;
+            break;
+        }
+
+        try {
+            TypesStatistics = (POBJECT_TYPES_STATISTICS_INFORMATION)ObjectInformation;
+            TypesStatistics->NumberOfTypes = NumberOfTypes;
+            for (i = 0; i < NumberOfTypes; i++) {
+                ObpQueryTypeStatistics(ObpObjectTypes[i], &TypeStatistics);
+                TypesStatistics->TypeStatistics[i] = TypeStatistics;
+            }
+        } except(EXCEPTION_EXECUTE_HANDLER)
+        {
+            Status = GetExceptionCode();
+        }
+
         break;
     default:
         //  To get to this point we must have had an object and the information class is not defined,
@@ -911,6 +943,39 @@ Return Value:
 }
 
 
+VOID ObpQueryTypeStatistics(IN POBJECT_TYPE ObjectType, OUT POBJECT_TYPE_STATISTICS_INFORMATION Statistics)
+/*
+Routine description:
+    This routine sums the per processor activity counters of an object type.
+    The counters are read without synchronization so the totals are only a snapshot.
+Arguments:
+    ObjectType - Supplies the object type being queried
+    Statistics - Receives the summed counters. This must be a kernel buffer.
+*/
+{
+    POBP_TYPE_STATISTICS Slot;
+    ULONG i;
+
+    PAGED_CODE();
+
+    RtlZeroMemory(Statistics, sizeof(*Statistics));
+    Statistics->TypeIndex = ObjectType->Index;
+    if ((ObjectType->Index - 1) >= OBP_MAX_DEFINED_OBJECT_TYPES) {
+        return;
+    }
+
+    for (i = 0; i < OBP_TYPE_STATISTICS_SLOTS; i++) {
+        Slot = &ObpTypeStatistics[ObjectType->Index - 1][i];
+        Statistics->NumberOfCreates += Slot->Creates;
+        Statistics->NumberOfDeletes += Slot->Deletes;
+        Statistics->NumberOfHandleOpens += Slot->HandleOpens;
+        Statistics->NumberOfLookups += Slot->Lookups;
+        Statistics->NumberOfSlowLookups += Slot->SlowLookups;
+        Statistics->LookupCycles += Slot->LookupCycles.QuadPart;
+    }
+}
+
+
 NTSTATUS ObQueryObjectAuditingByHandle(__in HANDLE Handle, __out PBOOLEAN GenerateOnClose)
 /*
 Routine description:
@@ -24,6 +24,7 @@ Abstract:
 #pragma alloc_text(PAGE,ObReferenceObjectByName)
 #pragma alloc_text(PAGE,ObReferenceFileObjectForWrite)
 #pragma alloc_text(PAGE,ObpProcessRemoveObjectQueue)
+#pragma alloc_text(PAGE,ObpRemoveObjectsFromTypeList)
 #pragma alloc_text(PAGE,ObpRemoveObjectRoutine)
 #pragma alloc_text(PAGE,ObpDeleteNameCheck)
 #pragma alloc_text(PAGE,ObpAuditObjectAccess)
@@ -1237,19 +1238,24 @@ Return Value:
 
 VOID ObpDeferObjectDeletion(IN POBJECT_HEADER ObjectHeader)
 {
+    POBP_REMOVE_OBJECT_QUEUE Queue;
     PVOID OldValue;
 
+    //  Select the deferred delete queue for the current processor.
+    //  The processor may change before we push but that only affects which worker picks the object up.
+    Queue = &ObpRemoveObjectQueues[KeGetCurrentProcessorNumber() % OBP_MAX_REMOVE_OBJECT_QUEUES];
+
     // Push this object on the list. If we make an empty to non-empty transition then we may have to start a worker thread.
     while (1) {
-        OldValue = ReadForWriteAccess(&ObpRemoveObjectList);
+        OldValue = ReadForWriteAccess(&Queue->ListHead);
         ObjectHeader->NextToFree = OldValue;
-        if (InterlockedCompareExchangePointer(&ObpRemoveObjectList, ObjectHeader, OldValue) == OldValue) {
+        if (InterlockedCompareExchangePointer(&Queue->ListHead, ObjectHeader, OldValue) == OldValue) {
             break;
         }
     }
 
     if (OldValue == NULL) {//  If we have to start the worker thread then go ahead and enqueue the work item        
-        ExQueueWorkItem(&ObpRemoveObjectWorkItem, CriticalWorkQueue);
+        ExQueueWorkItem(&Queue->WorkItem, CriticalWorkQueue);
     }
 }
 
@@ -1429,15 +1435,18 @@ VOID ObDereferenceObjectDeferDelete(IN PVOID Object)
 VOID ObpProcessRemoveObjectQueue(PVOID Parameter)
 /*
 Routine Description:
-    This is the work routine for the remove object work queue.
-    Its job is to remove and process items from the remove object queue.
+    This is the work routine for the remove object work queues.
+    Its job is to remove and process items from one of the remove object queues.
 Arguments:
-    Parameter - Ignored
+    Parameter - Supplies the remove object queue this work item belongs to
 */
 {
-    POBJECT_HEADER ObjectHeader, NextObject;
+    POBP_REMOVE_OBJECT_QUEUE Queue;
+    POBJECT_HEADER ObjectHeader;
+    POBJECT_HEADER Batch[OBP_REMOVE_OBJECT_BATCH];
+    ULONG Count, Index;
 
-    UNREFERENCED_PARAMETER(Parameter);
+    Queue = (POBP_REMOVE_OBJECT_QUEUE)Parameter;
 
     // Process the list of deferred delete objects.
     // The list head serves two purposes.
@@ -1445,28 +1454,78 @@ Arguments:
     // While we are processing the latest list we leave the header as the value 1. 
     // This will never be an object address as the bottom bits should be clear for an object.
     while (1) {
-        ObjectHeader = InterlockedExchangePointer(&ObpRemoveObjectList, (PVOID)1);
-        while (1) {
+        ObjectHeader = InterlockedExchangePointer(&Queue->ListHead, (PVOID)1);
+        while (ObjectHeader != NULL && ObjectHeader != (PVOID)1) {
+            //  Collect a run of objects of the same type.
+            //  Mass teardown tends to free objects of one type together so this lets us take the type mutex once per run rather than once per object.
+            Count = 0;
+            do {
+                Batch[Count] = ObjectHeader;
+                Count += 1;
+                ObjectHeader = ObjectHeader->NextToFree;
+            } while ((Count < OBP_REMOVE_OBJECT_BATCH) &&
+                     (ObjectHeader != NULL) &&
+                     (ObjectHeader != (PVOID)1) &&
+                     (ObjectHeader->Type == Batch[0]->Type));
+
+            ObpRemoveObjectsFromTypeList(Batch, Count);
+            for (Index = 0; Index < Count; Index += 1) {
 #ifdef POOL_TAGGING
-            if (ObpTraceEnabled && !ObpTraceNoDeregister) {
-                ObpDeregisterObject(ObjectHeader);
-            }
+                if (ObpTraceEnabled && !ObpTraceNoDeregister) {
+                    ObpDeregisterObject(Batch[Index]);
+                }
 #endif
-            NextObject = ObjectHeader->NextToFree;
-            ObpRemoveObjectRoutine(&ObjectHeader->Body, TRUE);
-            ObjectHeader = NextObject;
-            if (ObjectHeader == NULL || ObjectHeader == (PVOID)1) {
-                break;
+                ObpRemoveObjectRoutine(&Batch[Index]->Body, TRUE);
             }
         }
 
-        if (ObpRemoveObjectList == (PVOID)1 && InterlockedCompareExchangePointer(&ObpRemoveObjectList, NULL, (PVOID)1) == (PVOID)1) {
+        if (Queue->ListHead == (PVOID)1 && InterlockedCompareExchangePointer(&Queue->ListHead, NULL, (PVOID)1) == (PVOID)1) {
             break;
         }
     }
 }
 
 
+VOID ObpRemoveObjectsFromTypeList(IN POBJECT_HEADER *ObjectHeaders, IN ULONG Count)
+/*
+Routine Description:
+    This routine removes a batch of objects that are about to be deleted from their object type list.
+    The type mutex is acquired at most once for the whole batch.
+    Each creator info list entry is reinitialized so that ObpRemoveObjectRoutine skips the type list removal.
+Arguments:
+    ObjectHeaders - Supplies an array of object headers that all have the same object type
+    Count - Supplies the number of entries in the array
+*/
+{
+    POBJECT_TYPE ObjectType;
+    POBJECT_HEADER_CREATOR_INFO CreatorInfo;
+    BOOLEAN TypeMutexHeld;
+    ULONG Index;
+
+    PAGED_CODE();
+
+    ObjectType = ObjectHeaders[0]->Type;
+    TypeMutexHeld = FALSE;
+    for (Index = 0; Index < Count; Index += 1) {
+        ASSERT(ObjectHeaders[Index]->Type == ObjectType);
+        CreatorInfo = OBJECT_HEADER_TO_CREATOR_INFO(ObjectHeaders[Index]);
+        if (CreatorInfo != NULL && !IsListEmpty(&CreatorInfo->TypeList)) {
+            if (!TypeMutexHeld) {
+                ObpEnterObjectTypeMutex(ObjectType);
+                TypeMutexHeld = TRUE;
+            }
+
+            RemoveEntryList(&CreatorInfo->TypeList);
+            InitializeListHead(&CreatorInfo->TypeList);
+        }
+    }
+
+    if (TypeMutexHeld) {
+        ObpLeaveObjectTypeMutex(ObjectType);
+    }
+}
+
+
 VOID ObpRemoveObjectRoutine(IN  PVOID   Object, IN  BOOLEAN CalledOnWorkerThread)
 /*
 Routine Description:
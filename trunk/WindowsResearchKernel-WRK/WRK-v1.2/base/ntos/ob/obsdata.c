@@ -58,9 +58,18 @@ Revision History:
 #define OBS_DEBUG_SHOW_HEADER_FREE        ((ULONG) 0x00000100L)
 
 
-// Define struct of single hash clash chain
+// Multiplier used by ObpHashBuffer (the golden ratio scaled to the natural word size)
 
-typedef struct _OB_SD_CACHE_LIST
+#if defined (_WIN64)
+#define OBP_HASH_MULTIPLIER 0x9E3779B97F4A7C15UI64
+#else
+#define OBP_HASH_MULTIPLIER 0x9E3779B9
+#endif
+
+// Define struct of single hash clash chain.
+// Each chain lives in its own cache line so that processors creating objects with different descriptors do not contend on neighbouring locks.
+
+typedef struct DECLSPEC_CACHEALIGN _OB_SD_CACHE_LIST
 {
     EX_PUSH_LOCK PushLock;
     LIST_ENTRY Head;
@@ -74,6 +83,7 @@ typedef struct _OB_SD_CACHE_LIST
 #endif
 
 OB_SD_CACHE_LIST ObsSecurityDescriptorCache[SECURITY_DESCRIPTOR_CACHE_ENTRIES];
+LONG ObsSecurityDescriptorSequence = 0;//  Source of cache entry sequence numbers, see the access check result cache in obse.c
 
 #if OB_DIAGNOSTICS_ENABLED
 
@@ -148,41 +158,60 @@ Return Value:
 ULONG ObpHashBuffer(PVOID Data, ULONG Length)
 /*
 Routine Description:
-    Hashes a buffer into a 32 bit value
+    Hashes a buffer into a 32 bit value.
+    The buffer is consumed a natural word at a time into two independent multiplicative accumulators
+    so that the loop is not serialized on a single dependency chain.
 Arguments:
-    Data - Buffer containing the data to be hashed.
+    Data - Buffer containing the data to be hashed. Must be aligned to a natural word boundary.
     Length - The length in bytes of the buffer
 Return Value:
     ULONG - a 32 bit hash value.
 */
 {
-    PULONG Buffer, BufferEnd;
+    PULONG_PTR Buffer, BufferEnd;
     PUCHAR Bufferp, BufferEndp;
-
-    ULONG Result = 0;
+    ULONG_PTR Hash0, Hash1, Tail;
 
     // Calculate buffer bounds as byte pointers
     Bufferp = Data;
     BufferEndp = Bufferp + Length;
 
-    // Calculate buffer bounds as rounded down ULONG pointers
+    // Calculate buffer bounds as rounded down ULONG_PTR pointers
     Buffer = Data;
-    BufferEnd = (PULONG)(Bufferp + (Length&~(sizeof(ULONG) - 1)));
+    BufferEnd = (PULONG_PTR)(Bufferp + (Length & ~(sizeof(ULONG_PTR) - 1)));
+
+    Hash0 = Length;
+    Hash1 = OBP_HASH_MULTIPLIER;
 
-    // Loop over a whole number of ULONGs
-    while (Buffer < BufferEnd) {
-        Result ^= *Buffer++;
-        Result = _rotl(Result, 3);
+    // Loop over pairs of whole words
+    while (Buffer + 1 < BufferEnd) {
+        Hash0 = (Hash0 ^ Buffer[0]) * OBP_HASH_MULTIPLIER;
+        Hash1 = (Hash1 ^ Buffer[1]) * OBP_HASH_MULTIPLIER;
+        Buffer += 2;
     }
 
-    // Pull in the remaining bytes
+    if (Buffer < BufferEnd) {
+        Hash0 = (Hash0 ^ *Buffer++) * OBP_HASH_MULTIPLIER;
+    }
+
+    // Pull in the remaining bytes as one partial word
     Bufferp = (PUCHAR)Buffer;
-    while (Bufferp < BufferEndp) {
-        Result ^= *Bufferp++;
-        Result = _rotl(Result, 3);
+    if (Bufferp < BufferEndp) {
+        Tail = 0;
+        while (Bufferp < BufferEndp) {
+            Tail = (Tail << 8) | *Bufferp++;
+        }
+
+        Hash1 = (Hash1 ^ Tail) * OBP_HASH_MULTIPLIER;
     }
 
-    return Result;
+    // Fold the accumulators. The multiplies push entropy towards the high bits so fold those back down.
+    Hash0 ^= (Hash1 >> 7) ^ (Hash1 << 11);
+#if defined (_WIN64)
+    Hash0 ^= Hash0 >> 32;
+#endif
+    Hash0 ^= Hash0 >> 15;
+    return (ULONG)Hash0;
 }
 
 
@@ -235,7 +264,8 @@ Return Value:
                 break;
             }
 
-            if (Header->FullHash == FullHash) {
+            // Only compare the buffers when the length agrees as well, most collisions are rejected here without touching the descriptor
+            if (Header->FullHash == FullHash && Header->Length == Length) {
                 Match = ObpCompareSecurityDescriptors(InputSecurityDescriptor, Length, &Header->SecurityDescriptor);
                 if (Match) {
                     break;
@@ -328,6 +358,8 @@ Return Value:
     //  Fill the header, copy over the descriptor data, and return to our caller
     NewDescriptor->RefCount = RefBias;
     NewDescriptor->FullHash = FullHash;
+    NewDescriptor->Length = SecurityDescriptorLength;
+    NewDescriptor->Sequence = (ULONG)InterlockedIncrement(&ObsSecurityDescriptorSequence);
     RtlCopyMemory(&NewDescriptor->SecurityDescriptor, InputSecurityDescriptor, SecurityDescriptorLength);
     return NewDescriptor;
 }
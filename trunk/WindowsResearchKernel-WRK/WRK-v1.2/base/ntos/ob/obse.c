@@ -20,6 +20,8 @@ Abstract:
 #pragma alloc_text(PAGE,ObAssignSecurity)
 #pragma alloc_text(PAGE,ObCheckCreateObjectAccess)
 #pragma alloc_text(PAGE,ObCheckObjectAccess)
+#pragma alloc_text(PAGE,ObCachedAccessCheck)
+#pragma alloc_text(INIT,ObpInitAccessCache)
 #pragma alloc_text(PAGE,ObpCheckObjectReference)
 #pragma alloc_text(PAGE,ObpCheckTraverseAccess)
 #pragma alloc_text(PAGE,ObGetObjectSecurity)
@@ -33,6 +35,19 @@ Abstract:
 
 ULONG ObpDefaultSecurityDescriptorLength = 256;
 
+#ifdef ALLOC_DATA_PRAGMA
+#pragma data_seg("PAGEDATA")
+#endif
+
+OBP_ACCESS_CACHE_ENTRY ObpAccessCache[OBP_ACCESS_CACHE_BUCKETS];//  Direct mapped access check result cache
+
+#ifdef ALLOC_DATA_PRAGMA
+#pragma data_seg()
+#endif
+
+#define ObpHashAccessCache(_Header, _TokenId, _DesiredAccess) \
+    (((((ULONG_PTR)(_Header)) >> 4) ^ (_TokenId).LowPart ^ (_DesiredAccess) ^ ((_DesiredAccess) >> 16)) & (OBP_ACCESS_CACHE_BUCKETS - 1))
+
 
 NTSTATUS NtSetSecurityObject(__in HANDLE Handle, __in SECURITY_INFORMATION SecurityInformation, __in PSECURITY_DESCRIPTOR SecurityDescriptor)
 /*
@@ -273,16 +288,29 @@ BOOLEAN ObCheckObjectAccess(
     SeLockSubjectContext(&AccessState->SubjectSecurityContext);
 
     //  Do the access check, and if we have some privileges then put those in the access state too.
-    AccessAllowed = SeAccessCheck(SecurityDescriptor,
-                                  &AccessState->SubjectSecurityContext,
-                                  TRUE,                        // Tokens are locked
-                                  AccessState->RemainingDesiredAccess,
-                                  AccessState->PreviouslyGrantedAccess,
-                                  &Privileges,
-                                  &ObjectType->TypeInfo.GenericMapping,
-                                  AccessMode,
-                                  &GrantedAccess,
-                                  AccessStatus);
+    //  Descriptors that came from the cache can have their results cached, ones built by a type specific security procedure cannot.
+    if (!MemoryAllocated) {
+        AccessAllowed = ObCachedAccessCheck(SecurityDescriptor,
+                                            &AccessState->SubjectSecurityContext,
+                                            AccessState->RemainingDesiredAccess,
+                                            AccessState->PreviouslyGrantedAccess,
+                                            &Privileges,
+                                            ObjectType,
+                                            AccessMode,
+                                            &GrantedAccess,
+                                            AccessStatus);
+    } else {
+        AccessAllowed = SeAccessCheck(SecurityDescriptor,
+                                      &AccessState->SubjectSecurityContext,
+                                      TRUE,                        // Tokens are locked
+                                      AccessState->RemainingDesiredAccess,
+                                      AccessState->PreviouslyGrantedAccess,
+                                      &Privileges,
+                                      &ObjectType->TypeInfo.GenericMapping,
+                                      AccessMode,
+                                      &GrantedAccess,
+                                      AccessStatus);
+    }
     if (Privileges != NULL) {
         Status = SeAppendPrivileges(AccessState, Privileges);
         SeFreePrivileges(Privileges);
@@ -313,6 +341,132 @@ BOOLEAN ObCheckObjectAccess(
 }
 
 
+VOID ObpInitAccessCache(VOID)
+/*
+Routine Description:
+    Initializes the access check result cache
+*/
+{
+    ULONG i;
+
+    for (i = 0; i < OBP_ACCESS_CACHE_BUCKETS; i++) {
+        ExInitializePushLock(&ObpAccessCache[i].PushLock);
+        ObpAccessCache[i].SecurityDescriptor = NULL;
+    }
+}
+
+
+BOOLEAN ObCachedAccessCheck(
+    IN PSECURITY_DESCRIPTOR SecurityDescriptor OPTIONAL,
+    IN PSECURITY_SUBJECT_CONTEXT SubjectSecurityContext,
+    IN ACCESS_MASK DesiredAccess,
+    IN ACCESS_MASK PreviouslyGrantedAccess,
+    OUT PPRIVILEGE_SET *Privileges,
+    IN POBJECT_TYPE ObjectType,
+    IN KPROCESSOR_MODE AccessMode,
+    OUT PACCESS_MASK GrantedAccess,
+    OUT PNTSTATUS AccessStatus
+)
+/*
+Routine Description:
+    This routine is a replacement for SeAccessCheck that remembers the result of access checks against cached security descriptors.
+    Repeated opens of the same object by the same token for the same access are then satisfied without walking the DACL again.
+
+    Only results that did not involve privileges are cached, so a cache hit never has privileges or audits of privilege use associated with it.
+    The caller is still responsible for generating the open audit.
+Arguments:
+    SecurityDescriptor - Supplies a security descriptor that was obtained from the security descriptor cache (ObLogSecurityDescriptor), or NULL.
+    SubjectSecurityContext - Supplies the subject context. The tokens must be locked by the caller.
+    DesiredAccess - Supplies the access being requested.
+    PreviouslyGrantedAccess - Supplies the access already granted.
+    Privileges - Receives any privileges used to grant access, see SeAccessCheck.
+    ObjectType - Supplies the object type whose generic mapping applies to the check.
+    AccessMode - Supplies the processor mode the check is made for.
+    GrantedAccess - Receives the granted access mask.
+    AccessStatus - Receives the status of the access check.
+Return Value:
+    BOOLEAN - TRUE if access is allowed and FALSE otherwise
+*/
+{
+    PSECURITY_DESCRIPTOR_HEADER Header;
+    POBP_ACCESS_CACHE_ENTRY Entry;
+    LUID TokenId, ModifiedId;
+    BOOLEAN AccessAllowed;
+    BOOLEAN Cacheable;
+    PETHREAD CurrentThread;
+
+    PAGED_CODE();
+
+    Cacheable = FALSE;
+    Entry = NULL;
+    Header = NULL;
+    CurrentThread = PsGetCurrentThread();
+
+    //  Kernel mode checks and checks against a null descriptor do not walk an ACL so there is nothing to save by caching them.
+    if ((AccessMode != KernelMode) &&
+        (SecurityDescriptor != NULL) &&
+        SeQuerySubjectContextTokenIds(SubjectSecurityContext, &TokenId, &ModifiedId)) {
+        Header = SD_TO_SD_HEADER(SecurityDescriptor);
+        Entry = &ObpAccessCache[ObpHashAccessCache(Header, TokenId, DesiredAccess)];
+
+        KeEnterCriticalRegionThread(&CurrentThread->Tcb);
+        ExAcquirePushLockShared(&Entry->PushLock);
+        if ((Entry->SecurityDescriptor == Header) &&
+            (Entry->Sequence == Header->Sequence) &&
+            (Entry->ObjectType == ObjectType) &&
+            (Entry->DesiredAccess == DesiredAccess) &&
+            (Entry->PreviouslyGrantedAccess == PreviouslyGrantedAccess) &&
+            RtlEqualLuid(&Entry->TokenId, &TokenId) &&
+            RtlEqualLuid(&Entry->ModifiedId, &ModifiedId)) {
+            *GrantedAccess = Entry->GrantedAccess;
+            *AccessStatus = Entry->AccessStatus;
+            ExReleasePushLockShared(&Entry->PushLock);
+            KeLeaveCriticalRegionThread(&CurrentThread->Tcb);
+
+            *Privileges = NULL;
+            return (BOOLEAN)NT_SUCCESS(*AccessStatus);
+        }
+
+        ExReleasePushLockShared(&Entry->PushLock);
+        KeLeaveCriticalRegionThread(&CurrentThread->Tcb);
+        Cacheable = TRUE;
+    }
+
+    *Privileges = NULL;
+    AccessAllowed = SeAccessCheck(SecurityDescriptor,
+                                  SubjectSecurityContext,
+                                  TRUE,                        // Tokens are locked
+                                  DesiredAccess,
+                                  PreviouslyGrantedAccess,
+                                  Privileges,
+                                  &ObjectType->TypeInfo.GenericMapping,
+                                  AccessMode,
+                                  GrantedAccess,
+                                  AccessStatus);
+
+    //  Remember the result unless privileges were involved.
+    //  The cache is only a hint so if some other thread is updating this entry we just skip the update.
+    if (Cacheable && *Privileges == NULL && (BOOLEAN)NT_SUCCESS(*AccessStatus) == AccessAllowed) {
+        KeEnterCriticalRegionThread(&CurrentThread->Tcb);
+        if (ExTryAcquirePushLockExclusive(&Entry->PushLock)) {
+            Entry->SecurityDescriptor = Header;
+            Entry->Sequence = Header->Sequence;
+            Entry->ObjectType = ObjectType;
+            Entry->DesiredAccess = DesiredAccess;
+            Entry->PreviouslyGrantedAccess = PreviouslyGrantedAccess;
+            Entry->GrantedAccess = *GrantedAccess;
+            Entry->AccessStatus = *AccessStatus;
+            Entry->TokenId = TokenId;
+            Entry->ModifiedId = ModifiedId;
+            ExReleasePushLockExclusive(&Entry->PushLock);
+        }
+        KeLeaveCriticalRegionThread(&CurrentThread->Tcb);
+    }
+
+    return AccessAllowed;
+}
+
+
 BOOLEAN ObpCheckObjectReference(IN PVOID Object, IN OUT PACCESS_STATE AccessState, IN BOOLEAN TypeMutexLocked, IN KPROCESSOR_MODE AccessMode, OUT PNTSTATUS AccessStatus)
 /*
 Routine Description:
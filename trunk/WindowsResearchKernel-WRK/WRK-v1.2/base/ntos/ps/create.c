@@ -737,9 +737,11 @@ NTSTATUS PspCreateProcess(
     if (Parent != NULL) {
         Process->DefaultHardErrorProcessing = Parent->DefaultHardErrorProcessing;
         Process->InheritedFromUniqueProcessId = Parent->UniqueProcessId;
+        PS_SET_BITS(&Process->Flags, Parent->Flags & PS_PROCESS_FLAGS_DEFAULT_IO_PRIORITY);
     } else {
         Process->DefaultHardErrorProcessing = PROCESS_HARDERROR_DEFAULT;
         Process->InheritedFromUniqueProcessId = NULL;
+        PS_SET_BITS(&Process->Flags, IoPriorityNormal << PS_PROCESS_FLAGS_PRIORITY_SHIFT);
     }
 
     // Section
@@ -438,6 +438,7 @@ NTSTATUS NtQueryInformationProcess(__in HANDLE ProcessHandle,
     ULONG DefaultHardErrorMode;
     ULONG DisableBoost;
     ULONG BreakOnTerminationEnabled;
+    ULONG IoPriority;
     PPROCESS_DEVICEMAP_INFORMATION DeviceMapInfo;
     PROCESS_SESSION_INFORMATION SessionInfo;
     PROCESS_PRIORITY_CLASS PriorityClass;
@@ -852,6 +853,30 @@ NTSTATUS NtQueryInformationProcess(__in HANDLE ProcessHandle,
             return GetExceptionCode();
         }
 
+        return st;
+    case ProcessIoPriority:
+        if (ProcessInformationLength != sizeof(ULONG)) {
+            return STATUS_INFO_LENGTH_MISMATCH;
+        }
+
+        st = ObReferenceObjectByHandle(ProcessHandle, PROCESS_QUERY_INFORMATION, PsProcessType, PreviousMode, &Process, NULL);
+        if (!NT_SUCCESS(st)) {
+            return st;
+        }
+
+        IoPriority = (Process->Flags & PS_PROCESS_FLAGS_DEFAULT_IO_PRIORITY) >> PS_PROCESS_FLAGS_PRIORITY_SHIFT;
+        ObDereferenceObject(Process);
+
+        try {
+            *(PULONG)ProcessInformation = IoPriority;
+            if (ARGUMENT_PRESENT(ReturnLength)) {
+                *ReturnLength = sizeof(ULONG);
+            }
+        } except(EXCEPTION_EXECUTE_HANDLER)
+        {
+            return GetExceptionCode();
+        }
+
         return st;
     case ProcessDeviceMap:
         DeviceMapInfo = (PPROCESS_DEVICEMAP_INFORMATION)ProcessInformation;
@@ -1426,6 +1451,7 @@ NTSTATUS NtSetInformationProcess(
     HANDLE DirectoryHandle;
     PROCESS_SESSION_INFORMATION SessionInfo;
     ULONG EnableBreakOnTermination;
+    ULONG IoPriority;
     PEJOB Job;
 
     PAGED_CODE();
@@ -1927,6 +1953,40 @@ NTSTATUS NtSetInformationProcess(
 
         ObDereferenceObject(Process);
         return st;
+    case ProcessIoPriority:
+        if (ProcessInformationLength != sizeof(ULONG)) {
+            return STATUS_INFO_LENGTH_MISMATCH;
+        }
+
+        try {
+            IoPriority = *(PULONG)ProcessInformation;
+        } except(EXCEPTION_EXECUTE_HANDLER)
+        {
+            return GetExceptionCode();
+        }
+
+        // Critical priority is reserved for the memory manager.
+        if (IoPriority >= IoPriorityCritical) {
+            return STATUS_INVALID_PARAMETER;
+        }
+
+        st = ObReferenceObjectByHandle(ProcessHandle, PROCESS_SET_INFORMATION, PsProcessType, PreviousMode, &Process, NULL);
+        if (!NT_SUCCESS(st)) {
+            return st;
+        }
+
+        // Raising a process's I/O above normal priority is a privileged operation, like raising its base priority.
+        if (IoPriority > IoPriorityNormal) {
+            HasPrivilege = SeCheckPrivilegedObject(SeIncreaseBasePriorityPrivilege, ProcessHandle, PROCESS_SET_INFORMATION, PreviousMode);
+            if (!HasPrivilege) {
+                ObDereferenceObject(Process);
+                return STATUS_PRIVILEGE_NOT_HELD;
+            }
+        }
+
+        PS_SET_CLEAR_BITS(&Process->Flags, IoPriority << PS_PROCESS_FLAGS_PRIORITY_SHIFT, PS_PROCESS_FLAGS_DEFAULT_IO_PRIORITY & ~(IoPriority << PS_PROCESS_FLAGS_PRIORITY_SHIFT));
+        ObDereferenceObject(Process);
+        return STATUS_SUCCESS;
     case ProcessDebugFlags:
     {
         ULONG Flags;
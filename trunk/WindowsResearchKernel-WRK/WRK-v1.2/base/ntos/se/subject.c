@@ -24,6 +24,7 @@ Abstract:
 #pragma alloc_text(PAGE,SeLockSubjectContext)
 #pragma alloc_text(PAGE,SeUnlockSubjectContext)
 #pragma alloc_text(PAGE,SeReleaseSubjectContext)
+#pragma alloc_text(PAGE,SeQuerySubjectContextTokenIds)
 #pragma alloc_text(PAGE,SepGetDefaultsSubjectContext)
 #pragma alloc_text(PAGE,SepIdAssignableAsGroup)
 #pragma alloc_text(PAGE,SepValidOwnerSubjectContext)
@@ -177,6 +178,39 @@ Arguments:
 }
 
 
+BOOLEAN SeQuerySubjectContextTokenIds(__in PSECURITY_SUBJECT_CONTEXT SubjectContext, __out PLUID TokenId, __out PLUID ModifiedId)
+/*
+Routine Description:
+    Returns the identifiers of the token that access checks against the passed SubjectContext are evaluated with.
+    The modified id changes every time the token is adjusted, so the pair identifies one version of one token.
+    Callers use this to key cached access check results.
+
+    The caller must have locked the subject context with SeLockSubjectContext().
+Arguments:
+    SubjectContext - Points to a locked SECURITY_SUBJECT_CONTEXT.
+    TokenId - Receives the token id of the primary token.
+    ModifiedId - Receives the modified id of the primary token.
+Return Value:
+    TRUE if the identifiers were returned.
+    FALSE if the subject is impersonating.
+    Compound ACEs make those access checks depend on both the client and the primary token, so they are not described by a single token.
+*/
+{
+    PTOKEN Token;
+
+    PAGED_CODE();
+
+    if (ARGUMENT_PRESENT(SubjectContext->ClientToken)) {
+        return FALSE;
+    }
+
+    Token = (PTOKEN)SubjectContext->PrimaryToken;
+    *TokenId = Token->TokenId;
+    *ModifiedId = Token->ModifiedId;
+    return TRUE;
+}
+
+
 VOID SepGetDefaultsSubjectContext(
     IN PSECURITY_SUBJECT_CONTEXT SubjectContext,
     OUT PSID *Owner,
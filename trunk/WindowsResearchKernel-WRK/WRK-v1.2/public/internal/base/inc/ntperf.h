@@ -224,6 +224,13 @@ typedef struct _PERFINFO_FILENAME_INFORMATION {
     WCHAR FileName[1];
 } PERFINFO_FILENAME_INFORMATION, *PPERFINFO_FILENAME_INFORMATION;
 
+typedef struct _PERFINFO_OB_LOOKUP_INFORMATION {
+    ULONGLONG ElapsedCycles;
+    PVOID ObjectType;
+    NTSTATUS Status;
+    // followed by the object name being looked up
+} PERFINFO_OB_LOOKUP_INFORMATION, *PPERFINFO_OB_LOOKUP_INFORMATION;
+
 typedef struct _PERFINFO_SAMPLED_PROFILE_INFORMATION {
     PVOID InstructionPointer;
     ULONG ThreadId;
@@ -241,6 +248,15 @@ typedef struct _PERFINFO_DPC_INFORMATION {
     PVOID DpcRoutine;
 } PERFINFO_DPC_INFORMATION, *PPERFINFO_DPC_INFORMATION;
 
+typedef struct _PERFINFO_REQUEST_LATENCY_INFORMATION {
+    ULONGLONG ElapsedCycles;
+    PVOID DeviceObject;
+    PVOID Irp;
+    NTSTATUS Status;
+    UCHAR MajorFunction;
+    UCHAR MinorFunction;
+} PERFINFO_REQUEST_LATENCY_INFORMATION, *PPERFINFO_REQUEST_LATENCY_INFORMATION;
+
 typedef struct _PERFINFO_INTERRUPT_INFORMATION {
     ULONGLONG InitialTime;
     PVOID ServiceRoutine;
@@ -761,6 +761,7 @@ typedef struct _WMI_SWITCH_BUFFER_INFORMATION {
 #define PERFINFO_LOG_TYPE_DRIVER_COMPLETE_REQUEST           (EVENT_TRACE_GROUP_IO | 0x34)
 #define PERFINFO_LOG_TYPE_DRIVER_COMPLETE_REQUEST_RETURN    (EVENT_TRACE_GROUP_IO | 0x35)
 #define PERFINFO_LOG_TYPE_BOOT_PREFETCH_INFORMATION         (EVENT_TRACE_GROUP_IO | 0x36)
+#define PERFINFO_LOG_TYPE_DRIVER_REQUEST_LATENCY            (EVENT_TRACE_GROUP_IO | 0x37)
 
 
 // Event types for Memory subsystem
@@ -933,6 +934,7 @@ typedef struct _WMI_SWITCH_BUFFER_INFORMATION {
 #define PERFINFO_LOG_TYPE_SIGNAL_OBJECT                (EVENT_TRACE_GROUP_OBJECT | 0x23)
 #define PERFINFO_LOG_TYPE_CLEAR_OBJECT                 (EVENT_TRACE_GROUP_OBJECT | 0x24)
 #define PERFINFO_LOG_TYPE_UNWAIT_SIGNALED_OBJECT       (EVENT_TRACE_GROUP_OBJECT | 0x25)
+#define PERFINFO_LOG_TYPE_OB_SLOW_LOOKUP               (EVENT_TRACE_GROUP_OBJECT | 0x26)
 
 
 // Event types for Power subsystem
@@ -416,6 +416,14 @@ NTSYSAPI NTSTATUS NTAPI ZwReadFileScatter(
     __in_opt PLARGE_INTEGER ByteOffset,
     __in_opt PULONG Key
 );
+NTSYSAPI NTSTATUS NTAPI ZwReadFileVector(
+    __in HANDLE FileHandle,
+    __out PIO_STATUS_BLOCK IoStatusBlock,
+    __in_ecount(VectorCount) PFILE_IO_VECTOR Vector,
+    __in ULONG VectorCount,
+    __in_opt PLARGE_INTEGER ByteOffset,
+    __in_opt PULONG Key
+);
 NTSYSAPI NTSTATUS NTAPI ZwSetEaFile(__in HANDLE FileHandle,
                                     __out PIO_STATUS_BLOCK IoStatusBlock,
                                     __in_bcount(Length) PVOID Buffer,
@@ -431,6 +439,14 @@ NTSYSAPI NTSTATUS NTAPI ZwWriteFileGather(
     __in_opt PLARGE_INTEGER ByteOffset,
     __in_opt PULONG Key
 );
+NTSYSAPI NTSTATUS NTAPI ZwWriteFileVector(
+    __in HANDLE FileHandle,
+    __out PIO_STATUS_BLOCK IoStatusBlock,
+    __in_ecount(VectorCount) PFILE_IO_VECTOR Vector,
+    __in ULONG VectorCount,
+    __in_opt PLARGE_INTEGER ByteOffset,
+    __in_opt PULONG Key
+);
 NTSYSAPI NTSTATUS NTAPI ZwLoadDriver(__in PUNICODE_STRING DriverServiceName);
 NTSYSAPI NTSTATUS NTAPI ZwUnloadDriver(__in PUNICODE_STRING DriverServiceName);
 NTSYSAPI NTSTATUS NTAPI ZwCreateIoCompletion(__out PHANDLE IoCompletionHandle,
@@ -459,6 +475,21 @@ NTSYSAPI NTSTATUS NTAPI ZwRemoveIoCompletion(__in HANDLE IoCompletionHandle,
                                              __out PVOID* ApcContext,
                                              __out PIO_STATUS_BLOCK IoStatusBlock,
                                              __in_opt PLARGE_INTEGER Timeout);
+NTSYSAPI NTSTATUS NTAPI ZwRemoveIoCompletionEx(__in HANDLE IoCompletionHandle,
+                                               __out_ecount(Count) PFILE_IO_COMPLETION_INFORMATION IoCompletionInformation,
+                                               __in ULONG Count,
+                                               __out PULONG NumEntriesRemoved,
+                                               __in_opt PLARGE_INTEGER Timeout);
+NTSYSAPI NTSTATUS NTAPI ZwCreateIoRing(__out PHANDLE IoRingHandle,
+                                       __in ACCESS_MASK DesiredAccess,
+                                       __in_opt POBJECT_ATTRIBUTES ObjectAttributes,
+                                       __in HANDLE IoCompletionHandle,
+                                       __in_opt PVOID CompletionKey,
+                                       __in PIO_RING_SUBMISSION_QUEUE SubmissionQueue,
+                                       __in ULONG EntryCount);
+NTSYSAPI NTSTATUS NTAPI ZwSubmitIoRing(__in HANDLE IoRingHandle, __in ULONG Count OPTIONAL, __out_opt PULONG NumberSubmitted);
+NTSYSAPI NTSTATUS NTAPI ZwRegisterIoRingFiles(__in HANDLE IoRingHandle, __in ULONG Count, __in_ecount_opt(Count) PHANDLE FileHandles);
+NTSYSAPI NTSTATUS NTAPI ZwRegisterIoRingBuffers(__in HANDLE IoRingHandle, __in ULONG Count, __in_ecount_opt(Count) PIO_RING_BUFFER_REGISTRATION Buffers);
 NTSYSAPI NTSTATUS NTAPI ZwCallbackReturn(__in_bcount_opt(OutputLength) PVOID OutputBuffer, __in ULONG OutputLength, __in NTSTATUS Status);
 NTSYSAPI NTSTATUS NTAPI ZwQueryDebugFilterState(__in ULONG ComponentId, __in ULONG Level);
 NTSYSAPI NTSTATUS NTAPI ZwSetDebugFilterState(__in ULONG ComponentId, __in ULONG Level, __in BOOLEAN State);
@@ -675,6 +706,16 @@ NTSYSAPI NTSTATUS NTAPI ZwDuplicateObject(
     __in ULONG HandleAttributes,
     __in ULONG Options
 );
+NTSYSAPI NTSTATUS NTAPI ZwDuplicateObjects(
+    __in HANDLE SourceProcessHandle,
+    __in ULONG Count,
+    __in_ecount(Count) PHANDLE SourceHandles,
+    __in HANDLE TargetProcessHandle,
+    __out_ecount(Count) PHANDLE TargetHandles,
+    __in ACCESS_MASK DesiredAccess,
+    __in ULONG HandleAttributes,
+    __in ULONG Options
+);
 NTSYSAPI NTSTATUS NTAPI ZwMakeTemporaryObject(__in HANDLE Handle);
 NTSYSAPI NTSTATUS NTAPI ZwMakePermanentObject(__in HANDLE Handle);
 NTSYSAPI NTSTATUS NTAPI ZwSignalAndWaitForSingleObject(__in HANDLE SignalHandle,
@@ -707,6 +748,7 @@ NTSYSAPI NTSTATUS NTAPI ZwQuerySecurityObject(
     __out PULONG LengthNeeded
 );
 NTSYSAPI NTSTATUS NTAPI ZwClose(__in HANDLE Handle);
+NTSYSAPI NTSTATUS NTAPI ZwCloseMultiple(__in ULONG Count, __in_ecount(Count) PHANDLE Handles, __out_ecount_opt(Count) PNTSTATUS Statuses);
 NTSYSAPI NTSTATUS NTAPI ZwCreateDirectoryObject(
     __out PHANDLE DirectoryHandle,
     __in ACCESS_MASK DesiredAccess,
@@ -962,6 +962,26 @@ typedef union _FILE_SEGMENT_ELEMENT {
 
 // end_ntifs end_winnt end_ntddk end_nthal
 
+// Define buffer segment structure for vectored read/write.
+// Unlike scatter/gather segments, vector segments may have any address and length.
+typedef struct _FILE_IO_VECTOR {
+    PVOID Buffer;
+    ULONG Length;
+} FILE_IO_VECTOR, *PFILE_IO_VECTOR;
+
+#define IO_MAXIMUM_FILE_VECTOR_COUNT    1024
+
+// Define the I/O priority hints carried by I/O request packets.
+// A process's default hint is set with the ProcessIoPriority information class.
+typedef enum _IO_PRIORITY_HINT {
+    IoPriorityVeryLow = 0,          // Idle and background work.
+    IoPriorityLow,                  // Prefetching and bulk copies.
+    IoPriorityNormal,               // The default.
+    IoPriorityHigh,                 // Paging I/O that a thread is blocked on.
+    IoPriorityCritical,             // Reserved for the memory manager.
+    MaxIoPriorityTypes
+} IO_PRIORITY_HINT;
+
 // I/O system user APIs
 
 NTSYSCALLAPI NTSTATUS NTAPI NtCancelIoFile (__in HANDLE FileHandle, __out PIO_STATUS_BLOCK IoStatusBlock);
@@ -1195,6 +1215,15 @@ NTSYSCALLAPI NTSTATUS NTAPI NtReadFileScatter (
     __in_opt PULONG Key
     );
 
+NTSYSCALLAPI NTSTATUS NTAPI NtReadFileVector (
+    __in HANDLE FileHandle,
+    __out PIO_STATUS_BLOCK IoStatusBlock,
+    __in_ecount(VectorCount) PFILE_IO_VECTOR Vector,
+    __in ULONG VectorCount,
+    __in_opt PLARGE_INTEGER ByteOffset,
+    __in_opt PULONG Key
+    );
+
 NTSYSCALLAPI NTSTATUS NTAPI NtSetEaFile (
     __in HANDLE FileHandle,
     __out PIO_STATUS_BLOCK IoStatusBlock,
@@ -1214,6 +1243,15 @@ NTSYSCALLAPI NTSTATUS NTAPI NtWriteFileGather (
     __in_opt PULONG Key
     );
 
+NTSYSCALLAPI NTSTATUS NTAPI NtWriteFileVector (
+    __in HANDLE FileHandle,
+    __out PIO_STATUS_BLOCK IoStatusBlock,
+    __in_ecount(VectorCount) PFILE_IO_VECTOR Vector,
+    __in ULONG VectorCount,
+    __in_opt PLARGE_INTEGER ByteOffset,
+    __in_opt PULONG Key
+    );
+
 NTSYSCALLAPI NTSTATUS NTAPI NtLoadDriver (__in PUNICODE_STRING DriverServiceName);
 NTSYSCALLAPI NTSTATUS NTAPI NtUnloadDriver (__in PUNICODE_STRING DriverServiceName);
 
@@ -2350,6 +2388,109 @@ NTSYSCALLAPI NTSTATUS NTAPI NtRemoveIoCompletion (
     __in_opt PLARGE_INTEGER Timeout
     );
 
+// I/O completion entry returned by NtRemoveIoCompletionEx.
+typedef struct _FILE_IO_COMPLETION_INFORMATION {
+    PVOID KeyContext;
+    PVOID ApcContext;
+    IO_STATUS_BLOCK IoStatusBlock;
+} FILE_IO_COMPLETION_INFORMATION, *PFILE_IO_COMPLETION_INFORMATION;
+
+NTSYSCALLAPI NTSTATUS NTAPI NtRemoveIoCompletionEx (
+    __in HANDLE IoCompletionHandle,
+    __out_ecount(Count) PFILE_IO_COMPLETION_INFORMATION IoCompletionInformation,
+    __in ULONG Count,
+    __out PULONG NumEntriesRemoved,
+    __in_opt PLARGE_INTEGER Timeout
+    );
+
+
+// I/O Ring Specific Access Rights.
+#define IO_RING_SUBMIT              0x0001
+#define IO_RING_REGISTER            0x0002
+#define IO_RING_ALL_ACCESS (STANDARD_RIGHTS_REQUIRED|SYNCHRONIZE|0x3)
+
+// Maximum number of entries in an I/O ring submission queue. The entry count must be a power of two.
+#define IO_RING_MAXIMUM_ENTRIES     0x1000
+
+// Maximum number of files and buffers that may be registered with an I/O ring.
+#define IO_RING_MAXIMUM_REGISTERED_FILES    0x400
+#define IO_RING_MAXIMUM_REGISTERED_BUFFERS  0x400
+
+// I/O ring submission entry flags.
+
+// The entry names a registered file and buffer: FileHandle holds the index of the file,
+// BufferIndex the index of the buffer, and Buffer the byte offset of the transfer within that buffer.
+#define IO_RING_ENTRY_REGISTERED    0x01
+
+
+// I/O Ring Operations.
+typedef enum _IO_RING_OPERATION {
+    IoRingOperationNop,
+    IoRingOperationRead,
+    IoRingOperationWrite,
+    IoRingOperationMaximum
+    } IO_RING_OPERATION;
+
+
+// I/O Ring Submission Queue Structures.
+
+// The caller fills entries at Tail and advances Tail; NtSubmitIoRing consumes entries at Head and advances Head.
+// Both indices run freely and are reduced modulo the entry count.
+// Each entry completes through the I/O completion port the ring was created with,
+// returning the ring's completion key as the key context and UserContext as the apc context.
+// IoStatusBlock is not used; the status of every entry is returned only through the completion.
+typedef struct _IO_RING_SUBMISSION_ENTRY {
+    UCHAR Operation;
+    UCHAR Flags;
+    USHORT BufferIndex;
+    ULONG Length;
+    HANDLE FileHandle;
+    PVOID Buffer;
+    LARGE_INTEGER ByteOffset;
+    PIO_STATUS_BLOCK IoStatusBlock;
+    PVOID UserContext;
+} IO_RING_SUBMISSION_ENTRY, *PIO_RING_SUBMISSION_ENTRY;
+
+typedef struct _IO_RING_SUBMISSION_QUEUE {
+    ULONG Head;
+    ULONG Tail;
+    IO_RING_SUBMISSION_ENTRY Entries[ANYSIZE_ARRAY];
+} IO_RING_SUBMISSION_QUEUE, *PIO_RING_SUBMISSION_QUEUE;
+
+NTSYSCALLAPI NTSTATUS NTAPI NtCreateIoRing (
+    __out PHANDLE IoRingHandle,
+    __in ACCESS_MASK DesiredAccess,
+    __in_opt POBJECT_ATTRIBUTES ObjectAttributes,
+    __in HANDLE IoCompletionHandle,
+    __in_opt PVOID CompletionKey,
+    __in PIO_RING_SUBMISSION_QUEUE SubmissionQueue,
+    __in ULONG EntryCount
+    );
+
+NTSYSCALLAPI NTSTATUS NTAPI NtSubmitIoRing (
+    __in HANDLE IoRingHandle,
+    __in ULONG Count OPTIONAL,
+    __out_opt PULONG NumberSubmitted
+    );
+
+// I/O Ring Buffer Registration Structure.
+typedef struct _IO_RING_BUFFER_REGISTRATION {
+    PVOID Address;
+    ULONG Length;
+} IO_RING_BUFFER_REGISTRATION, *PIO_RING_BUFFER_REGISTRATION;
+
+NTSYSCALLAPI NTSTATUS NTAPI NtRegisterIoRingFiles (
+    __in HANDLE IoRingHandle,
+    __in ULONG Count,
+    __in_ecount_opt(Count) PHANDLE FileHandles
+    );
+
+NTSYSCALLAPI NTSTATUS NTAPI NtRegisterIoRingBuffers (
+    __in HANDLE IoRingHandle,
+    __in ULONG Count,
+    __in_ecount_opt(Count) PIO_RING_BUFFER_REGISTRATION Buffers
+    );
+
 
 // Defines that are used to access the registry, but are not registry specific.
 
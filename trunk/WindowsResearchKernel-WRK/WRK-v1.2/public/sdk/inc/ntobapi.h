@@ -73,6 +73,7 @@ typedef enum _OBJECT_INFORMATION_CLASS {
     ObjectTypesInformation,
     ObjectHandleFlagInformation,
     ObjectSessionInformation,
+    ObjectTypesStatisticsInformation,
     MaxObjectInfoClass  // MaxObjectInfoClass should always be the last enum
 } OBJECT_INFORMATION_CLASS;
 
@@ -123,6 +124,23 @@ typedef struct _OBJECT_TYPES_INFORMATION {
     // OBJECT_TYPE_INFORMATION TypeInformation;
 } OBJECT_TYPES_INFORMATION, *POBJECT_TYPES_INFORMATION;
 
+//  Activity counters for one object type, returned in the same order as ObjectTypesInformation.
+//  LookupCycles is the processor cycle count spent in object name lookups charged to the type.
+typedef struct _OBJECT_TYPE_STATISTICS_INFORMATION {
+    ULONG TypeIndex;
+    ULONG NumberOfCreates;
+    ULONG NumberOfDeletes;
+    ULONG NumberOfHandleOpens;
+    ULONG NumberOfLookups;
+    ULONG NumberOfSlowLookups;
+    ULONGLONG LookupCycles;
+} OBJECT_TYPE_STATISTICS_INFORMATION, *POBJECT_TYPE_STATISTICS_INFORMATION;
+
+typedef struct _OBJECT_TYPES_STATISTICS_INFORMATION {
+    ULONG NumberOfTypes;
+    OBJECT_TYPE_STATISTICS_INFORMATION TypeStatistics[1];
+} OBJECT_TYPES_STATISTICS_INFORMATION, *POBJECT_TYPES_STATISTICS_INFORMATION;
+
 typedef struct _OBJECT_HANDLE_FLAG_INFORMATION {
     BOOLEAN Inherit;
     BOOLEAN ProtectFromClose;
@@ -148,6 +166,20 @@ NTSYSCALLAPI NTSTATUS NTAPI NtDuplicateObject (
     __in ULONG Options
     );
 
+NTSYSCALLAPI NTSTATUS NTAPI NtDuplicateObjects (
+    __in HANDLE SourceProcessHandle,
+    __in ULONG Count,
+    __in_ecount(Count) PHANDLE SourceHandles,
+    __in HANDLE TargetProcessHandle,
+    __out_ecount(Count) PHANDLE TargetHandles,
+    __in ACCESS_MASK DesiredAccess,
+    __in ULONG HandleAttributes,
+    __in ULONG Options
+    );
+
+//  Maximum number of handles accepted by NtCloseMultiple and NtDuplicateObjects.
+#define MAXIMUM_HANDLE_BATCH 512
+
 // begin_ntddk begin_wdm
 #define DUPLICATE_CLOSE_SOURCE      0x00000001  // winnt
 #define DUPLICATE_SAME_ACCESS       0x00000002  // winnt
@@ -174,6 +206,7 @@ NTSYSCALLAPI NTSTATUS NTAPI NtQuerySecurityObject (
     );
 
 NTSYSCALLAPI NTSTATUS NTAPI NtClose (__in HANDLE Handle);
+NTSYSCALLAPI NTSTATUS NTAPI NtCloseMultiple (__in ULONG Count, __in_ecount(Count) PHANDLE Handles, __out_ecount_opt(Count) PNTSTATUS Statuses);
 
 // end_ntifs
 